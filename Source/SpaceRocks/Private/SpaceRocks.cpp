@@ -1,9 +1,18 @@
 // Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
 
 #include "SpaceRocks.h"
+#include "SpaceRocksTrace.h"
 
+class FSpaceRocksModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		FSpaceRocksTrace::Startup();
+	}
+};
 
-IMPLEMENT_PRIMARY_GAME_MODULE(FDefaultGameModuleImpl, SpaceRocks, "SpaceRocks");
+IMPLEMENT_PRIMARY_GAME_MODULE(FSpaceRocksModule, SpaceRocks, "SpaceRocks");
 
 DEFINE_LOG_CATEGORY(LogFlying)
 
@@ -0,0 +1,226 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksArenaStreaming.h"
+#include "SpaceRocksCollision.h"
+
+FSpaceRocksArenaStreaming::FSpaceRocksArenaStreaming()
+	: FrameBudgetMs(16.7f)
+	, ActiveArena(NAME_None)
+	, PreviousArena(NAME_None)
+	, bKeepPreviousArena(false)
+{
+}
+
+ULevelStreaming* FSpaceRocksArenaStreaming::FindStreamingLevel(UWorld* World, FName ArenaName)
+{
+	const FString ShortName = FPackageName::GetShortName(ArenaName.ToString());
+
+	for (int32 Index = 0; Index < World->StreamingLevels.Num(); Index++)
+	{
+		ULevelStreaming* const StreamingLevel = World->StreamingLevels[Index];
+		if (StreamingLevel == NULL)
+		{
+			continue;
+		}
+
+		// Package names have a prefix when playing in the editor
+		const FString PackageName = UWorld::RemovePIEPrefix(StreamingLevel->PackageName.ToString());
+		if (PackageName == ArenaName.ToString() || FPackageName::GetShortName(PackageName) == ShortName)
+		{
+			return StreamingLevel;
+		}
+	}
+	return NULL;
+}
+
+FSpaceRocksArenaStreaming::FArenaRequest* FSpaceRocksArenaStreaming::FindRequest(FName ArenaName)
+{
+	for (int32 Index = 0; Index < Requests.Num(); Index++)
+	{
+		if (Requests[Index].ArenaName == ArenaName)
+		{
+			return &Requests[Index];
+		}
+	}
+	return NULL;
+}
+
+FSpaceRocksArenaStreaming::FArenaRequest& FSpaceRocksArenaStreaming::AddRequest(FName ArenaName)
+{
+	FArenaRequest* const Existing = FindRequest(ArenaName);
+	if (Existing)
+	{
+		return *Existing;
+	}
+
+	FArenaRequest& Request = Requests[Requests.AddZeroed()];
+	Request.ArenaName = ArenaName;
+	Request.RequestTime = FPlatformTime::Seconds();
+	return Request;
+}
+
+bool FSpaceRocksArenaStreaming::Preload(UWorld* World, FName ArenaName)
+{
+	ULevelStreaming* const StreamingLevel = FindStreamingLevel(World, ArenaName);
+	if (StreamingLevel == NULL)
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Arena %s isn't a streaming level of %s"), *ArenaName.ToString(), *World->GetMapName());
+		return false;
+	}
+
+	// The arena we're switching away from is still loaded, and due to be unloaded once the new one is up - only hide it
+	// then (with two arenas, the next one to preload is always the one just left)
+	if (ArenaName == PreviousArena)
+	{
+		bKeepPreviousArena = true;
+		UE_LOG(LogFlying, Log, TEXT("Arena %s: kept loaded as the next arena"), *ArenaName.ToString());
+		return true;
+	}
+
+	if (StreamingLevel->bShouldBeLoaded)
+	{
+		// Already loaded or on its way
+		return true;
+	}
+
+	// (A level still loaded but no longer wanted is on its way out - asking for it again cancels that)
+
+	StreamingLevel->bShouldBlockOnLoad = false;
+	StreamingLevel->bShouldBeLoaded = true;
+	StreamingLevel->bShouldBeVisible = false;
+	AddRequest(ArenaName);
+
+	UE_LOG(LogFlying, Log, TEXT("Arena %s: preloading"), *ArenaName.ToString());
+	return true;
+}
+
+bool FSpaceRocksArenaStreaming::Activate(UWorld* World, FName ArenaName)
+{
+	if (ArenaName == ActiveArena)
+	{
+		return true;
+	}
+
+	ULevelStreaming* const StreamingLevel = FindStreamingLevel(World, ArenaName);
+	if (StreamingLevel == NULL)
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Arena %s isn't a streaming level of %s"), *ArenaName.ToString(), *World->GetMapName());
+		return false;
+	}
+
+	const bool bWasLoaded = (StreamingLevel->GetLoadedLevel() != NULL);
+	if (!bWasLoaded && !StreamingLevel->bShouldBeLoaded)
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Arena %s wasn't preloaded, it will pop in once loaded"), *ArenaName.ToString());
+	}
+
+	FArenaRequest& Request = AddRequest(ArenaName);
+	if (bWasLoaded && Request.LoadedTime == 0.0)
+	{
+		Request.LoadedTime = FPlatformTime::Seconds();
+	}
+	Request.ActivateTime = FPlatformTime::Seconds();
+
+	StreamingLevel->bShouldBlockOnLoad = false;
+	StreamingLevel->bShouldBeLoaded = true;
+	StreamingLevel->bShouldBeVisible = true;
+
+	// Switching again before the last switch finished - the arena from before that can go now
+	if (PreviousArena != NAME_None && PreviousArena != ArenaName)
+	{
+		ULevelStreaming* const StaleLevel = FindStreamingLevel(World, PreviousArena);
+		if (StaleLevel)
+		{
+			StaleLevel->bShouldBeVisible = false;
+			StaleLevel->bShouldBeLoaded = false;
+		}
+	}
+
+	// Keep the arena we're leaving until the new one is up
+	PreviousArena = ActiveArena;
+	bKeepPreviousArena = false;
+	ActiveArena = ArenaName;
+	return true;
+}
+
+void FSpaceRocksArenaStreaming::Tick(UWorld* World, float DeltaSeconds)
+{
+	const double Now = FPlatformTime::Seconds();
+	const float FrameMs = DeltaSeconds * 1000.f;
+
+	for (int32 Index = Requests.Num() - 1; Index >= 0; Index--)
+	{
+		FArenaRequest& Request = Requests[Index];
+		const FString ArenaName = Request.ArenaName.ToString();
+
+		ULevelStreaming* const StreamingLevel = FindStreamingLevel(World, Request.ArenaName);
+		if (StreamingLevel == NULL)
+		{
+			Requests.RemoveAt(Index);
+			continue;
+		}
+
+		ULevel* const Level = StreamingLevel->GetLoadedLevel();
+
+		// ** Loading, in the background **
+
+		if (Request.LoadedTime == 0.0)
+		{
+			if (Level == NULL)
+			{
+				Request.WorstLoadFrameMs = FMath::Max(Request.WorstLoadFrameMs, FrameMs);
+				continue;
+			}
+
+			Request.LoadedTime = Now;
+			UE_LOG(LogFlying, Log, TEXT("Arena %s: loaded in %.1f ms, worst frame while loading %.2f ms"),
+				*ArenaName, (Request.LoadedTime - Request.RequestTime) * 1000.0, Request.WorstLoadFrameMs);
+			if (Request.WorstLoadFrameMs > FrameBudgetMs)
+			{
+				UE_LOG(LogFlying, Warning, TEXT("Arena %s: loading went over the %.2f ms frame budget"), *ArenaName, FrameBudgetMs);
+			}
+		}
+
+		// Preloaded, waiting to be activated
+		if (Request.ActivateTime == 0.0)
+		{
+			continue;
+		}
+
+		// ** Activation, a few actors a frame **
+
+		if (Level == NULL || !Level->bIsVisible)
+		{
+			Request.ActivationFrames++;
+			Request.WorstActivationFrameMs = FMath::Max(Request.WorstActivationFrameMs, FrameMs);
+			continue;
+		}
+
+		UE_LOG(LogFlying, Log, TEXT("Arena %s: activated in %.1f ms over %d frames, worst frame %.2f ms"),
+			*ArenaName, (Now - FMath::Max(Request.ActivateTime, Request.LoadedTime)) * 1000.0, Request.ActivationFrames, Request.WorstActivationFrameMs);
+		if (Request.WorstActivationFrameMs > FrameBudgetMs)
+		{
+			UE_LOG(LogFlying, Warning, TEXT("Arena %s: activation went over the %.2f ms frame budget"), *ArenaName, FrameBudgetMs);
+		}
+
+		// Its walls collide as Arena, like the persistent level's
+		const int32 NumArenaMeshes = FSpaceRocksCollision::ApplyToArena(Level);
+		UE_LOG(LogFlying, Log, TEXT("Arena %s: %d static meshes set to the Arena collision profile"), *ArenaName, NumArenaMeshes);
+
+		// The new arena is up, so hide the old one, and let it go unless it has been preloaded as the next arena
+		if (Request.ArenaName == ActiveArena && PreviousArena != NAME_None)
+		{
+			ULevelStreaming* const PreviousLevel = FindStreamingLevel(World, PreviousArena);
+			if (PreviousLevel)
+			{
+				PreviousLevel->bShouldBeVisible = false;
+				PreviousLevel->bShouldBeLoaded = bKeepPreviousArena;
+			}
+			PreviousArena = NAME_None;
+			bKeepPreviousArena = false;
+		}
+
+		Requests.RemoveAt(Index);
+	}
+}
@@ -0,0 +1,304 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksBeltComponent.h"
+#include "SpaceRocksTasks.h"
+#include "SpaceRocksGameState.h"
+
+DEFINE_STAT(STAT_SpaceRocksBeltCull);
+DEFINE_STAT(STAT_SpaceRocksBeltAnimate);
+DEFINE_STAT(STAT_SpaceRocksBeltPush);
+
+USpaceRocksBeltComponent::USpaceRocksBeltComponent(const class FPostConstructInitializeProperties& PCIP)
+	: Super(PCIP)
+{
+	struct FConstructorStatics
+	{
+		ConstructorHelpers::FObjectFinderOptional<UStaticMesh> BeltMesh;
+		FConstructorStatics()
+			: BeltMesh(TEXT("StaticMesh'/Game/SpaceRocks/StaticMeshes/SM_Cave_Rock_Med_01a.SM_Cave_Rock_Med_01a'"))
+		{
+		}
+	};
+	static FConstructorStatics ConstructorStatics;
+
+	BeltMesh = ConstructorStatics.BeltMesh.Get();
+	NumInstances = 100000;
+	Seed = 1;
+	InnerRadius = 200000.f;
+	OuterRadius = 300000.f;
+	Thickness = 20000.f;
+	MinScale = 0.5f;
+	MaxScale = 5.f;
+	ClusterSize = 20000.f;
+	MaxSpinRate = 30.f;
+	DriftDistance = 500.f;
+	CullDistance = 250000.f;
+	NearDistance = 50000.f;
+	FarUpdateInterval = 8;
+
+	BeltTime = 0.f;
+	FrameCounter = 0;
+	NumVisibleClusters = 0;
+	NumInstancesPushed = 0;
+	AverageCullMs = 0.f;
+	AverageAnimateMs = 0.f;
+	AveragePushMs = 0.f;
+
+	bWantsInitializeComponent = true;
+	PrimaryComponentTick.bCanEverTick = true;
+}
+
+void USpaceRocksBeltComponent::InitializeComponent()
+{
+	Super::InitializeComponent();
+
+	BuildBelt();
+}
+
+void USpaceRocksBeltComponent::BuildBelt()
+{
+	if (BeltMesh == NULL || NumInstances <= 0 || GetOwner() == NULL)
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	// ** Place the rocks (uniform over the ring's area) and bin them into cluster cells **
+
+	FRandomStream Random(Seed);
+	const int32 CellsAcross = FMath::Max(FMath::CeilToInt((OuterRadius * 2.f) / ClusterSize), 1);
+
+	TArray<FBeltInstance> Unsorted;
+	TArray<int32> InstanceCells;
+	Unsorted.AddUninitialized(NumInstances);
+	InstanceCells.AddUninitialized(NumInstances);
+
+	const float InnerSquared = InnerRadius * InnerRadius;
+	const float OuterSquared = OuterRadius * OuterRadius;
+	for (int32 Index = 0; Index < NumInstances; Index++)
+	{
+		const float Radius = FMath::Sqrt(Random.FRandRange(InnerSquared, OuterSquared));
+		const float Angle = Random.FRandRange(0.f, 2.f * PI);
+
+		// Thicker in the middle of the ring
+		const float Height = (Random.FRand() + Random.FRand() - 1.f) * Thickness * 0.5f;
+
+		FBeltInstance& Instance = Unsorted[Index];
+		Instance.Home = FVector(FMath::Cos(Angle) * Radius, FMath::Sin(Angle) * Radius, Height);
+		Instance.DriftAxis = Random.GetUnitVector();
+		Instance.SpinAxis = Random.GetUnitVector();
+		Instance.SpinRate = FMath::DegreesToRadians(Random.FRandRange(-MaxSpinRate, MaxSpinRate));
+		Instance.Phase = Random.FRandRange(0.f, 2.f * PI);
+		Instance.Scale = FMath::Lerp(MinScale, MaxScale, FMath::Square(Random.FRand()));	// More small rocks than big
+
+		const int32 CellX = FMath::Clamp(FMath::FloorToInt((Instance.Home.X + OuterRadius) / ClusterSize), 0, CellsAcross - 1);
+		const int32 CellY = FMath::Clamp(FMath::FloorToInt((Instance.Home.Y + OuterRadius) / ClusterSize), 0, CellsAcross - 1);
+		InstanceCells[Index] = CellY * CellsAcross + CellX;
+	}
+
+	// Counting sort by cell, so each cluster is a contiguous run
+	TArray<int32> CellStart;
+	CellStart.AddZeroed(CellsAcross * CellsAcross + 1);
+	for (int32 Index = 0; Index < NumInstances; Index++)
+	{
+		CellStart[InstanceCells[Index] + 1]++;
+	}
+	for (int32 Cell = 0; Cell < CellsAcross * CellsAcross; Cell++)
+	{
+		CellStart[Cell + 1] += CellStart[Cell];
+	}
+
+	BeltInstances.Reset();
+	BeltInstances.AddUninitialized(NumInstances);
+	{
+		TArray<int32> CellNext = CellStart;
+		for (int32 Index = 0; Index < NumInstances; Index++)
+		{
+			BeltInstances[CellNext[InstanceCells[Index]]++] = Unsorted[Index];
+		}
+	}
+
+	// ** One instanced component per occupied cell **
+
+	const float MeshRadius = BeltMesh->GetBounds().SphereRadius;
+
+	Clusters.Reset();
+	ClusterComponents.Reset();
+	for (int32 Cell = 0; Cell < CellsAcross * CellsAcross; Cell++)
+	{
+		const int32 First = CellStart[Cell];
+		const int32 Num = CellStart[Cell + 1] - First;
+		if (Num == 0)
+		{
+			continue;
+		}
+
+		FBeltCluster Cluster;
+		Cluster.FirstInstance = First;
+		Cluster.NumInstances = Num;
+		Cluster.bVisible = true;
+
+		Cluster.Centre = FVector(0.f, 0.f, 0.f);
+		for (int32 Index = First; Index < First + Num; Index++)
+		{
+			Cluster.Centre += BeltInstances[Index].Home;
+		}
+		Cluster.Centre /= (float)Num;
+
+		Cluster.Radius = 0.f;
+		for (int32 Index = First; Index < First + Num; Index++)
+		{
+			const FBeltInstance& Instance = BeltInstances[Index];
+			Cluster.Radius = FMath::Max(Cluster.Radius, (Instance.Home - Cluster.Centre).Size() + DriftDistance + MeshRadius * Instance.Scale);
+		}
+
+		UInstancedStaticMeshComponent* const Instances = ConstructObject<UInstancedStaticMeshComponent>(UInstancedStaticMeshComponent::StaticClass(), GetOwner());
+		Instances->SetStaticMesh(BeltMesh);
+		Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Instances->SetCollisionResponseToAllChannels(ECR_Ignore);
+		Instances->CastShadow = false;
+		Instances->SetMobility(EComponentMobility::Movable);
+		Instances->AttachTo(this);
+		for (int32 Index = First; Index < First + Num; Index++)
+		{
+			Instances->AddInstance(FTransform(FRotator::ZeroRotator, BeltInstances[Index].Home, FVector(BeltInstances[Index].Scale)));
+		}
+		Instances->RegisterComponent();
+
+		Cluster.Instances = Instances;
+		Clusters.Add(Cluster);
+		ClusterComponents.Add(Instances);
+	}
+
+	UE_LOG(LogFlying, Log, TEXT("Belt: %d rocks in %d clusters, built in %.2f ms"), NumInstances, Clusters.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+void USpaceRocksBeltComponent::AnimateCluster(FBeltCluster& Cluster, float Time) const
+{
+	TArray<FInstancedStaticMeshInstanceData>& InstanceData = Cluster.Instances->PerInstanceSMData;
+
+	for (int32 Index = 0; Index < Cluster.NumInstances; Index++)
+	{
+		const FBeltInstance& Instance = BeltInstances[Cluster.FirstInstance + Index];
+
+		const FVector Location = Instance.Home + Instance.DriftAxis * (DriftDistance * FMath::Sin(Time * 0.2f + Instance.Phase));
+		const FQuat Rotation(Instance.SpinAxis, Instance.SpinRate * Time + Instance.Phase);
+		InstanceData[Index].Transform = FTransform(Rotation, Location, FVector(Instance.Scale)).ToMatrixWithScale();
+	}
+}
+
+void USpaceRocksBeltComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (Clusters.Num() == 0)
+	{
+		return;
+	}
+
+	BeltTime += DeltaTime;
+	FrameCounter++;
+
+	// ** Cull clusters against the cameras (distance and view cones), choosing which to animate **
+
+	double StartTime = FPlatformTime::Seconds();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpaceRocksBeltCull);
+
+		// Every local player's view, merged - a cluster is visible if any player can see it
+		FSpaceRocksViewSet LocalViews;
+		const ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+		if (GameState == NULL)
+		{
+			LocalViews.Gather(GetWorld());
+		}
+		const FSpaceRocksViewSet& Views = GameState ? GameState->GetViews() : LocalViews;
+
+		const FTransform& ComponentTransform = GetComponentTransform();
+		const float ComponentScale = ComponentTransform.GetMaximumAxisScale();
+
+		UpdateList.Reset();
+		NumVisibleClusters = 0;
+		for (int32 Index = 0; Index < Clusters.Num(); Index++)
+		{
+			FBeltCluster& Cluster = Clusters[Index];
+
+			const float Radius = Cluster.Radius * ComponentScale;
+			float Distance = 0.f;
+			const bool bVisible = Views.IsVisible(ComponentTransform.TransformPosition(Cluster.Centre), Radius, CullDistance, Distance);
+
+			if (bVisible != Cluster.bVisible)
+			{
+				Cluster.bVisible = bVisible;
+				Cluster.Instances->SetVisibility(bVisible);
+			}
+
+			if (bVisible)
+			{
+				NumVisibleClusters++;
+
+				// Near clusters every frame, far ones in turn
+				if (Distance - Radius < NearDistance || ((FrameCounter + Index) % FMath::Max(FarUpdateInterval, 1)) == 0)
+				{
+					UpdateList.Add(Index);
+				}
+			}
+		}
+	}
+	const float CullMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	// ** Spin and drift the chosen clusters on the task graph **
+
+	StartTime = FPlatformTime::Seconds();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpaceRocksBeltAnimate);
+
+		const float Time = BeltTime;
+		SpaceRocksParallelFor(UpdateList.Num(), [this, Time](int32 Index)
+		{
+			AnimateCluster(Clusters[UpdateList[Index]], Time);
+		}, 1);
+	}
+	const float AnimateMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	// ** Push the clusters that changed **
+
+	// The instanced component can't update part of its instance buffer, so each changed cluster's render proxy
+	// is rebuilt in full. That is done here rather than at the end of the frame, so the push is what gets timed.
+	StartTime = FPlatformTime::Seconds();
+	NumInstancesPushed = 0;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpaceRocksBeltPush);
+
+		for (int32 Index = 0; Index < UpdateList.Num(); Index++)
+		{
+			FBeltCluster& Cluster = Clusters[UpdateList[Index]];
+			Cluster.Instances->MarkRenderStateDirty();
+			Cluster.Instances->DoDeferredRenderUpdates_Concurrent();
+			NumInstancesPushed += Cluster.NumInstances;
+		}
+	}
+	const float PushMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	// Smoothed over about a second
+	const float Blend = 0.05f;
+	AverageCullMs = FMath::Lerp(AverageCullMs, CullMs, Blend);
+	AverageAnimateMs = FMath::Lerp(AverageAnimateMs, AnimateMs, Blend);
+	AveragePushMs = FMath::Lerp(AveragePushMs, PushMs, Blend);
+}
+
+void USpaceRocksBeltComponent::LogStats() const
+{
+	UE_LOG(LogFlying, Display, TEXT("Belt %s: %d rocks, %d clusters (%d visible), %d instances pushed last frame, cull %.3f ms, animate %.3f ms, push %.3f ms (%.3f ms per 10k instances)"),
+		*GetName(), BeltInstances.Num(), Clusters.Num(), NumVisibleClusters, NumInstancesPushed, AverageCullMs, AverageAnimateMs, AveragePushMs,
+		NumInstancesPushed > 0 ? AveragePushMs * 10000.f / NumInstancesPushed : 0.f);
+}
+
+ASpaceRocksBelt::ASpaceRocksBelt(const class FPostConstructInitializeProperties& PCIP)
+	: Super(PCIP)
+{
+	Belt = PCIP.CreateDefaultSubobject<USpaceRocksBeltComponent>(this, TEXT("Belt0"));
+	RootComponent = Belt;
+}
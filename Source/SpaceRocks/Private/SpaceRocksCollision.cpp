@@ -0,0 +1,266 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksCollision.h"
+#include "SpaceRocksRock.h"
+#include "SpaceRocksProjectile.h"
+#include "SpaceRocksPawn.h"
+
+#if WITH_PHYSX
+#include "PhysXIncludes.h"
+#endif
+
+const FName FSpaceRocksCollision::RockProfile(TEXT("SpaceRocksRock"));
+const FName FSpaceRocksCollision::ProjectileProfile(TEXT("SpaceRocksProjectile"));
+const FName FSpaceRocksCollision::PickupProfile(TEXT("SpaceRocksPickup"));
+const FName FSpaceRocksCollision::CraftProfile(TEXT("SpaceRocksCraft"));
+const FName FSpaceRocksCollision::ArenaProfile(TEXT("SpaceRocksArena"));
+
+// The engine's profile that rocks, projectiles and craft all used before
+static const FName LegacyProfile(TEXT("BlockAllDynamic"));
+
+const TCHAR* FSpaceRocksCollision::GetModeName(ESpaceRocksCollisionMode::Type Mode)
+{
+	switch (Mode)
+	{
+	case ESpaceRocksCollisionMode::Legacy:			return TEXT("Legacy");
+	case ESpaceRocksCollisionMode::Channels:		return TEXT("Channels");
+	case ESpaceRocksCollisionMode::QueryOnlyRocks:	return TEXT("QueryOnlyRocks");
+	default:										return TEXT("Unknown");
+	}
+}
+
+void FSpaceRocksCollision::ApplyToRock(ASpaceRocksRock* Rock, ESpaceRocksCollisionMode::Type Mode)
+{
+	// Switch to query only first (it reads the simulated velocity), or set the profile first (it resets CollisionEnabled)
+	const bool bQueryOnly = (Mode == ESpaceRocksCollisionMode::QueryOnlyRocks);
+	if (bQueryOnly)
+	{
+		Rock->SetQueryOnly(true);
+		Rock->RockMesh->SetCollisionProfileName(RockProfile);
+		Rock->RockMesh->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	}
+	else
+	{
+		Rock->RockMesh->SetCollisionProfileName(Mode == ESpaceRocksCollisionMode::Legacy ? LegacyProfile : RockProfile);
+		Rock->SetQueryOnly(false);
+	}
+}
+
+void FSpaceRocksCollision::ApplyToProjectile(ASpaceRocksProjectile* Projectile, ESpaceRocksCollisionMode::Type Mode)
+{
+	Projectile->CollisionComp->SetCollisionProfileName(Mode == ESpaceRocksCollisionMode::Legacy ? LegacyProfile : ProjectileProfile);
+	Projectile->CollisionComp->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+}
+
+void FSpaceRocksCollision::ApplyToCraft(ASpaceRocksPawn* Pawn, ESpaceRocksCollisionMode::Type Mode)
+{
+	Pawn->ShieldMesh->SetCollisionProfileName(Mode == ESpaceRocksCollisionMode::Legacy ? LegacyProfile : CraftProfile);
+}
+
+int32 FSpaceRocksCollision::ApplyToArena(ULevel* Level)
+{
+	int32 NumChanged = 0;
+	if (Level == NULL)
+	{
+		return NumChanged;
+	}
+
+	for (int32 ActorIndex = 0; ActorIndex < Level->Actors.Num(); ActorIndex++)
+	{
+		AActor* const Actor = Level->Actors[ActorIndex];
+		if (Actor == NULL || Actor->IsPendingKill())
+		{
+			continue;
+		}
+
+		TArray<UStaticMeshComponent*> Components;
+		Actor->GetComponents(Components);
+		for (int32 Index = 0; Index < Components.Num(); Index++)
+		{
+			UStaticMeshComponent* const Component = Components[Index];
+			if (Component->Mobility == EComponentMobility::Static
+				&& Component->IsCollisionEnabled()
+				&& Component->GetCollisionObjectType() == ECC_WorldStatic)
+			{
+				Component->SetCollisionProfileName(ArenaProfile);
+				NumChanged++;
+			}
+		}
+	}
+	return NumChanged;
+}
+
+FSpaceRocksPhysicsStats::FSpaceRocksPhysicsStats()
+	: World(NULL)
+	, StartTime(0.0)
+	, NumFrames(0)
+{
+	StartTick.Stats = this;
+	StartTick.bEnd = false;
+	StartTick.bCanEverTick = true;
+	StartTick.TickGroup = TG_StartPhysics;
+
+	EndTick.Stats = this;
+	EndTick.bEnd = true;
+	EndTick.bCanEverTick = true;
+	EndTick.TickGroup = TG_EndPhysics;
+}
+
+void FSpaceRocksPhysicsStats::Register(UWorld* InWorld)
+{
+	Unregister();
+
+	World = InWorld;
+	NumFrames = 0;
+	StartTime = 0.0;
+
+	// Straight after physics is kicked off, and straight after its results are fetched
+	StartTick.AddPrerequisite(World, World->StartPhysicsTickFunction);
+	StartTick.RegisterTickFunction(World->PersistentLevel);
+	EndTick.AddPrerequisite(World, World->EndPhysicsTickFunction);
+	EndTick.RegisterTickFunction(World->PersistentLevel);
+}
+
+void FSpaceRocksPhysicsStats::Unregister()
+{
+	if (World)
+	{
+		StartTick.RemovePrerequisite(World, World->StartPhysicsTickFunction);
+		StartTick.UnRegisterTickFunction();
+		EndTick.RemovePrerequisite(World, World->EndPhysicsTickFunction);
+		EndTick.UnRegisterTickFunction();
+		World = NULL;
+	}
+}
+
+void FSpaceRocksPhysicsStats::OnStartPhysics()
+{
+	StartTime = FPlatformTime::Seconds();
+}
+
+void FSpaceRocksPhysicsStats::OnEndPhysics()
+{
+	if (StartTime == 0.0)
+	{
+		return;
+	}
+
+	FSpaceRocksPhysicsFrame Frame;
+	Frame.KickoffToFetchMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	StartTime = 0.0;
+
+#if WITH_PHYSX
+	FPhysScene* const PhysScene = World->GetPhysicsScene();
+	PxScene* const Scene = PhysScene ? PhysScene->GetPhysXScene(PST_Sync) : NULL;
+	if (Scene)
+	{
+		PxSimulationStatistics SimStats;
+		Scene->lockRead();
+		Scene->getSimulationStatistics(SimStats);
+		Scene->unlockRead();
+
+		Frame.ContactPairs = SimStats.nbDiscreteContactPairsTotal;
+		Frame.TouchingPairs = SimStats.nbDiscreteContactPairsWithContacts;
+		Frame.NewPairs = SimStats.nbNewPairs;
+		Frame.DynamicBodies = SimStats.nbDynamicBodies;
+	}
+#endif
+
+	LastFrame = Frame;
+	NumFrames++;
+}
+
+void FSpaceRocksPhysicsStats::FTimerTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (bEnd)
+	{
+		Stats->OnEndPhysics();
+	}
+	else
+	{
+		Stats->OnStartPhysics();
+	}
+}
+
+FString FSpaceRocksPhysicsStats::FTimerTickFunction::DiagnosticMessage()
+{
+	return bEnd ? TEXT("FSpaceRocksPhysicsStats[End]") : TEXT("FSpaceRocksPhysicsStats[Start]");
+}
+
+FSpaceRocksCollisionBench::FSpaceRocksCollisionBench()
+	: FramesPerMode(0)
+	, Mode(0)
+	, Frame(0)
+{
+}
+
+ESpaceRocksCollisionMode::Type FSpaceRocksCollisionBench::Start(int32 InFramesPerMode)
+{
+	FramesPerMode = FMath::Max(InFramesPerMode, 1);
+	Mode = 0;
+	Frame = -SETTLE_FRAMES;
+
+	for (int32 Index = 0; Index < ESpaceRocksCollisionMode::NUM_MODES; Index++)
+	{
+		KickoffToFetchMs[Index] = 0.0;
+		ContactPairs[Index] = 0.0;
+		TouchingPairs[Index] = 0.0;
+		NewPairs[Index] = 0.0;
+		DynamicBodies[Index] = 0.0;
+	}
+
+	return (ESpaceRocksCollisionMode::Type)Mode;
+}
+
+bool FSpaceRocksCollisionBench::Update(const FSpaceRocksPhysicsFrame& LastFrame, ESpaceRocksCollisionMode::Type& OutMode)
+{
+	if (!IsRunning())
+	{
+		return false;
+	}
+
+	// The last step ran in the current mode
+	if (Frame >= 0)
+	{
+		KickoffToFetchMs[Mode] += LastFrame.KickoffToFetchMs;
+		ContactPairs[Mode] += LastFrame.ContactPairs;
+		TouchingPairs[Mode] += LastFrame.TouchingPairs;
+		NewPairs[Mode] += LastFrame.NewPairs;
+		DynamicBodies[Mode] += LastFrame.DynamicBodies;
+	}
+
+	Frame++;
+	if (Frame < FramesPerMode)
+	{
+		return false;
+	}
+
+	// ** Next mode, or done **
+
+	Mode++;
+	if (Mode < ESpaceRocksCollisionMode::NUM_MODES)
+	{
+		Frame = -SETTLE_FRAMES;
+		OutMode = (ESpaceRocksCollisionMode::Type)Mode;
+		return true;
+	}
+
+	LogResults();
+	FramesPerMode = 0;
+	return true;
+}
+
+void FSpaceRocksCollisionBench::LogResults() const
+{
+	const double Legacy = FMath::Max(ContactPairs[ESpaceRocksCollisionMode::Legacy] / FramesPerMode, 1.0);
+
+	UE_LOG(LogFlying, Display, TEXT("Collision benchmark: averages over %d frames per mode"), FramesPerMode);
+	for (int32 Index = 0; Index < ESpaceRocksCollisionMode::NUM_MODES; Index++)
+	{
+		const double Pairs = ContactPairs[Index] / FramesPerMode;
+		UE_LOG(LogFlying, Display, TEXT("  %-15s physics kickoff to fetch %.3f ms, %.0f contact pairs (%.0f%% of legacy), %.0f touching, %.1f new pairs/frame, %.0f simulated bodies"),
+			FSpaceRocksCollision::GetModeName((ESpaceRocksCollisionMode::Type)Index), KickoffToFetchMs[Index] / FramesPerMode,
+			Pairs, 100.0 * Pairs / Legacy, TouchingPairs[Index] / FramesPerMode, NewPairs[Index] / FramesPerMode, DynamicBodies[Index] / FramesPerMode);
+	}
+}
@@ -0,0 +1,84 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksDamage.h"
+
+DEFINE_STAT(STAT_SpaceRocksDamageResolve);
+
+void FSpaceRocksDamageQueue::Add(AActor* Target, float Amount, const FVector& Location, int32 InstigatorId)
+{
+	if (Target == NULL)
+	{
+		return;
+	}
+
+	new(Events) FSpaceRocksDamageEvent(Target, Amount, InstigatorId, Location);
+}
+
+int32 FSpaceRocksDamageQueue::Gather(TArray<FSpaceRocksTargetDamage>& OutDamage)
+{
+	OutDamage.Reset();
+
+	const int32 NumHits = Events.Num();
+	if (NumHits == 0)
+	{
+		return 0;
+	}
+
+	// ** One entry per hit on a live target **
+
+	for (int32 Index = 0; Index < NumHits; Index++)
+	{
+		const FSpaceRocksDamageEvent& Event = Events[Index];
+		AActor* const Target = Event.Target.Get();
+		if (Target == NULL)
+		{
+			continue;
+		}
+
+		FSpaceRocksTargetDamage& Damage = OutDamage[OutDamage.AddUninitialized()];
+		Damage.Target = Target;
+		Damage.Amount = Event.Amount;
+		Damage.BiggestHit = Event.Amount;
+		Damage.NumHits = 1;
+		Damage.InstigatorId = Event.InstigatorId;
+		Damage.Location = Event.Location;
+	}
+	Events.Reset();
+
+	// ** Sort by target and merge each run in place **
+
+	struct FCompareTarget
+	{
+		FORCEINLINE bool operator()(const FSpaceRocksTargetDamage& A, const FSpaceRocksTargetDamage& B) const
+		{
+			return A.Target < B.Target;
+		}
+	};
+	OutDamage.Sort(FCompareTarget());
+
+	int32 NumTargets = 0;
+	for (int32 Index = 0; Index < OutDamage.Num(); Index++)
+	{
+		const FSpaceRocksTargetDamage& Hit = OutDamage[Index];
+		if (NumTargets > 0 && OutDamage[NumTargets - 1].Target == Hit.Target)
+		{
+			FSpaceRocksTargetDamage& Merged = OutDamage[NumTargets - 1];
+			if (Hit.Amount > Merged.BiggestHit)
+			{
+				Merged.BiggestHit = Hit.Amount;
+				Merged.InstigatorId = Hit.InstigatorId;
+				Merged.Location = Hit.Location;
+			}
+			Merged.Amount += Hit.Amount;
+			Merged.NumHits++;
+		}
+		else
+		{
+			OutDamage[NumTargets++] = Hit;
+		}
+	}
+	OutDamage.RemoveAt(NumTargets, OutDamage.Num() - NumTargets);
+
+	return NumHits;
+}
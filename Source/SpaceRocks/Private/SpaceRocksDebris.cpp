@@ -0,0 +1,306 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksDebris.h"
+#include "SpaceRocksTasks.h"
+#include "SpaceRocksTrace.h"
+
+DEFINE_STAT(STAT_SpaceRocksDebrisSimulate);
+DEFINE_STAT(STAT_SpaceRocksDebrisPush);
+
+ASpaceRocksDebris::ASpaceRocksDebris(const class FPostConstructInitializeProperties& PCIP)
+	: Super(PCIP)
+{
+	struct FConstructorStatics
+	{
+		ConstructorHelpers::FObjectFinderOptional<UStaticMesh> SparkMesh;
+		ConstructorHelpers::FObjectFinderOptional<UStaticMesh> ChunkMesh;
+		FConstructorStatics()
+			: SparkMesh(TEXT("StaticMesh'/Game/SpaceRocks/StaticMeshes/SM_Simple_Sphere.SM_Simple_Sphere'"))
+			, ChunkMesh(TEXT("StaticMesh'/Game/SpaceRocks/StaticMeshes/SM_Cave_Rock_Med_01a.SM_Cave_Rock_Med_01a'"))
+		{
+		}
+	};
+	static FConstructorStatics ConstructorStatics;
+
+	// Instanced components are attached to this, at the origin, so instance space is world space
+	RootComponent = PCIP.CreateDefaultSubobject<USceneComponent>(this, TEXT("SceneComp0"));
+
+	MaxChunks = 2048;
+	MaxSpawnsPerFrame = 256;
+	UpdateBudgetMs = 0.5f;
+	ChunksPerExplosion = 12;
+	SparksPerExplosion = 16;
+	SparksPerShieldHit = 8;
+	ChunkLifetime = 3.f;
+	SparkLifetime = 0.6f;
+	ChunkSpeed = 600.f;
+	SparkSpeed = 2500.f;
+	Drag = 0.5f;
+	SparkMesh = ConstructorStatics.SparkMesh.Get();
+	DefaultChunkMesh = ConstructorStatics.ChunkMesh.Get();
+
+	Oldest = 0;
+	NumLive = 0;
+	ChunkCap = 0;
+	SpawnsThisFrame = 0;
+	AverageUpdateMs = 0.f;
+	NumRecycled = 0;
+	NumDropped = 0;
+	PeakLive = 0;
+	NumInstancesShown = 0;
+
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+int32 ASpaceRocksDebris::FindOrAddMesh(UStaticMesh* Mesh)
+{
+	const int32 Existing = DebrisMeshes.Find(Mesh);
+	if (Existing != INDEX_NONE)
+	{
+		return Existing;
+	}
+
+	UInstancedStaticMeshComponent* const Instances = ConstructObject<UInstancedStaticMeshComponent>(UInstancedStaticMeshComponent::StaticClass(), this);
+	Instances->SetStaticMesh(Mesh);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->CastShadow = false;
+	Instances->AttachTo(RootComponent);
+	Instances->RegisterComponent();
+
+	DebrisMeshes.Add(Mesh);
+	DebrisInstances.Add(Instances);
+	MeshTransforms.Add(TArray<FMatrix>());
+	MeshInstanceCounts.Add(0);
+	return DebrisMeshes.Num() - 1;
+}
+
+bool ASpaceRocksDebris::AddChunk(const FVector& Position, const FVector& Velocity, float Size, float Lifetime, int32 Mesh)
+{
+	if (SpawnsThisFrame >= MaxSpawnsPerFrame || MaxChunks <= 0)
+	{
+		NumDropped++;
+		return false;
+	}
+	SpawnsThisFrame++;
+
+	if (Chunks.Num() != MaxChunks)
+	{
+		// First use (or MaxChunks was changed) - start with an empty ring
+		Chunks.Empty(MaxChunks);
+		Chunks.AddUninitialized(MaxChunks);
+		Oldest = 0;
+		NumLive = 0;
+		ChunkCap = MaxChunks;
+	}
+
+	// Full, so the oldest piece makes way
+	RecycleOldest(FMath::Max(ChunkCap, 1) - 1);
+
+	FDebrisChunk& Chunk = Chunks[(Oldest + NumLive) % MaxChunks];
+	NumLive++;
+	PeakLive = FMath::Max(PeakLive, NumLive);
+
+	Chunk.Position = Position;
+	Chunk.Velocity = Velocity;
+	Chunk.Rotation = FQuat(FMath::VRand(), FMath::FRandRange(0.f, 2.f * PI));
+	Chunk.Spin = FQuat(FMath::VRand(), FMath::FRandRange(-PI, PI));
+	Chunk.Size = Size;
+	Chunk.Age = 0.f;
+	Chunk.Lifetime = Lifetime * FMath::FRandRange(0.75f, 1.25f);
+	Chunk.Mesh = Mesh;
+	return true;
+}
+
+void ASpaceRocksDebris::RecycleOldest(int32 Limit)
+{
+	while (NumLive > FMath::Max(Limit, 0))
+	{
+		// Only count pieces that hadn't already burnt out
+		if (Chunks[Oldest].Age < Chunks[Oldest].Lifetime)
+		{
+			NumRecycled++;
+		}
+		Oldest = (Oldest + 1) % MaxChunks;
+		NumLive--;
+	}
+}
+
+void ASpaceRocksDebris::AddRockExplosion(const FVector& Location, const FVector& Velocity, float Radius, UStaticMesh* RockMesh)
+{
+	UStaticMesh* const ChunkMesh = RockMesh ? RockMesh : DefaultChunkMesh;
+	const float Scale = FMath::Clamp(Radius / 100.f, 0.5f, 4.f);
+
+	if (ChunkMesh)
+	{
+		const int32 Mesh = FindOrAddMesh(ChunkMesh);
+		const float MeshRadius = FMath::Max(ChunkMesh->GetBounds().SphereRadius, 1.f);
+		const int32 NumChunks = FMath::RoundToInt(ChunksPerExplosion * Scale);
+		for (int32 Index = 0; Index < NumChunks; Index++)
+		{
+			// Chunks start inside the rock and fly outwards, carrying on with the rock's velocity
+			const FVector Direction = FMath::VRand();
+			const float ChunkRadius = Radius * FMath::FRandRange(0.15f, 0.35f);
+			if (!AddChunk(Location + Direction * (Radius * 0.5f), Velocity + Direction * (ChunkSpeed * FMath::FRandRange(0.5f, 1.f)), ChunkRadius / MeshRadius, ChunkLifetime, Mesh))
+			{
+				return;
+			}
+		}
+	}
+
+	if (SparkMesh)
+	{
+		const int32 Mesh = FindOrAddMesh(SparkMesh);
+		const float MeshRadius = FMath::Max(SparkMesh->GetBounds().SphereRadius, 1.f);
+		const int32 NumSparks = FMath::RoundToInt(SparksPerExplosion * Scale);
+		for (int32 Index = 0; Index < NumSparks; Index++)
+		{
+			const FVector Direction = FMath::VRand();
+			if (!AddChunk(Location, Velocity + Direction * (SparkSpeed * FMath::FRandRange(0.5f, 1.f)), FMath::FRandRange(4.f, 10.f) / MeshRadius, SparkLifetime, Mesh))
+			{
+				return;
+			}
+		}
+	}
+}
+
+void ASpaceRocksDebris::AddShieldHit(const FVector& Location, const FVector& Normal, const FVector& Velocity)
+{
+	if (SparkMesh == NULL)
+	{
+		return;
+	}
+
+	const int32 Mesh = FindOrAddMesh(SparkMesh);
+	const float MeshRadius = FMath::Max(SparkMesh->GetBounds().SphereRadius, 1.f);
+	for (int32 Index = 0; Index < SparksPerShieldHit; Index++)
+	{
+		// Spray off the shield in a cone round the hit normal
+		const FVector Direction = FMath::VRandCone(Normal, FMath::DegreesToRadians(60.f));
+		if (!AddChunk(Location, Velocity + Direction * (SparkSpeed * FMath::FRandRange(0.3f, 0.8f)), FMath::FRandRange(3.f, 6.f) / MeshRadius, SparkLifetime, Mesh))
+		{
+			return;
+		}
+	}
+}
+
+void ASpaceRocksDebris::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SpawnsThisFrame = 0;
+	if (NumLive == 0 && NumInstancesShown == 0)
+	{
+		return;
+	}
+
+	SPACEROCKS_TRACE_SCOPE(Debris);
+	const double StartTime = FPlatformTime::Seconds();
+
+	// ** Keep within the cap, then drop burnt out pieces from the old end **
+
+	RecycleOldest(ChunkCap);
+	while (NumLive > 0 && Chunks[Oldest].Age >= Chunks[Oldest].Lifetime)
+	{
+		Oldest = (Oldest + 1) % MaxChunks;
+		NumLive--;
+	}
+
+	// ** Simulate, straight through the ring **
+
+	if (NumLive > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpaceRocksDebrisSimulate);
+
+		const float DragScale = FMath::Max(1.f - Drag * DeltaSeconds, 0.f);
+		SpaceRocksParallelFor(NumLive, [&](int32 Index)
+		{
+			FDebrisChunk& Chunk = Chunks[(Oldest + Index) % MaxChunks];
+			Chunk.Age += DeltaSeconds;
+			Chunk.Position += Chunk.Velocity * DeltaSeconds;
+			Chunk.Velocity *= DragScale;
+			Chunk.Rotation = FQuat::Slerp(FQuat::Identity, Chunk.Spin, DeltaSeconds) * Chunk.Rotation;
+		}, 512);
+	}
+
+	PushInstances();
+
+	// ** Over budget? Recycle the oldest pieces early. Under budget, let the cap back up over about a second. **
+
+	const float UpdateMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	if (UpdateMs > UpdateBudgetMs && NumLive > 0)
+	{
+		ChunkCap = FMath::Clamp((int32)(NumLive * (UpdateBudgetMs / UpdateMs) * 0.9f), FMath::Min(MaxSpawnsPerFrame, MaxChunks), MaxChunks);
+	}
+	else
+	{
+		ChunkCap = FMath::Min(ChunkCap + FMath::Max(MaxChunks / 60, 1), MaxChunks);
+	}
+
+	AverageUpdateMs = FMath::Lerp(AverageUpdateMs, UpdateMs, 0.05f);
+}
+
+void ASpaceRocksDebris::PushInstances()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpaceRocksDebrisPush);
+
+	for (int32 Mesh = 0; Mesh < MeshTransforms.Num(); Mesh++)
+	{
+		MeshTransforms[Mesh].Reset();
+	}
+
+	// Gather each mesh's transforms. Pieces shrink away over the last quarter of their life.
+	for (int32 Index = 0; Index < NumLive; Index++)
+	{
+		const FDebrisChunk& Chunk = Chunks[(Oldest + Index) % MaxChunks];
+		const float Remaining = Chunk.Lifetime - Chunk.Age;
+		if (Remaining > 0.f)
+		{
+			const float Size = Chunk.Size * FMath::Min(Remaining / (0.25f * Chunk.Lifetime), 1.f);
+			MeshTransforms[Chunk.Mesh].Add(FTransform(Chunk.Rotation, Chunk.Position, FVector(Size)).ToMatrixWithScale());
+		}
+	}
+
+	// Instances are reused from frame to frame, only added when a mesh needs more than it ever has
+	const FMatrix Hidden = FTransform(FRotator::ZeroRotator, FVector::ZeroVector, FVector(0.f, 0.f, 0.f)).ToMatrixWithScale();
+	NumInstancesShown = 0;
+	for (int32 Mesh = 0; Mesh < DebrisInstances.Num(); Mesh++)
+	{
+		UInstancedStaticMeshComponent* const Instances = DebrisInstances[Mesh];
+		const TArray<FMatrix>& Transforms = MeshTransforms[Mesh];
+
+		// Nothing shown last frame or this one
+		if (Transforms.Num() == 0 && MeshInstanceCounts[Mesh] == 0)
+		{
+			continue;
+		}
+
+		for (int32 Instance = Instances->GetInstanceCount(); Instance < Transforms.Num(); Instance++)
+		{
+			Instances->AddInstance(FTransform::Identity);
+		}
+
+		TArray<FInstancedStaticMeshInstanceData>& InstanceData = Instances->PerInstanceSMData;
+		for (int32 Instance = 0; Instance < Transforms.Num(); Instance++)
+		{
+			InstanceData[Instance].Transform = Transforms[Instance];
+		}
+
+		// Hide the ones shown last frame that aren't needed now
+		for (int32 Instance = Transforms.Num(); Instance < MeshInstanceCounts[Mesh]; Instance++)
+		{
+			InstanceData[Instance].Transform = Hidden;
+		}
+
+		Instances->MarkRenderStateDirty();
+		MeshInstanceCounts[Mesh] = Transforms.Num();
+		NumInstancesShown += Transforms.Num();
+	}
+}
+
+void ASpaceRocksDebris::LogStats() const
+{
+	UE_LOG(LogFlying, Display, TEXT("Debris: %d live (cap %d of %d, peak %d), %d meshes, %d recycled early, %d dropped, update %.3f ms (budget %.3f ms)"),
+		NumLive, ChunkCap, MaxChunks, PeakLive, DebrisMeshes.Num(), NumRecycled, NumDropped, AverageUpdateMs, UpdateBudgetMs);
+}
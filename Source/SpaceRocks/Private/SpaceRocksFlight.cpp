@@ -0,0 +1,585 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksFlight.h"
+#include "SpaceRocksTasks.h"
+#include "AutomationTest.h"
+
+FSpaceRocksFlightParams::FSpaceRocksFlightParams()
+	: Acceleration(1000.f)
+	, Deceleration(50.f)
+	, TurnSpeed(100.f)
+	, ReturnSpeed(0.f)
+	, MinSpeed(-4000.f)
+	, MaxSpeed(4000.f)
+	, AxisSmoothing(5.f)
+{
+}
+
+// ** Kernels **
+
+float FSpaceRocksFlight::CalcThrust(const FSpaceRocksFlightParams& Params, float InputVal, float Factor, float CurrentAxisSpeed, float DeltaSeconds)
+{
+	float CurrentAcc = 0.f;
+
+	// Is there no input?
+	const bool bHasInput = !FMath::IsNearlyEqual(InputVal, 0.f);
+
+	if (bHasInput)
+	{
+		CurrentAcc = (InputVal * Params.Acceleration) * Factor;
+	}
+	else
+	{
+		// Slow down
+		CurrentAcc = FMath::IsNegativeFloat(CurrentAxisSpeed) ? 0.5f * Params.Deceleration : -0.5f * Params.Deceleration;
+	}
+
+	const float NewSpeed = CurrentAxisSpeed + (DeltaSeconds * CurrentAcc);
+	return FMath::Clamp(NewSpeed, Params.MinSpeed, Params.MaxSpeed);
+}
+
+FVector FSpaceRocksFlight::ApplyThrust(const FSpaceRocksFlightParams& Params, float InputVal, const FVector& ThrustAxis, const FVector& Velocity, float DeltaSeconds)
+{
+	// Each axis speeds up by how much the thruster points along it
+	return FVector(
+		CalcThrust(Params, InputVal, ThrustAxis.X, Velocity.X, DeltaSeconds),
+		CalcThrust(Params, InputVal, ThrustAxis.Y, Velocity.Y, DeltaSeconds),
+		CalcThrust(Params, InputVal, ThrustAxis.Z, Velocity.Z, DeltaSeconds));
+}
+
+float FSpaceRocksFlight::TargetPitchRate(const FSpaceRocksFlightParams& Params, float InputVal, float CurrentPitch)
+{
+	// If not turning, pitch to reverse current pitch value
+	return !FMath::IsNearlyEqual(InputVal, 0.f) ? (InputVal * Params.TurnSpeed * -1.f) : (CurrentPitch * -Params.ReturnSpeed);
+}
+
+float FSpaceRocksFlight::TargetYawRate(const FSpaceRocksFlightParams& Params, float InputVal)
+{
+	// If not turning, don't do anything - We don't reset yaw like we do pitch and roll
+	return !FMath::IsNearlyEqual(InputVal, 0.f) ? (InputVal * Params.TurnSpeed) : 0.f;
+}
+
+float FSpaceRocksFlight::TargetRollRate(const FSpaceRocksFlightParams& Params, float InputVal, float CurrentRoll)
+{
+	// If not turning, roll to reverse current roll value
+	return !FMath::IsNearlyEqual(InputVal, 0.f) ? (InputVal * Params.TurnSpeed) : (CurrentRoll * -Params.ReturnSpeed);
+}
+
+float FSpaceRocksFlight::SmoothTurnRate(const FSpaceRocksFlightParams& Params, float CurrentRate, float TargetRate, float DeltaSeconds)
+{
+	return FMath::Clamp(FMath::FInterpTo(CurrentRate, TargetRate, DeltaSeconds, Params.AxisSmoothing), Params.MinSpeed, Params.MaxSpeed);
+}
+
+float FSpaceRocksFlight::AddDegrees(float StartDegrees, float DegreesToAdd)
+{
+	const float Degrees = FMath::Fmod(StartDegrees + DegreesToAdd, 360.f);
+	return (Degrees < 0.f) ? Degrees + 360.f : Degrees;
+}
+
+float FSpaceRocksFlight::CalcFactor_yaw(float CraftAngle, float OffsetDegrees)
+{
+	return FMath::Cos(FMath::DegreesToRadians(AddDegrees(CraftAngle, OffsetDegrees)));
+}
+
+float FSpaceRocksFlight::CalcFactor_pitch(float CraftAngle)
+{
+	return FMath::Cos(FMath::DegreesToRadians(FMath::Clamp(CraftAngle, -90.f, 90.f)));
+}
+
+float FSpaceRocksFlight::CalcFactor_roll(float CraftAngle)
+{
+	return FMath::Cos(FMath::DegreesToRadians(CraftAngle));
+}
+
+// ** Whole frames **
+
+void FSpaceRocksFlight::ApplyControls(const FSpaceRocksFlightParams& Params, const FSpaceRocksFlightInput& Input, FSpaceRocksFlightState& State, float DeltaSeconds)
+{
+	// Same order as the pawn's axis bindings: orientation thrusters, then directional thrusters
+	State.TurnRate.Pitch = SmoothTurnRate(Params, State.TurnRate.Pitch, TargetPitchRate(Params, Input.Pitch, State.Rotation.Pitch), DeltaSeconds);
+	State.TurnRate.Roll = SmoothTurnRate(Params, State.TurnRate.Roll, TargetRollRate(Params, Input.Roll, State.Rotation.Roll), DeltaSeconds);
+	State.TurnRate.Yaw = SmoothTurnRate(Params, State.TurnRate.Yaw, TargetYawRate(Params, Input.Yaw), DeltaSeconds);
+
+	const FRotationMatrix Axes(State.Rotation);
+	State.Velocity = ApplyThrust(Params, Input.Rear, Axes.GetScaledAxis(EAxis::X), State.Velocity, DeltaSeconds);
+	State.Velocity = ApplyThrust(Params, Input.Side, Axes.GetScaledAxis(EAxis::Y), State.Velocity, DeltaSeconds);
+	State.Velocity = ApplyThrust(Params, Input.Bottom, Axes.GetScaledAxis(EAxis::Z), State.Velocity, DeltaSeconds);
+}
+
+void FSpaceRocksFlight::Integrate(FSpaceRocksFlightState& State, float DeltaSeconds)
+{
+	State.Location += State.Velocity * DeltaSeconds;
+
+	// As AddLocalRotation does it
+	const FRotator DeltaRotation(State.TurnRate.Pitch * DeltaSeconds, State.TurnRate.Yaw * DeltaSeconds, State.TurnRate.Roll * DeltaSeconds);
+	State.Rotation = (State.Rotation.Quaternion() * DeltaRotation.Quaternion()).Rotator();
+}
+
+void FSpaceRocksFlight::Step(const FSpaceRocksFlightParams& Params, const FSpaceRocksFlightInput& Input, FSpaceRocksFlightState& State, float DeltaSeconds)
+{
+	ApplyControls(Params, Input, State, DeltaSeconds);
+	Integrate(State, DeltaSeconds);
+}
+
+void FSpaceRocksFlight::StepBatch(const FSpaceRocksFlightParams& Params, const FSpaceRocksFlightInput* Inputs, FSpaceRocksFlightState* States, int32 Num, float DeltaSeconds)
+{
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		Step(Params, Inputs[Index], States[Index], DeltaSeconds);
+	}
+}
+
+// ** Checks **
+
+namespace
+{
+	// Hold an input for a number of frames
+	struct FFlightSegment
+	{
+		int32 NumFrames;
+		FSpaceRocksFlightInput Input;
+	};
+
+	struct FFlightScript
+	{
+		FString Name;
+		FSpaceRocksFlightParams Params;
+		float DeltaSeconds;
+		TArray<FFlightSegment> Segments;
+
+		FFlightScript(const TCHAR* InName, float InDeltaSeconds)
+			: Name(InName)
+			, DeltaSeconds(InDeltaSeconds)
+		{
+		}
+
+		FFlightScript& Hold(int32 NumFrames, float Pitch, float Yaw, float Roll, float Rear, float Side, float Bottom)
+		{
+			FFlightSegment Segment;
+			Segment.NumFrames = NumFrames;
+			Segment.Input.Pitch = Pitch;
+			Segment.Input.Yaw = Yaw;
+			Segment.Input.Roll = Roll;
+			Segment.Input.Rear = Rear;
+			Segment.Input.Side = Side;
+			Segment.Input.Bottom = Bottom;
+			Segments.Add(Segment);
+			return *this;
+		}
+	};
+
+	void BuildScripts(TArray<FFlightScript>& Scripts)
+	{
+		// Full rear thrust, then coast
+		Scripts.Add(FFlightScript(TEXT("ThrustAndCoast"), 1.f / 60.f));
+		Scripts.Last()
+			.Hold(60, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f)
+			.Hold(120, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f);
+
+		// Each orientation thruster in turn
+		Scripts.Add(FFlightScript(TEXT("Turns"), 1.f / 60.f));
+		Scripts.Last()
+			.Hold(30, 1.f, 0.f, 0.f, 0.f, 0.f, 0.f)
+			.Hold(30, 0.f, -1.f, 0.f, 0.f, 0.f, 0.f)
+			.Hold(30, 0.f, 0.f, 0.5f, 0.f, 0.f, 0.f)
+			.Hold(60, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f);
+
+		// Strafe, then thrust while turning so the thrust direction sweeps round
+		Scripts.Add(FFlightScript(TEXT("StrafeAndCarve"), 1.f / 60.f));
+		Scripts.Last()
+			.Hold(45, 0.f, 0.f, 0.f, 0.f, 1.f, -1.f)
+			.Hold(90, 0.f, 1.f, 0.f, 0.5f, 0.f, 0.f)
+			.Hold(90, -0.5f, 0.f, 1.f, 1.f, -0.25f, 0.f)
+			.Hold(60, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f);
+
+		// Pitch and roll return to level on their own
+		Scripts.Add(FFlightScript(TEXT("ReturnToLevel"), 1.f / 60.f));
+		Scripts.Last().Params.ReturnSpeed = 2.f;
+		Scripts.Last()
+			.Hold(40, 1.f, 0.f, -1.f, 0.f, 0.f, 0.f)
+			.Hold(180, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f);
+
+		// Random stick work at a low frame rate
+		Scripts.Add(FFlightScript(TEXT("RandomLowFrameRate"), 1.f / 24.f));
+		FRandomStream Random(36);
+		for (int32 Segment = 0; Segment < 24; Segment++)
+		{
+			// Inputs snapped to quarters, as a keyboard or a coarse stick gives them
+			float Inputs[6];
+			for (int32 Axis = 0; Axis < 6; Axis++)
+			{
+				Inputs[Axis] = (Random.FRand() < 0.4f) ? 0.f : FMath::RoundToFloat(Random.FRandRange(-4.f, 4.f)) * 0.25f;
+			}
+			Scripts.Last().Hold(Random.RandRange(3, 20), Inputs[0], Inputs[1], Inputs[2], Inputs[3], Inputs[4], Inputs[5]);
+		}
+	}
+
+	// The values recorded each frame
+	const int32 NumTrajectoryValues = 12;
+	const TCHAR* TrajectoryValueNames[NumTrajectoryValues] =
+	{
+		TEXT("X"), TEXT("Y"), TEXT("Z"), TEXT("Pitch"), TEXT("Yaw"), TEXT("Roll"),
+		TEXT("VX"), TEXT("VY"), TEXT("VZ"), TEXT("PitchRate"), TEXT("YawRate"), TEXT("RollRate")
+	};
+
+	void GetTrajectoryValues(const FSpaceRocksFlightState& State, float* Values)
+	{
+		Values[0] = State.Location.X;
+		Values[1] = State.Location.Y;
+		Values[2] = State.Location.Z;
+		Values[3] = State.Rotation.Pitch;
+		Values[4] = State.Rotation.Yaw;
+		Values[5] = State.Rotation.Roll;
+		Values[6] = State.Velocity.X;
+		Values[7] = State.Velocity.Y;
+		Values[8] = State.Velocity.Z;
+		Values[9] = State.TurnRate.Pitch;
+		Values[10] = State.TurnRate.Yaw;
+		Values[11] = State.TurnRate.Roll;
+	}
+
+	// Fly a script, one row of values per frame
+	void FlyScript(const FFlightScript& Script, TArray<float>& OutValues)
+	{
+		FSpaceRocksFlightState State;
+		for (int32 Segment = 0; Segment < Script.Segments.Num(); Segment++)
+		{
+			for (int32 Frame = 0; Frame < Script.Segments[Segment].NumFrames; Frame++)
+			{
+				FSpaceRocksFlight::Step(Script.Params, Script.Segments[Segment].Input, State, Script.DeltaSeconds);
+
+				const int32 Row = OutValues.AddUninitialized(NumTrajectoryValues);
+				GetTrajectoryValues(State, &OutValues[Row]);
+			}
+		}
+	}
+
+	bool CheckValue(const TCHAR* What, float Value, float Expected)
+	{
+		if (FMath::Abs(Value - Expected) > 1.e-4f)
+		{
+			UE_LOG(LogFlying, Error, TEXT("Flight check: %s is %f, expected %f"), What, Value, Expected);
+			return false;
+		}
+		return true;
+	}
+}
+
+bool FSpaceRocksFlight::CheckAngleHelpers()
+{
+	bool bPassed = true;
+	bPassed &= CheckValue(TEXT("AddDegrees(350, 20)"), AddDegrees(350.f, 20.f), 10.f);
+	bPassed &= CheckValue(TEXT("AddDegrees(10, -20)"), AddDegrees(10.f, -20.f), 350.f);
+	bPassed &= CheckValue(TEXT("AddDegrees(180, 720)"), AddDegrees(180.f, 720.f), 180.f);
+	bPassed &= CheckValue(TEXT("CalcFactor_yaw(0, 0)"), CalcFactor_yaw(0.f, 0.f), 1.f);
+	bPassed &= CheckValue(TEXT("CalcFactor_yaw(0, 90)"), CalcFactor_yaw(0.f, 90.f), 0.f);
+	bPassed &= CheckValue(TEXT("CalcFactor_yaw(300, 60)"), CalcFactor_yaw(300.f, 60.f), 1.f);
+	bPassed &= CheckValue(TEXT("CalcFactor_pitch(60)"), CalcFactor_pitch(60.f), 0.5f);
+	bPassed &= CheckValue(TEXT("CalcFactor_pitch(-90)"), CalcFactor_pitch(-90.f), 0.f);
+	bPassed &= CheckValue(TEXT("CalcFactor_roll(180)"), CalcFactor_roll(180.f), -1.f);
+
+	UE_LOG(LogFlying, Display, TEXT("Flight angle helpers %s"), bPassed ? TEXT("passed") : TEXT("FAILED"));
+	return bPassed;
+}
+
+bool FSpaceRocksFlight::CheckKnownFrames()
+{
+	bool bPassed = true;
+	const FSpaceRocksFlightParams Params;
+	const float DeltaSeconds = 1.f / 60.f;
+
+	// Thrust is clamped to MaxSpeed
+	bPassed &= CheckValue(TEXT("CalcThrust at MaxSpeed"), CalcThrust(Params, 1.f, 1.f, 3999.f, 1.f), 4000.f);
+
+	// From rest, full rear thrust for a frame: the rear thruster adds Acceleration * dt along X, and the idle side
+	// and bottom thrusters each take 0.5 * Deceleration * dt off it. On Y (and Z) the side thruster pulls the zero
+	// speed negative and the bottom thruster pushes it back to zero.
+	{
+		FSpaceRocksFlightInput Input;
+		Input.Rear = 1.f;
+		FSpaceRocksFlightState State;
+		Step(Params, Input, State, DeltaSeconds);
+		const float ExpectedVX = (1000.f - 50.f) / 60.f;
+		bPassed &= CheckValue(TEXT("Rear thrust VX"), State.Velocity.X, ExpectedVX);
+		bPassed &= CheckValue(TEXT("Rear thrust VY"), State.Velocity.Y, 0.f);
+		bPassed &= CheckValue(TEXT("Rear thrust X"), State.Location.X, ExpectedVX / 60.f);
+	}
+
+	// The same, yawed 90 degrees: the thrust goes along Y instead
+	{
+		FSpaceRocksFlightInput Input;
+		Input.Rear = 1.f;
+		FSpaceRocksFlightState State;
+		State.Rotation.Yaw = 90.f;
+		Step(Params, Input, State, DeltaSeconds);
+		bPassed &= CheckValue(TEXT("Yawed rear thrust VX"), State.Velocity.X, 0.f);
+		bPassed &= CheckValue(TEXT("Yawed rear thrust VY"), State.Velocity.Y, (1000.f - 50.f) / 60.f);
+	}
+
+	// Full pitch input for a frame: the rate moves AxisSmoothing * dt of the way to -TurnSpeed, then turns the craft
+	{
+		FSpaceRocksFlightInput Input;
+		Input.Pitch = 1.f;
+		FSpaceRocksFlightState State;
+		Step(Params, Input, State, DeltaSeconds);
+		const float ExpectedRate = -100.f * 5.f / 60.f;
+		bPassed &= CheckValue(TEXT("Pitch rate"), State.TurnRate.Pitch, ExpectedRate);
+		bPassed &= CheckValue(TEXT("Pitch"), State.Rotation.Pitch, ExpectedRate / 60.f);
+	}
+
+	// No input with ReturnSpeed: the pitch rate heads for -Pitch * ReturnSpeed, back towards level
+	{
+		FSpaceRocksFlightParams ReturnParams;
+		ReturnParams.ReturnSpeed = 2.f;
+		FSpaceRocksFlightState State;
+		State.Rotation.Pitch = 10.f;
+		Step(ReturnParams, FSpaceRocksFlightInput(), State, DeltaSeconds);
+		const float ExpectedRate = -20.f * 5.f / 60.f;
+		bPassed &= CheckValue(TEXT("Return pitch rate"), State.TurnRate.Pitch, ExpectedRate);
+		bPassed &= CheckValue(TEXT("Return pitch"), State.Rotation.Pitch, 10.f + ExpectedRate / 60.f);
+	}
+
+	UE_LOG(LogFlying, Display, TEXT("Flight known frames %s"), bPassed ? TEXT("passed") : TEXT("FAILED"));
+	return bPassed;
+}
+
+FString FSpaceRocksFlight::GetGoldenDir()
+{
+	// Under Content so packaged builds have it too (staged by DirectoriesToAlwaysStageAsUFS in DefaultGame.ini).
+	// Record it from an engine build with "FlightCheck 1" - the goldens only mean anything if the shipped code made them.
+	return FPaths::GameContentDir() / TEXT("FlightGolden");
+}
+
+bool FSpaceRocksFlight::CheckTrajectories(bool bRecord)
+{
+	bool bPassed = true;
+
+	const FString GoldenDir = GetGoldenDir();
+
+	TArray<FFlightScript> Scripts;
+	BuildScripts(Scripts);
+
+	for (int32 ScriptIndex = 0; ScriptIndex < Scripts.Num(); ScriptIndex++)
+	{
+		const FFlightScript& Script = Scripts[ScriptIndex];
+		const FString Filename = GoldenDir / Script.Name + TEXT(".csv");
+
+		TArray<float> Values;
+		FlyScript(Script, Values);
+		const int32 NumFrames = Values.Num() / NumTrajectoryValues;
+
+		FString Golden;
+		if (bRecord)
+		{
+			FString Text = TEXT("Frame");
+			for (int32 Value = 0; Value < NumTrajectoryValues; Value++)
+			{
+				Text += FString(TEXT(",")) + TrajectoryValueNames[Value];
+			}
+			Text += TEXT("\n");
+			for (int32 Frame = 0; Frame < NumFrames; Frame++)
+			{
+				Text += FString::Printf(TEXT("%d"), Frame);
+				for (int32 Value = 0; Value < NumTrajectoryValues; Value++)
+				{
+					Text += FString::Printf(TEXT(",%.4f"), Values[Frame * NumTrajectoryValues + Value]);
+				}
+				Text += TEXT("\n");
+			}
+			if (!FFileHelper::SaveStringToFile(Text, *Filename))
+			{
+				UE_LOG(LogFlying, Error, TEXT("Flight check: couldn't record %s to %s"), *Script.Name, *Filename);
+				bPassed = false;
+				continue;
+			}
+			UE_LOG(LogFlying, Display, TEXT("Flight check: recorded %s (%d frames) to %s"), *Script.Name, NumFrames, *Filename);
+			continue;
+		}
+
+		// A missing golden is a failure, otherwise a lost file would pass forever
+		if (!FFileHelper::LoadFileToString(Golden, *Filename))
+		{
+			UE_LOG(LogFlying, Error, TEXT("Flight check: no golden for %s at %s (FlightCheck 1 records it)"), *Script.Name, *Filename);
+			bPassed = false;
+			continue;
+		}
+
+		TArray<FString> Lines;
+		Golden.ParseIntoArray(&Lines, TEXT("\n"), true);
+		if (Lines.Num() - 1 != NumFrames)
+		{
+			UE_LOG(LogFlying, Error, TEXT("Flight check: %s flew %d frames, golden has %d"), *Script.Name, NumFrames, Lines.Num() - 1);
+			bPassed = false;
+			continue;
+		}
+
+		// Compare every value, allowing for float differences between compilers and platforms
+		float MaxError = 0.f;
+		int32 FirstBadFrame = INDEX_NONE;
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			TArray<FString> Fields;
+			Lines[Frame + 1].ParseIntoArray(&Fields, TEXT(","), true);
+			if (Fields.Num() != NumTrajectoryValues + 1)
+			{
+				FirstBadFrame = (FirstBadFrame == INDEX_NONE) ? Frame : FirstBadFrame;
+				continue;
+			}
+
+			for (int32 Value = 0; Value < NumTrajectoryValues; Value++)
+			{
+				const float Expected = FCString::Atof(*Fields[Value + 1]);
+				const float Actual = Values[Frame * NumTrajectoryValues + Value];
+
+				// Rotations are compared the short way round
+				const bool bAngle = (Value >= 3 && Value <= 5);
+				const float Error = bAngle ? FMath::Abs(FRotator::NormalizeAxis(Actual - Expected)) : FMath::Abs(Actual - Expected);
+				const float Tolerance = 0.01f + 1.e-4f * FMath::Abs(Expected);
+
+				MaxError = FMath::Max(MaxError, Error);
+				if (Error > Tolerance && FirstBadFrame == INDEX_NONE)
+				{
+					FirstBadFrame = Frame;
+					UE_LOG(LogFlying, Error, TEXT("Flight check: %s frame %d %s is %.4f, golden %.4f"),
+						*Script.Name, Frame, TrajectoryValueNames[Value], Actual, Expected);
+				}
+			}
+		}
+
+		UE_LOG(LogFlying, Display, TEXT("Flight check: %-20s %4d frames, max error %.5f  %s"),
+			*Script.Name, NumFrames, MaxError, (FirstBadFrame == INDEX_NONE) ? TEXT("ok") : TEXT("FAILED"));
+		bPassed &= (FirstBadFrame == INDEX_NONE);
+	}
+
+	UE_LOG(LogFlying, Display, TEXT("Flight trajectories %s"), bPassed ? TEXT("passed") : TEXT("FAILED"));
+	return bPassed;
+}
+
+bool FSpaceRocksFlight::RunChecks(bool bRecord)
+{
+	const bool bHelpersPassed = CheckAngleHelpers();
+	const bool bFramesPassed = CheckKnownFrames();
+	const bool bTrajectoriesPassed = CheckTrajectories(bRecord);
+	const bool bPassed = bHelpersPassed && bFramesPassed && bTrajectoriesPassed;
+
+	UE_LOG(LogFlying, Display, TEXT("Flight check %s"), bPassed ? TEXT("passed") : TEXT("FAILED"));
+	return bPassed;
+}
+
+// ** Automation tests (Session Frontend, or "Automation RunTests SpaceRocks.Flight") **
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpaceRocksFlightAngleHelpersTest, "SpaceRocks.Flight.AngleHelpers", EAutomationTestFlags::ATF_Editor | EAutomationTestFlags::ATF_Game)
+
+bool FSpaceRocksFlightAngleHelpersTest::RunTest(const FString& Parameters)
+{
+	return FSpaceRocksFlight::CheckAngleHelpers();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpaceRocksFlightKnownFramesTest, "SpaceRocks.Flight.KnownFrames", EAutomationTestFlags::ATF_Editor | EAutomationTestFlags::ATF_Game)
+
+bool FSpaceRocksFlightKnownFramesTest::RunTest(const FString& Parameters)
+{
+	return FSpaceRocksFlight::CheckKnownFrames();
+}
+
+void FSpaceRocksFlight::RunBenchmark(int32 NumCraft)
+{
+	const int32 NumCalls = 1 << 20;
+	const int32 TableSize = 1024;
+	const float DeltaSeconds = 1.f / 60.f;
+	const FSpaceRocksFlightParams Params;
+
+	// Varied arguments, so nothing is constant folded
+	FRandomStream Random(NumCraft);
+	TArray<float> Inputs;
+	TArray<float> Speeds;
+	TArray<float> Angles;
+	for (int32 Index = 0; Index < TableSize; Index++)
+	{
+		Inputs.Add((Index % 4 == 0) ? 0.f : Random.FRandRange(-1.f, 1.f));
+		Speeds.Add(Random.FRandRange(-4000.f, 4000.f));
+		Angles.Add(Random.FRandRange(-180.f, 180.f));
+	}
+
+	UE_LOG(LogFlying, Display, TEXT("Flight benchmark: %d calls per kernel"), NumCalls);
+
+	// ** Kernels **
+
+	float Sink = 0.f;
+	double StartTime;
+
+#define FLIGHT_BENCH_KERNEL(Name, Expression) \
+	StartTime = FPlatformTime::Seconds(); \
+	for (int32 Call = 0; Call < NumCalls; Call++) \
+	{ \
+		const int32 Index = Call & (TableSize - 1); \
+		Sink += (Expression); \
+	} \
+	UE_LOG(LogFlying, Display, TEXT("  %-16s %7.2f ns per call"), TEXT(Name), (FPlatformTime::Seconds() - StartTime) * 1.e9 / NumCalls);
+
+	FLIGHT_BENCH_KERNEL("CalcThrust", CalcThrust(Params, Inputs[Index], Angles[Index] / 180.f, Speeds[Index], DeltaSeconds));
+	FLIGHT_BENCH_KERNEL("SmoothTurnRate", SmoothTurnRate(Params, Speeds[Index], TargetPitchRate(Params, Inputs[Index], Angles[Index]), DeltaSeconds));
+	FLIGHT_BENCH_KERNEL("AddDegrees", AddDegrees(Angles[Index], Speeds[Index]));
+	FLIGHT_BENCH_KERNEL("CalcFactor_yaw", CalcFactor_yaw(Angles[Index] + 180.f, 90.f));
+	FLIGHT_BENCH_KERNEL("CalcFactor_pitch", CalcFactor_pitch(Angles[Index] * 0.5f));
+	FLIGHT_BENCH_KERNEL("CalcFactor_roll", CalcFactor_roll(Angles[Index]));
+
+#undef FLIGHT_BENCH_KERNEL
+
+	// ** Whole frames for batches of crafts **
+
+	NumCraft = FMath::Max(NumCraft, 1);
+	for (int32 BatchSize = 1; ; BatchSize = FMath::Min(BatchSize * 16, NumCraft))
+	{
+		TArray<FSpaceRocksFlightInput> CraftInputs;
+		TArray<FSpaceRocksFlightState> States;
+		CraftInputs.AddZeroed(BatchSize);
+		States.Init(FSpaceRocksFlightState(), BatchSize);
+		for (int32 Index = 0; Index < BatchSize; Index++)
+		{
+			CraftInputs[Index].Pitch = Inputs[(Index * 6 + 0) & (TableSize - 1)];
+			CraftInputs[Index].Yaw = Inputs[(Index * 6 + 1) & (TableSize - 1)];
+			CraftInputs[Index].Roll = Inputs[(Index * 6 + 2) & (TableSize - 1)];
+			CraftInputs[Index].Rear = Inputs[(Index * 6 + 3) & (TableSize - 1)];
+			CraftInputs[Index].Side = Inputs[(Index * 6 + 4) & (TableSize - 1)];
+			CraftInputs[Index].Bottom = Inputs[(Index * 6 + 5) & (TableSize - 1)];
+		}
+
+		const int32 NumFrames = FMath::Max(NumCalls / (BatchSize * 8), 4);
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			StepBatch(Params, CraftInputs.GetData(), States.GetData(), BatchSize, DeltaSeconds);
+		}
+		const double SerialSeconds = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			SpaceRocksParallelFor(BatchSize, [&](int32 Index)
+			{
+				Step(Params, CraftInputs[Index], States[Index], DeltaSeconds);
+			}, 256);
+		}
+		const double ParallelSeconds = FPlatformTime::Seconds() - StartTime;
+
+		for (int32 Index = 0; Index < BatchSize; Index++)
+		{
+			Sink += States[Index].Location.X;
+		}
+
+		const double NumSteps = (double)BatchSize * NumFrames;
+		UE_LOG(LogFlying, Display, TEXT("  %6d craft: %7.1f ns per craft step, %7.2f M craft steps/s (parallel %7.2f M/s)"),
+			BatchSize, SerialSeconds * 1.e9 / NumSteps, NumSteps / SerialSeconds * 1.e-6, NumSteps / ParallelSeconds * 1.e-6);
+
+		if (BatchSize == NumCraft)
+		{
+			break;
+		}
+	}
+
+	// Keep the results alive
+	UE_LOG(LogFlying, Verbose, TEXT("Flight benchmark sink %f"), Sink);
+}
@@ -4,6 +4,12 @@
 #include "SpaceRocksGameMode.h"
 #include "SpaceRocksGameState.h"
 #include "SpaceRocksPawn.h"
+#include "SpaceRocksHUD.h"
+#include "SpaceRocksBeltComponent.h"
+#include "SpaceRocksSoakTest.h"
+#include "SpaceRocksTrace.h"
+#include "SpaceRocksFlight.h"
+#include "SpaceRocksDebris.h"
 
 ASpaceRocksGameMode::ASpaceRocksGameMode(const class FPostConstructInitializeProperties& PCIP)
 	: Super(PCIP)
@@ -15,5 +21,289 @@ ASpaceRocksGameMode::ASpaceRocksGameMode(const class FPostConstructInitializePro
 
 	GameStateClass = ASpaceRocksGameState::StaticClass();
 
-	
+	// HUD with the radar
+	HUDClass = ASpaceRocksHUD::StaticClass();
+
+	bEnableGravity = false;
+}
+
+void ASpaceRocksGameMode::InitGameState()
+{
+	Super::InitGameState();
+
+	ASpaceRocksGameState* const SRGameState = Cast<ASpaceRocksGameState>(GameState);
+	if (SRGameState)
+	{
+		SRGameState->bEnableGravity = bEnableGravity;
+	}
+}
+
+void ASpaceRocksGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("NoSpaceRocksTrace")))
+	{
+		FSpaceRocksTrace::SetEnabled(false);
+	}
+
+	// Long running soak test (-SpaceRocksSoak)
+	if (ASpaceRocksSoakTest::IsSoakRequested())
+	{
+		GetWorld()->SpawnActor<ASpaceRocksSoakTest>(ASpaceRocksSoakTest::StaticClass());
+	}
+}
+
+void ASpaceRocksGameMode::GravityBench(int32 MaxBodies)
+{
+	ASpaceRocksGameState* const SRGameState = Cast<ASpaceRocksGameState>(GameState);
+	const float OpeningAngle = SRGameState ? SRGameState->GravityOpeningAngle : 0.5f;
+
+	FSpaceRocksGravitySim::RunBenchmark(MaxBodies > 0 ? MaxBodies : 100000, OpeningAngle);
+}
+
+void ASpaceRocksGameMode::RockFieldBench(int32 NumRocks)
+{
+	ASpaceRocksGameState* const SRGameState = Cast<ASpaceRocksGameState>(GameState);
+
+	FSpaceRocksRockFieldParams Params = SRGameState ? SRGameState->GetRockFieldParams() : FSpaceRocksRockFieldParams();
+	Params.NumRocks = (NumRocks > 0) ? NumRocks : 50000;
+
+	// Game thread cost is only kicking off the task
+	const double StartTime = FPlatformTime::Seconds();
+	FAsyncTask<FSpaceRocksRockFieldTask> Task(Params);
+	Task.StartBackgroundTask();
+	const double DispatchSeconds = FPlatformTime::Seconds() - StartTime;
+	Task.EnsureCompletion();
+
+	// Same seed must give the same field
+	TArray<FSpaceRocksRockSpawn> Again;
+	FSpaceRocksRockFieldGenerator::Generate(Params, Again);
+	const TArray<FSpaceRocksRockSpawn>& Rocks = Task.GetTask().Rocks;
+	const bool bReproducible = (Again.Num() == Rocks.Num()) && FMemory::Memcmp(Again.GetData(), Rocks.GetData(), Rocks.Num() * sizeof(FSpaceRocksRockSpawn)) == 0;
+
+	UE_LOG(LogFlying, Display, TEXT("Rock field benchmark: seed %d, placed %d of %d rocks, worker %.2f ms, game thread %.3f ms, reproducible: %s"),
+		Params.Seed, Rocks.Num(), Params.NumRocks, Task.GetTask().GenerateSeconds * 1000.0, DispatchSeconds * 1000.0,
+		bReproducible ? TEXT("yes") : TEXT("NO"));
+}
+
+void ASpaceRocksGameMode::TargetBench(int32 NumQueries)
+{
+	FSpaceRocksTargetBVH::RunBenchmark(NumQueries > 0 ? NumQueries : 1000, 8, 15.f);
+}
+
+void ASpaceRocksGameMode::RayBench(int32 NumBlasts, int32 RaysPerBlast)
+{
+	FSpaceRocksTargetBVH::RunRayBenchmark(NumBlasts > 0 ? NumBlasts : 1000, RaysPerBlast > 0 ? RaysPerBlast : 24);
+}
+
+void ASpaceRocksGameMode::FlightCheck(int32 bRecord)
+{
+	FSpaceRocksFlight::RunChecks(bRecord != 0);
+}
+
+void ASpaceRocksGameMode::FlightBench(int32 NumCraft)
+{
+	FSpaceRocksFlight::RunBenchmark(NumCraft > 0 ? NumCraft : 4096);
+}
+
+void ASpaceRocksGameMode::BeltStats()
+{
+	for (TObjectIterator<USpaceRocksBeltComponent> It; It; ++It)
+	{
+		if (It->GetWorld() == GetWorld())
+		{
+			It->LogStats();
+		}
+	}
+}
+
+void ASpaceRocksGameMode::InputLatency(int32 bReset)
+{
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		ASpaceRocksPawn* const Pawn = Cast<ASpaceRocksPawn>((*It)->GetPawn());
+		if (Pawn)
+		{
+			Pawn->InputLatency.LogReport(Pawn->GetName());
+			if (bReset)
+			{
+				Pawn->InputLatency.Reset();
+			}
+		}
+	}
+}
+
+void ASpaceRocksGameMode::ViewStats()
+{
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState == NULL)
+	{
+		return;
+	}
+
+	const FSpaceRocksViewSet& Views = GameState->GetViews();
+	for (int32 Index = 0; Index < Views.Num(); Index++)
+	{
+		UE_LOG(LogFlying, Display, TEXT("View %d: player %d at %s"), Index, Views[Index].PlayerIndex, *Views[Index].Location.ToString());
+	}
+
+	int32 NumShadowed = 0;
+	for (int32 Index = 0; Index < GameState->Craft.Num(); Index++)
+	{
+		if (GameState->Craft[Index] && GameState->Craft[Index]->CraftSpotLight->CastShadows)
+		{
+			NumShadowed++;
+		}
+	}
+
+	UE_LOG(LogFlying, Display, TEXT("Views: %d local views, %d craft (%d with spotlight shadows, budget %d), craft step %.3f ms, target refit %.3f ms, damage %.3f ms"),
+		Views.Num(), GameState->Craft.Num(), NumShadowed, GameState->MaxCraftSpotLightShadows, GameState->CraftStepMs, GameState->TargetRefitMs, GameState->DamageResolveMs);
+
+	BeltStats();
+}
+
+void ASpaceRocksGameMode::SnapshotCheck(int32 NumReaders)
+{
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState == NULL)
+	{
+		return;
+	}
+
+	const FSpaceRocksSnapshotBufferPtr& Snapshots = GameState->GetSnapshots();
+	{
+		FSpaceRocksSnapshotReader Snapshot(*Snapshots);
+		UE_LOG(LogFlying, Display, TEXT("Snapshot: frame %llu, %d craft, %d rocks, %d projectiles, published in %.3f ms, %d frames skipped"),
+			Snapshot.IsValid() ? Snapshot->Frame : 0,
+			Snapshot.IsValid() ? Snapshot->Craft.Num() : 0,
+			Snapshot.IsValid() ? Snapshot->Rocks.Num() : 0,
+			Snapshot.IsValid() ? Snapshot->Projectiles.Num() : 0,
+			GameState->SnapshotPublishMs, Snapshots->GetNumSkipped());
+	}
+
+	// The readers report when they finish
+	NumReaders = NumReaders > 0 ? NumReaders : 4;
+	for (int32 Index = 0; Index < NumReaders; Index++)
+	{
+		(new FAutoDeleteAsyncTask<FSpaceRocksSnapshotCheckTask>(Snapshots, 5.f))->StartBackgroundTask();
+	}
+}
+
+void ASpaceRocksGameMode::DebrisStats()
+{
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState && GameState->Debris)
+	{
+		GameState->Debris->LogStats();
+	}
+}
+
+void ASpaceRocksGameMode::DebrisBurst(int32 NumExplosions)
+{
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	APlayerController* const PlayerController = GetWorld()->GetFirstPlayerController();
+	APawn* const Pawn = PlayerController ? PlayerController->GetPawn() : NULL;
+	if (GameState == NULL || GameState->Debris == NULL || Pawn == NULL)
+	{
+		return;
+	}
+
+	// A chain reaction: explosions scattered round the player, all in one frame
+	NumExplosions = NumExplosions > 0 ? NumExplosions : 50;
+	for (int32 Index = 0; Index < NumExplosions; Index++)
+	{
+		const FVector Location = Pawn->GetActorLocation() + FMath::VRand() * FMath::FRandRange(2000.f, 6000.f);
+		GameState->Debris->AddRockExplosion(Location, FVector::ZeroVector, FMath::FRandRange(100.f, 600.f), NULL);
+	}
+	GameState->Debris->LogStats();
+}
+
+void ASpaceRocksGameMode::DamageBench(int32 NumHits)
+{
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState == NULL)
+	{
+		return;
+	}
+
+	TArray<AActor*> Targets;
+	for (int32 Index = 0; Index < GameState->SpaceRocks.Num(); Index++)
+	{
+		Targets.Add(GameState->SpaceRocks[Index]);
+	}
+	for (int32 Index = 0; Index < GameState->Craft.Num(); Index++)
+	{
+		Targets.Add(GameState->Craft[Index]);
+	}
+	if (Targets.Num() == 0)
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Damage benchmark: nothing to hit"));
+		return;
+	}
+
+	// Anything already queued goes first, so it isn't counted
+	GameState->ResolveDamage();
+
+	NumHits = NumHits > 0 ? NumHits : 1000;
+	for (int32 FrameHits = 10; ; FrameHits = FMath::Min(FrameHits * 10, NumHits))
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Hit = 0; Hit < FrameHits; Hit++)
+		{
+			AActor* const Target = Targets[FMath::RandHelper(Targets.Num())];
+			GameState->QueueDamage(Target, 0.f, Target->GetActorLocation(), 0);
+		}
+		const double QueueSeconds = FPlatformTime::Seconds() - StartTime;
+		GameState->ResolveDamage();
+
+		UE_LOG(LogFlying, Display, TEXT("Damage benchmark: %6d hits on %5d targets, queue %.3f ms, resolve %.3f ms (%.0f ns per hit)"),
+			GameState->DamageHits, GameState->DamageTargets, QueueSeconds * 1000.0, GameState->DamageResolveMs,
+			(QueueSeconds * 1000.0 + GameState->DamageResolveMs) * 1000000.0 / FrameHits);
+
+		if (FrameHits >= NumHits)
+		{
+			break;
+		}
+	}
+}
+
+void ASpaceRocksGameMode::CollisionBench(int32 NumFrames)
+{
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState)
+	{
+		GameState->StartCollisionBench(NumFrames > 0 ? NumFrames : 300);
+	}
+}
+
+void ASpaceRocksGameMode::ArenaNext()
+{
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState)
+	{
+		GameState->NextArena();
+	}
+}
+
+void ASpaceRocksGameMode::TraceFlush()
+{
+	const FString Filename = FSpaceRocksTrace::GetDefaultFilename();
+	const int32 NumEvents = FSpaceRocksTrace::Flush(Filename);
+	if (NumEvents >= 0)
+	{
+		UE_LOG(LogFlying, Display, TEXT("Trace: wrote %d events to %s"), NumEvents, *Filename);
+	}
+}
+
+void ASpaceRocksGameMode::TraceEnable(int32 bEnable)
+{
+	FSpaceRocksTrace::SetEnabled(bEnable != 0);
+	UE_LOG(LogFlying, Display, TEXT("Trace: %s"), bEnable ? TEXT("on") : TEXT("off"));
+}
+
+ASpaceRocksGravityGameMode::ASpaceRocksGravityGameMode(const class FPostConstructInitializeProperties& PCIP)
+	: Super(PCIP)
+{
+	bEnableGravity = true;
 }
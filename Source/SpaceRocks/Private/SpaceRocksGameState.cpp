@@ -3,6 +3,12 @@
 #include "SpaceRocks.h"
 #include "SpaceRocksGameState.h"
 #include "SpaceRocksGameMode.h"
+#include "SpaceRocksPawn.h"
+#include "SpaceRocksRock.h"
+#include "SpaceRocksProjectile.h"
+#include "SpaceRocksRockMeshLibrary.h"
+#include "SpaceRocksDebris.h"
+#include "SpaceRocksTrace.h"
 
 
 ASpaceRocksGameState::ASpaceRocksGameState(const class FPostConstructInitializeProperties& PCIP)
@@ -14,7 +20,76 @@ ASpaceRocksGameState::ASpaceRocksGameState(const class FPostConstructInitializeP
 	spacerock_speed_inc = 100;	// Increment speed of space rocks per level
 	num_spacerocks_start = 2;	// Initial number of space rocks at level 1
 	num_spacerocks_inc = 1;		// Increment number of space rocks per level
-	
+
+	// Gravity
+	bEnableGravity = false;
+	GravityConstant = 50000.f;
+	GravityOpeningAngle = 0.5f;
+	GravitySoftening = 500.f;
+	MinGravityMass = 10000.f;
+	GravityStepMs = 0.f;
+
+	// Procedural rock field
+	bGenerateRockField = false;
+	RockFieldSeed = 1;
+	ArenaBounds = FBox(FVector(-20000.f, -20000.f, -20000.f), FVector(20000.f, 20000.f, 20000.f));
+	RockMinRadius = 100.f;
+	RockMaxRadius = 600.f;
+	RockSizeExponent = 2.f;
+	RockSpacing = 200.f;
+	RockClearRadius = 2000.f;
+	RockClass = ASpaceRocksRock::StaticClass();
+	RockSpawnBudgetMs = 2.f;
+
+	// Targeting
+	TargetRefitMs = 0.f;
+	bProceduralRockMeshes = false;
+	RockFieldTask = NULL;
+
+	// Arenas
+	ArenaFrameBudgetMs = 16.7f;
+	curr_arena = 0;
+
+	// Debris
+	bExplosionDebris = true;
+	Debris = NULL;
+	NextRockSpawn = 0;
+
+	// Damage
+	RockFractureMinRadius = 200.f;
+	RockFragments = 2;
+	RockFragmentSpeed = 300.f;
+	DamageResolveMs = 0.f;
+	DamageHits = 0;
+	DamageTargets = 0;
+
+	// Hitscan
+	bHitscanStaticGeometry = true;
+	HitscanCastMs = 0.f;
+	HitscanRaysCast = 0;
+	HitscanRaysHit = 0;
+
+	// Craft and split-screen
+	CraftStepMs = 0.f;
+	MaxCraftSpotLightShadows = 1;
+
+	// Collision
+	bQueryOnlyRocks = false;
+	PhysicsKickoffToFetchMs = 0.f;
+	PhysicsContactPairs = 0;
+	CollisionMode = ESpaceRocksCollisionMode::Channels;
+
+	// Snapshots
+	Snapshots = MakeShareable(new FSpaceRocksSnapshotBuffer());
+	SnapshotPublishMs = 0.f;
+
+	// We run the game-wide simulation stages
+	PrimaryActorTick.bCanEverTick = true;
+
+	// And the ones that need this frame's physics results
+	PostUpdateTick.Target = this;
+	PostUpdateTick.bCanEverTick = true;
+	PostUpdateTick.TickGroup = TG_PostUpdateWork;
 }
 
 void ASpaceRocksGameState::OnConstruction(const FTransform& Transform)
@@ -46,3 +121,860 @@ float ASpaceRocksGameState::GetSpacerockSpawnSpeed()
 {
 	return curr_spacerock_speed;
 }
+
+void ASpaceRocksGameState::NextLevel()
+{
+	curr_level++;
+
+	if (curr_level > num_levels)
+	{
+		// Finished the map - start again at level 1 (in the next arena)
+		curr_level = 1;
+		curr_spacerock_speed = spacerock_start_speed;
+		curr_spacerocks = num_spacerocks_start;
+
+		if (ArenaLevels.Num() > 1)
+		{
+			NextArena();
+		}
+	}
+	else
+	{
+		curr_spacerock_speed += spacerock_speed_inc;
+		curr_spacerocks += num_spacerocks_inc;
+	}
+
+	PreloadNextArena();
+
+	SPACEROCKS_TRACE_EVENT(LevelChange, curr_level, (float)curr_spacerocks);
+
+	if (bGenerateRockField)
+	{
+		StartRockField();
+	}
+}
+
+void ASpaceRocksGameState::NextArena()
+{
+	if (ArenaLevels.Num() == 0)
+	{
+		return;
+	}
+
+	curr_arena = (curr_arena + 1) % ArenaLevels.Num();
+	if (ArenaStreaming.Activate(GetWorld(), ArenaLevels[curr_arena]))
+	{
+		map_name = ArenaLevels[curr_arena].ToString();
+	}
+
+	PreloadNextArena();
+}
+
+void ASpaceRocksGameState::PreloadNextArena()
+{
+	// Final level of this arena (the first one too, when each arena has a single level) - the next level
+	// switches arena, so get the next one loading in the background
+	if (curr_level >= num_levels && ArenaLevels.Num() > 1)
+	{
+		// With two arenas this is the one we've just left - Preload keeps it loaded rather than letting it unload
+		ArenaStreaming.Preload(GetWorld(), ArenaLevels[(curr_arena + 1) % ArenaLevels.Num()]);
+	}
+}
+
+
+void ASpaceRocksGameState::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// First arena
+	ArenaStreaming.FrameBudgetMs = ArenaFrameBudgetMs;
+	if (ArenaLevels.Num() > 0)
+	{
+		curr_arena = 0;
+		if (ArenaStreaming.Activate(GetWorld(), ArenaLevels[0]))
+		{
+			map_name = ArenaLevels[0].ToString();
+		}
+		PreloadNextArena();
+	}
+
+	PostUpdateTick.RegisterTickFunction(GetLevel());
+
+	// Static geometry already in the world collides as Arena (arenas streamed in later get it when they're shown)
+	for (int32 Index = 0; Index < GetWorld()->GetNumLevels(); Index++)
+	{
+		ULevel* const Level = GetWorld()->GetLevel(Index);
+		if (Level && Level->bIsVisible)
+		{
+			FSpaceRocksCollision::ApplyToArena(Level);
+		}
+	}
+
+	// Rocks placed in the map may have registered already
+	SetCollisionMode(bQueryOnlyRocks ? ESpaceRocksCollisionMode::QueryOnlyRocks : ESpaceRocksCollisionMode::Channels);
+	PhysicsStats.Register(GetWorld());
+
+	if (bProceduralRockMeshes)
+	{
+		GetWorld()->SpawnActor<ASpaceRocksRockMeshLibrary>(ASpaceRocksRockMeshLibrary::StaticClass());
+	}
+
+	if (bExplosionDebris)
+	{
+		Debris = GetWorld()->SpawnActor<ASpaceRocksDebris>(ASpaceRocksDebris::StaticClass());
+	}
+
+	if (bGenerateRockField)
+	{
+		StartRockField();
+	}
+}
+
+void ASpaceRocksGameState::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Can't leave a worker writing into us (Destroyed isn't called when the map is torn down)
+	if (RockFieldTask)
+	{
+		RockFieldTask->EnsureCompletion();
+		delete RockFieldTask;
+		RockFieldTask = NULL;
+	}
+
+	// The world's physics tick functions outlive us, so take our prerequisites off them here too
+	PostUpdateTick.UnRegisterTickFunction();
+	PhysicsStats.Unregister();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ASpaceRocksGameState::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	// Start of this frame (the converter draws it up to the next one)
+	SPACEROCKS_TRACE_EVENT(Frame, 0, DeltaSeconds);
+
+	UpdateViews();
+
+	// Last frame's physics step
+	PhysicsKickoffToFetchMs = PhysicsStats.GetLastFrame().KickoffToFetchMs;
+	PhysicsContactPairs = PhysicsStats.GetLastFrame().ContactPairs;
+
+	ESpaceRocksCollisionMode::Type BenchMode;
+	if (CollisionBench.Update(PhysicsStats.GetLastFrame(), BenchMode))
+	{
+		SetCollisionMode(CollisionBench.IsRunning() ? BenchMode
+			: (bQueryOnlyRocks ? ESpaceRocksCollisionMode::QueryOnlyRocks : ESpaceRocksCollisionMode::Channels));
+	}
+
+	ArenaStreaming.Tick(GetWorld(), DeltaSeconds);
+
+	// Fragments of rocks destroyed at the end of last frame start spawning straight away
+	UpdateRockField();
+
+	if (bEnableGravity)
+	{
+		StepGravity(DeltaSeconds);
+	}
+
+	StepRocks(DeltaSeconds);
+
+	StepCraft(DeltaSeconds);
+
+	PublishSnapshot(DeltaSeconds);
+}
+
+void ASpaceRocksGameState::TickPostUpdate(float DeltaSeconds)
+{
+	// Physics has moved the rocks, so the tree matches what this frame shows
+	UpdateTargets(DeltaSeconds);
+
+	// The rays fired during this frame's tick, then everything hit this frame (by rays and by projectiles during physics)
+	ResolveHitscan();
+	ResolveDamage();
+}
+
+void FSpaceRocksPostUpdateTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && !Target->IsPendingKill())
+	{
+		Target->TickPostUpdate(DeltaTime);
+	}
+}
+
+FString FSpaceRocksPostUpdateTickFunction::DiagnosticMessage()
+{
+	return Target ? Target->GetFullName() + TEXT("[TickPostUpdate]") : TEXT("FSpaceRocksPostUpdateTickFunction");
+}
+
+void ASpaceRocksGameState::RegisterRock(ASpaceRocksRock* Rock)
+{
+	if (Rock->TargetProxy == INDEX_NONE)
+	{
+		SpaceRocks.Add(Rock);
+		Rock->TargetProxy = TargetTree.CreateProxy(Rock->GetActorLocation(), Rock->Radius, Rock);
+
+		// Always, even in Channels mode - Blueprint rocks can have another profile serialized (BP_SpaceRock_basic has BlockAll),
+		// and SetCollisionMode would give them ours anyway
+		FSpaceRocksCollision::ApplyToRock(Rock, CollisionMode);
+	}
+}
+
+void ASpaceRocksGameState::UnregisterRock(ASpaceRocksRock* Rock)
+{
+	if (Rock->TargetProxy != INDEX_NONE)
+	{
+		SpaceRocks.RemoveSwap(Rock);
+		TargetTree.DestroyProxy(Rock->TargetProxy);
+		Rock->TargetProxy = INDEX_NONE;
+	}
+}
+
+void ASpaceRocksGameState::RegisterProjectile(ASpaceRocksProjectile* Projectile)
+{
+	Projectiles.AddUnique(Projectile);
+
+	FSpaceRocksCollision::ApplyToProjectile(Projectile, CollisionMode);
+}
+
+void ASpaceRocksGameState::UnregisterProjectile(ASpaceRocksProjectile* Projectile)
+{
+	Projectiles.RemoveSwap(Projectile);
+}
+
+void ASpaceRocksGameState::RegisterCraft(ASpaceRocksPawn* Pawn)
+{
+	if (Pawn->TargetProxy == INDEX_NONE)
+	{
+		Craft.Add(Pawn);
+		Pawn->TargetProxy = TargetTree.CreateProxy(Pawn->GetActorLocation(), Pawn->GetRootComponent()->Bounds.SphereRadius, Pawn);
+		Pawn->bFlownByGameState = true;
+
+		FSpaceRocksCollision::ApplyToCraft(Pawn, CollisionMode);
+	}
+
+	// Already possessed (otherwise the pawn registers its controller when it sets up input)
+	APlayerController* const PlayerController = Cast<APlayerController>(Pawn->GetController());
+	if (PlayerController)
+	{
+		RegisterCraftController(PlayerController);
+	}
+}
+
+void ASpaceRocksGameState::RegisterCraftController(APlayerController* PlayerController)
+{
+	// Input is processed in the controller's tick, so without this the controller could tick after us and its axis
+	// values would only reach StepCraft a frame later. AddPrerequisite ignores controllers we already wait for.
+	if (PlayerController && PlayerController->IsLocalController())
+	{
+		AddTickPrerequisiteActor(PlayerController);
+	}
+}
+
+void ASpaceRocksGameState::UnregisterCraft(ASpaceRocksPawn* Pawn)
+{
+	if (Pawn->TargetProxy != INDEX_NONE)
+	{
+		Craft.RemoveSwap(Pawn);
+		TargetTree.DestroyProxy(Pawn->TargetProxy);
+		Pawn->TargetProxy = INDEX_NONE;
+		Pawn->bFlownByGameState = false;
+	}
+}
+
+void ASpaceRocksGameState::UpdateViews()
+{
+	Views.Gather(GetWorld());
+
+	// Spotlight shadows are the expensive part of a craft, so only the first few local players' craft get them
+	const TArray<ULocalPlayer*>& LocalPlayers = GEngine->GetGamePlayers(GetWorld());
+	for (int32 Index = 0; Index < Craft.Num(); Index++)
+	{
+		ASpaceRocksPawn* const Pawn = Craft[Index];
+		if (Pawn == NULL)
+		{
+			continue;
+		}
+
+		const APlayerController* const PC = Cast<APlayerController>(Pawn->GetController());
+		const int32 PlayerIndex = (PC && PC->Player) ? LocalPlayers.Find(Cast<ULocalPlayer>(PC->Player)) : INDEX_NONE;
+		const bool bCastShadows = (PlayerIndex != INDEX_NONE && PlayerIndex < MaxCraftSpotLightShadows);
+		if (Pawn->CraftSpotLight->CastShadows != bCastShadows)
+		{
+			Pawn->CraftSpotLight->SetCastShadows(bCastShadows);
+		}
+	}
+}
+
+void ASpaceRocksGameState::StepCraft(float DeltaSeconds)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	// One pass for all the craft, however many local players there are
+	for (int32 Index = 0; Index < Craft.Num(); Index++)
+	{
+		if (Craft[Index])
+		{
+			Craft[Index]->StepFlight(DeltaSeconds);
+		}
+	}
+	for (int32 Index = 0; Index < Craft.Num(); Index++)
+	{
+		if (Craft[Index])
+		{
+			Craft[Index]->UpdateLockOn();
+		}
+	}
+
+	CraftStepMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+void ASpaceRocksGameState::PublishSnapshot(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpaceRocksSnapshotPublish);
+	const double StartTime = FPlatformTime::Seconds();
+
+	FSpaceRocksWorldSnapshot* const Snapshot = Snapshots->BeginPublish();
+	if (Snapshot == NULL)
+	{
+		return;		// Readers are holding the other slots - they keep the last snapshot for another frame
+	}
+
+	Snapshot->Frame = GFrameCounter;
+	Snapshot->WorldTime = GetWorld()->GetTimeSeconds();
+	Snapshot->DeltaSeconds = DeltaSeconds;
+
+	// ** Level **
+
+	Snapshot->Level = curr_level;
+	Snapshot->NumLevels = num_levels;
+	Snapshot->Arena = curr_arena;
+	Snapshot->ArenaName = ArenaLevels.IsValidIndex(curr_arena) ? ArenaLevels[curr_arena] : NAME_None;
+	Snapshot->RockSpeed = curr_spacerock_speed;
+	Snapshot->RocksPerLevel = curr_spacerocks;
+
+	// ** Craft, rocks and projectiles (the arrays keep their memory from the last time this slot was used) **
+
+	Snapshot->Craft.Reset();
+	for (int32 Index = 0; Index < Craft.Num(); Index++)
+	{
+		const ASpaceRocksPawn* const Pawn = Craft[Index];
+		if (Pawn)
+		{
+			FSpaceRocksCraftSnapshot& Entry = Snapshot->Craft[Snapshot->Craft.AddUninitialized()];
+			Entry.Id = (int32)Pawn->GetUniqueID();
+			Entry.Location = Pawn->GetActorLocation();
+			Entry.Rotation = Pawn->PlaneMesh->GetComponentTransform().GetRotation();
+			Entry.Velocity = FVector(Pawn->CurrentXAxisSpeed, Pawn->CurrentYAxisSpeed, Pawn->CurrentZAxisSpeed);
+			Entry.TurnRate = FRotator(Pawn->CurrentPitchSpeed, Pawn->CurrentYawSpeed, Pawn->CurrentRollSpeed);
+			Entry.Radius = Pawn->GetRootComponent()->Bounds.SphereRadius;
+			Entry.ShieldLevel = Pawn->ShieldLevel;
+		}
+	}
+
+	Snapshot->Rocks.Reset();
+	for (int32 Index = 0; Index < SpaceRocks.Num(); Index++)
+	{
+		const ASpaceRocksRock* const Rock = SpaceRocks[Index];
+		if (Rock)
+		{
+			FSpaceRocksRockSnapshot& Entry = Snapshot->Rocks[Snapshot->Rocks.AddUninitialized()];
+			Entry.Id = (int32)Rock->GetUniqueID();
+			Entry.Location = Rock->GetActorLocation();
+			Entry.Velocity = Rock->GetRockVelocity();
+			Entry.Radius = Rock->Radius;
+			Entry.Health = Rock->Health;
+		}
+	}
+
+	Snapshot->Projectiles.Reset();
+	for (int32 Index = 0; Index < Projectiles.Num(); Index++)
+	{
+		const ASpaceRocksProjectile* const Projectile = Projectiles[Index];
+		if (Projectile)
+		{
+			FSpaceRocksProjectileSnapshot& Entry = Snapshot->Projectiles[Snapshot->Projectiles.AddUninitialized()];
+			Entry.OwnerId = Projectile->SpawnedBy;
+			Entry.Location = Projectile->GetActorLocation();
+			Entry.Velocity = Projectile->ProjectileMovement->Velocity;
+			Entry.Radius = Projectile->CollisionComp->GetScaledSphereRadius();
+		}
+	}
+
+	Snapshot->EndFrame = Snapshot->Frame;
+	Snapshots->EndPublish();
+
+	SnapshotPublishMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+int32 ASpaceRocksGameState::FindTargets(const FSpaceRocksTargetCone& Cone, FSpaceRocksTargetHit* OutHits, int32 MaxHits) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpaceRocksTargetQuery);
+	return TargetTree.QueryCone(Cone, OutHits, MaxHits);
+}
+
+void ASpaceRocksGameState::UpdateTargets(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpaceRocksTargetRefit);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	// Most targets stay inside their fat boxes, so this is mostly containment tests
+	for (int32 Index = 0; Index < SpaceRocks.Num(); Index++)
+	{
+		const ASpaceRocksRock* const Rock = SpaceRocks[Index];
+		if (Rock)
+		{
+			TargetTree.MoveProxy(Rock->TargetProxy, Rock->GetActorLocation(), Rock->Radius, Rock->GetRockVelocity() * DeltaSeconds);
+		}
+	}
+	for (int32 Index = 0; Index < Craft.Num(); Index++)
+	{
+		const ASpaceRocksPawn* const Pawn = Craft[Index];
+		if (Pawn)
+		{
+			const FVector Velocity(Pawn->CurrentXAxisSpeed, Pawn->CurrentYAxisSpeed, Pawn->CurrentZAxisSpeed);
+			TargetTree.MoveProxy(Pawn->TargetProxy, Pawn->GetActorLocation(), Pawn->GetRootComponent()->Bounds.SphereRadius, Velocity * DeltaSeconds);
+		}
+	}
+
+	TargetRefitMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+void ASpaceRocksGameState::StepGravity(float DeltaSeconds)
+{
+	SPACEROCKS_TRACE_SCOPE(Gravity);
+	const double StartTime = FPlatformTime::Seconds();
+
+	// ** Gather the massive bodies: gravity wells and big rocks **
+
+	GravityBodies.Reset();
+	for (int32 Index = 0; Index < GravityWells.Num(); Index++)
+	{
+		GravityBodies.Add(FSpaceRocksGravityBody(GravityWells[Index].Location, GravityWells[Index].Mass));
+	}
+	for (int32 Index = 0; Index < SpaceRocks.Num(); Index++)
+	{
+		const ASpaceRocksRock* Rock = SpaceRocks[Index];
+		if (Rock && Rock->Mass >= MinGravityMass)
+		{
+			GravityBodies.Add(FSpaceRocksGravityBody(Rock->GetActorLocation(), Rock->Mass));
+		}
+	}
+
+	GravitySim.OpeningAngle = GravityOpeningAngle;
+	GravitySim.GravityConstant = GravityConstant;
+	GravitySim.Softening = GravitySoftening;
+	GravitySim.Build(GravityBodies);
+
+	// ** Gather everything that gets pulled: rocks, projectiles and player craft (in that order) **
+
+	TArray<ASpaceRocksPawn*, TInlineAllocator<4> > Pawns;
+	for (TActorIterator<ASpaceRocksPawn> It(GetWorld()); It; ++It)
+	{
+		Pawns.Add(*It);
+	}
+
+	GravityPositions.Reset();
+	for (int32 Index = 0; Index < SpaceRocks.Num(); Index++)
+	{
+		GravityPositions.Add(SpaceRocks[Index] ? SpaceRocks[Index]->GetActorLocation() : FVector::ZeroVector);
+	}
+	for (int32 Index = 0; Index < Projectiles.Num(); Index++)
+	{
+		GravityPositions.Add(Projectiles[Index] ? Projectiles[Index]->GetActorLocation() : FVector::ZeroVector);
+	}
+	for (int32 Index = 0; Index < Pawns.Num(); Index++)
+	{
+		GravityPositions.Add(Pawns[Index]->GetActorLocation());
+	}
+
+	GravitySim.ComputeAccelerations(GravityPositions, GravityAccelerations);
+
+	// ** Apply the accelerations **
+
+	int32 Body = 0;
+	for (int32 Index = 0; Index < SpaceRocks.Num(); Index++, Body++)
+	{
+		if (SpaceRocks[Index])
+		{
+			SpaceRocks[Index]->AddRockVelocity(GravityAccelerations[Body] * DeltaSeconds);
+		}
+	}
+	for (int32 Index = 0; Index < Projectiles.Num(); Index++, Body++)
+	{
+		if (Projectiles[Index])
+		{
+			Projectiles[Index]->ProjectileMovement->Velocity += GravityAccelerations[Body] * DeltaSeconds;
+		}
+	}
+	for (int32 Index = 0; Index < Pawns.Num(); Index++, Body++)
+	{
+		// The craft's root never rotates, so its axis speeds are world axis speeds
+		const FVector DeltaV = GravityAccelerations[Body] * DeltaSeconds;
+		Pawns[Index]->CurrentXAxisSpeed += DeltaV.X;
+		Pawns[Index]->CurrentYAxisSpeed += DeltaV.Y;
+		Pawns[Index]->CurrentZAxisSpeed += DeltaV.Z;
+	}
+
+	GravityStepMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+FSpaceRocksRockFieldParams ASpaceRocksGameState::GetRockFieldParams() const
+{
+	FSpaceRocksRockFieldParams Params;
+	Params.Seed = RockFieldSeed + curr_level;
+	Params.ArenaBounds = ArenaBounds;
+	Params.NumRocks = curr_spacerocks;
+	Params.Speed = curr_spacerock_speed;
+	Params.MinRadius = RockMinRadius;
+	Params.MaxRadius = RockMaxRadius;
+	Params.SizeExponent = RockSizeExponent;
+	Params.Spacing = RockSpacing;
+	Params.ClearRadius = RockClearRadius;
+
+	// Clear round the first player start, if the map has one
+	for (TActorIterator<APlayerStart> It(GetWorld()); It; ++It)
+	{
+		Params.ClearCentre = It->GetActorLocation();
+		break;
+	}
+	return Params;
+}
+
+void ASpaceRocksGameState::StartRockField()
+{
+	if (RockFieldTask)
+	{
+		RockFieldTask->EnsureCompletion();
+		delete RockFieldTask;
+	}
+
+	// Only the params are copied on the game thread - the generation itself runs on the thread pool
+	RockFieldTask = new FAsyncTask<FSpaceRocksRockFieldTask>(GetRockFieldParams());
+	RockFieldTask->StartBackgroundTask();
+
+	PendingRockSpawns.Reset();
+	NextRockSpawn = 0;
+}
+
+bool ASpaceRocksGameState::IsRockFieldPending() const
+{
+	return RockFieldTask != NULL || NextRockSpawn < PendingRockSpawns.Num();
+}
+
+void ASpaceRocksGameState::UpdateRockField()
+{
+	// ** Pick up a finished field **
+
+	if (RockFieldTask && RockFieldTask->IsDone())
+	{
+		FSpaceRocksRockFieldTask& Task = RockFieldTask->GetTask();
+		UE_LOG(LogFlying, Log, TEXT("Rock field seed %d: placed %d of %d rocks in %.2f ms"),
+			Task.Params.Seed, Task.Rocks.Num(), Task.Params.NumRocks, Task.GenerateSeconds * 1000.0);
+
+		Exchange(PendingRockSpawns, Task.Rocks);
+		NextRockSpawn = 0;
+
+		delete RockFieldTask;
+		RockFieldTask = NULL;
+	}
+
+	if ((NextRockSpawn >= PendingRockSpawns.Num() || !*RockClass) && PendingFragments.Num() == 0)
+	{
+		return;
+	}
+
+	// ** Spawn as many rocks as the frame budget allows - the rock field first, then fragments **
+
+	SPACEROCKS_TRACE_SCOPE(RockFieldSpawn);
+
+	const double EndTime = FPlatformTime::Seconds() + RockSpawnBudgetMs / 1000.0;
+	bool bInBudget = true;
+
+	while (bInBudget && NextRockSpawn < PendingRockSpawns.Num() && *RockClass)
+	{
+		SpawnRock(RockClass, PendingRockSpawns[NextRockSpawn++]);
+		bInBudget = FPlatformTime::Seconds() < EndTime;
+	}
+
+	if (NextRockSpawn >= PendingRockSpawns.Num())
+	{
+		PendingRockSpawns.Empty();
+		NextRockSpawn = 0;
+	}
+
+	int32 NumFragments = 0;
+	while (bInBudget && NumFragments < PendingFragments.Num())
+	{
+		const FSpaceRocksRockFragment& Fragment = PendingFragments[NumFragments++];
+		if (Fragment.RockClass.IsValid())
+		{
+			SpawnRock(Fragment.RockClass.Get(), Fragment.Spawn);
+		}
+		bInBudget = FPlatformTime::Seconds() < EndTime;
+	}
+	PendingFragments.RemoveAt(0, NumFragments);
+}
+
+ASpaceRocksRock* ASpaceRocksGameState::SpawnRock(UClass* Class, const FSpaceRocksRockSpawn& Spawn)
+{
+	const ASpaceRocksRock* const RockCDO = Class->GetDefaultObject<ASpaceRocksRock>();
+	const float BaseRadius = (RockCDO->RockMesh->StaticMesh) ? RockCDO->RockMesh->StaticMesh->GetBounds().SphereRadius : 100.f;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.bNoCollisionFail = true;
+
+	ASpaceRocksRock* const Rock = GetWorld()->SpawnActor<ASpaceRocksRock>(Class, Spawn.Location, Spawn.Rotation, SpawnParams);
+	if (Rock)
+	{
+		Rock->SetActorScale3D(FVector(Spawn.Radius / BaseRadius));
+		Rock->UpdateRockSize();
+		Rock->SetRockVelocity(Spawn.Velocity);
+	}
+	return Rock;
+}
+
+void ASpaceRocksGameState::QueueDamage(AActor* Target, float Amount, const FVector& Location, int32 InstigatorId)
+{
+	DamageQueue.Add(Target, Amount, Location, InstigatorId);
+}
+
+void ASpaceRocksGameState::ResolveDamage()
+{
+	if (DamageQueue.Num() == 0)
+	{
+		DamageHits = 0;
+		DamageTargets = 0;
+		DamageResolveMs = 0.f;
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_SpaceRocksDamageResolve);
+	SPACEROCKS_TRACE_SCOPE(Damage);
+	const double StartTime = FPlatformTime::Seconds();
+
+	// ** Merge the hits per target **
+
+	DamageHits = DamageQueue.Gather(TargetDamage);
+	DamageTargets = TargetDamage.Num();
+
+	// ** Apply them - one cast and one write per target, however many times it was hit **
+
+	DeadRocks.Reset();
+	for (int32 Index = 0; Index < TargetDamage.Num(); Index++)
+	{
+		const FSpaceRocksTargetDamage& Damage = TargetDamage[Index];
+
+		ASpaceRocksRock* const Rock = Cast<ASpaceRocksRock>(Damage.Target);
+		if (Rock)
+		{
+			Rock->Health -= Damage.Amount;
+			if (Rock->Health <= 0.f && Damage.Amount > 0.f)
+			{
+				DeadRocks.Add(Rock);
+			}
+			continue;
+		}
+
+		ASpaceRocksPawn* const Pawn = Cast<ASpaceRocksPawn>(Damage.Target);
+		if (Pawn)
+		{
+			Pawn->ShieldLevel = FMath::Max(Pawn->ShieldLevel - Damage.Amount, 0.f);
+		}
+	}
+
+	// ** Break up the rocks that were destroyed (their debris comes from ASpaceRocksRock::Destroyed) **
+
+	for (int32 Index = 0; Index < DeadRocks.Num(); Index++)
+	{
+		FractureRock(DeadRocks[Index]);
+		DeadRocks[Index]->Destroy();
+	}
+	DeadRocks.Reset();
+
+	DamageResolveMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+void ASpaceRocksGameState::SetCollisionMode(ESpaceRocksCollisionMode::Type Mode)
+{
+	CollisionMode = Mode;
+
+	for (int32 Index = 0; Index < SpaceRocks.Num(); Index++)
+	{
+		FSpaceRocksCollision::ApplyToRock(SpaceRocks[Index], Mode);
+	}
+	for (int32 Index = 0; Index < Projectiles.Num(); Index++)
+	{
+		FSpaceRocksCollision::ApplyToProjectile(Projectiles[Index], Mode);
+	}
+	for (int32 Index = 0; Index < Craft.Num(); Index++)
+	{
+		FSpaceRocksCollision::ApplyToCraft(Craft[Index], Mode);
+	}
+}
+
+void ASpaceRocksGameState::StartCollisionBench(int32 NumFrames)
+{
+	UE_LOG(LogFlying, Display, TEXT("Collision benchmark on %s: %d frames in each mode, %d rocks, %d projectiles, %d craft"),
+		*UWorld::RemovePIEPrefix(GetWorld()->GetMapName()), NumFrames, SpaceRocks.Num(), Projectiles.Num(), Craft.Num());
+
+	SetCollisionMode(CollisionBench.Start(NumFrames));
+}
+
+void ASpaceRocksGameState::StepRocks(float DeltaSeconds)
+{
+	if (CollisionMode != ESpaceRocksCollisionMode::QueryOnlyRocks)
+	{
+		return;		// Physics moves them
+	}
+
+	for (int32 Index = 0; Index < SpaceRocks.Num(); Index++)
+	{
+		SpaceRocks[Index]->StepKinematic(DeltaSeconds, ArenaBounds);
+	}
+}
+
+void ASpaceRocksGameState::QueueRay(const FSpaceRocksTargetRay& Ray, float Damage)
+{
+	AActor* const Shooter = const_cast<AActor*>(Ray.IgnoreActor);
+
+	FSpaceRocksHitscanShot Shot;
+	Shot.Shooter = Shooter;
+	Shot.InstigatorId = Shooter ? (int32)Shooter->GetUniqueID() : 0;
+	Shot.Damage = Damage;
+
+	PendingRays.Add(Ray);
+	PendingShots.Add(Shot);
+}
+
+void ASpaceRocksGameState::CastRays(const TArray<FSpaceRocksTargetRay>& Rays, TArray<FSpaceRocksTargetRayHit>& OutHits) const
+{
+	OutHits.Reset();
+	if (Rays.Num() == 0)
+	{
+		return;
+	}
+
+	// ** Rocks and craft: all the rays at once, through the target tree **
+
+	OutHits.AddUninitialized(Rays.Num());
+	TargetTree.RayCastBatch(Rays.GetData(), Rays.Num(), OutHits.GetData());
+
+	// ** Static arena geometry: an engine trace per ray, only as far as the ray's target, and only against static objects **
+
+	static const FName HitscanTraceTag(TEXT("SpaceRocksHitscan"));
+	FCollisionObjectQueryParams StaticObjects;
+	StaticObjects.AddObjectTypesToQuery(ECC_WorldStatic);
+	StaticObjects.AddObjectTypesToQuery(COLLISION_ARENA);
+
+	int32 NumHits = 0;
+	for (int32 Index = 0; Index < Rays.Num(); Index++)
+	{
+		const FSpaceRocksTargetRay& Ray = Rays[Index];
+		FSpaceRocksTargetRayHit Hit = OutHits[Index];
+		bool bHit = (Hit.Proxy != INDEX_NONE);
+
+		FHitResult StaticHit;
+		if (bHitscanStaticGeometry && Hit.Distance > 0.f
+			&& GetWorld()->LineTraceSingle(StaticHit, Ray.Origin, Ray.Origin + Ray.Direction * Hit.Distance, FCollisionQueryParams(HitscanTraceTag, false, Ray.IgnoreActor), StaticObjects))
+		{
+			Hit.Proxy = INDEX_NONE;
+			Hit.Actor = StaticHit.GetActor();
+			Hit.Distance *= StaticHit.Time;
+			bHit = true;
+		}
+
+		// Compact in place, keeping ray order
+		if (bHit)
+		{
+			OutHits[NumHits++] = Hit;
+		}
+	}
+	OutHits.RemoveAt(NumHits, OutHits.Num() - NumHits, false);
+}
+
+void ASpaceRocksGameState::ResolveHitscan()
+{
+	HitscanTracers.Reset();
+	if (PendingRays.Num() == 0)
+	{
+		HitscanCastMs = 0.f;
+		HitscanRaysCast = 0;
+		HitscanRaysHit = 0;
+		return;
+	}
+
+	SPACEROCKS_TRACE_SCOPE(Hitscan);
+	const double StartTime = FPlatformTime::Seconds();
+
+	// A shooter destroyed since it fired can't be ignored (or looked at) any more
+	for (int32 Index = 0; Index < PendingRays.Num(); Index++)
+	{
+		if (PendingRays[Index].IgnoreActor && !PendingShots[Index].Shooter.IsValid())
+		{
+			PendingRays[Index].IgnoreActor = NULL;
+		}
+	}
+
+	CastRays(PendingRays, RayHits);
+
+	// ** Cut the tracers short and queue the damage. Static geometry just soaks the ray up, and only craft flash their shields. **
+
+	HitscanTracers = PendingRays;
+	HitscanRaysHit = 0;
+	for (int32 Index = 0; Index < RayHits.Num(); Index++)
+	{
+		const FSpaceRocksTargetRayHit& Hit = RayHits[Index];
+		FSpaceRocksTargetRay& Tracer = HitscanTracers[Hit.Ray];
+		Tracer.Length = Hit.Distance;
+
+		if (Hit.Proxy == INDEX_NONE)
+		{
+			continue;
+		}
+
+		const FVector Location = Tracer.Origin + Tracer.Direction * Hit.Distance;
+		QueueDamage(Hit.Actor, PendingShots[Hit.Ray].Damage, Location, PendingShots[Hit.Ray].InstigatorId);
+		HitscanRaysHit++;
+
+		// A beam held on a rock would otherwise spend the debris budget every frame on an effect rocks don't have
+		const ASpaceRocksPawn* const HitCraft = Cast<ASpaceRocksPawn>(Hit.Actor);
+		if (Debris && HitCraft)
+		{
+			Debris->AddShieldHit(Location, -Tracer.Direction, FVector(HitCraft->CurrentXAxisSpeed, HitCraft->CurrentYAxisSpeed, HitCraft->CurrentZAxisSpeed));
+		}
+	}
+
+	HitscanRaysCast = PendingRays.Num();
+	PendingRays.Reset();
+	PendingShots.Reset();
+
+	HitscanCastMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+void ASpaceRocksGameState::FractureRock(ASpaceRocksRock* Rock)
+{
+	if (RockFragments <= 0 || Rock->Radius < RockFractureMinRadius)
+	{
+		return;
+	}
+
+	const FVector Location = Rock->GetActorLocation();
+	const FVector Velocity = Rock->GetRockVelocity();
+	const float FragmentRadius = Rock->Radius * 0.5f;
+
+	for (int32 Index = 0; Index < RockFragments; Index++)
+	{
+		// Each fragment flies out from the centre, on its own side
+		const FVector Direction = FMath::VRand();
+
+		FSpaceRocksRockFragment Fragment;
+		Fragment.RockClass = Rock->GetClass();
+		Fragment.Spawn.Location = Location + Direction * FragmentRadius;
+		Fragment.Spawn.Rotation = FRotator(FMath::FRandRange(-90.f, 90.f), FMath::FRandRange(-180.f, 180.f), FMath::FRandRange(-180.f, 180.f));
+		Fragment.Spawn.Velocity = Velocity + Direction * RockFragmentSpeed;
+		Fragment.Spawn.Radius = FragmentRadius;
+		PendingFragments.Add(Fragment);
+	}
+}
@@ -0,0 +1,352 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksGravity.h"
+#include "SpaceRocksTasks.h"
+
+DEFINE_STAT(STAT_SpaceRocksGravityBuild);
+DEFINE_STAT(STAT_SpaceRocksGravitySolve);
+
+// Bits per axis in the Morton codes, which is also the deepest the octree goes
+#define GRAVITY_MORTON_BITS 10
+
+// Spread the low 10 bits of a value out so there are two zero bits between each
+static FORCEINLINE uint32 SpreadBits3(uint32 x)
+{
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+// Child octant centre. Octant bits are X (4), Y (2), Z (1), matching the Morton interleave.
+static FORCEINLINE FVector OctantCentre(const FVector& Centre, float HalfSize, int32 Octant)
+{
+	const float Quarter = HalfSize * 0.5f;
+	return Centre + FVector(
+		(Octant & 4) ? Quarter : -Quarter,
+		(Octant & 2) ? Quarter : -Quarter,
+		(Octant & 1) ? Quarter : -Quarter);
+}
+
+FSpaceRocksGravitySim::FSpaceRocksGravitySim()
+	: OpeningAngle(0.5f)
+	, GravityConstant(1.f)
+	, Softening(100.f)
+	, LeafSize(8)
+	, LastBuildSeconds(0.0)
+	, LastSolveSeconds(0.0)
+{
+}
+
+void FSpaceRocksGravitySim::InitNode(FNode& Node, int32 BodyBegin, int32 BodyEnd, const FVector& Centre, float HalfSize) const
+{
+	Node.Centre = Centre;
+	Node.HalfSize = HalfSize;
+	Node.FirstChild = INDEX_NONE;
+	Node.NumChildren = 0;
+	Node.BodyBegin = BodyBegin;
+	Node.BodyEnd = BodyEnd;
+
+	// Total mass and centre of mass of everything under the node
+	FVector Weighted(0.f, 0.f, 0.f);
+	float Mass = 0.f;
+	for (int32 Index = BodyBegin; Index < BodyEnd; Index++)
+	{
+		const FSpaceRocksGravityBody& Body = SortedBodies[Index];
+		Weighted += Body.Position * Body.Mass;
+		Mass += Body.Mass;
+	}
+	Node.Mass = Mass;
+	Node.CentreOfMass = (Mass > 0.f) ? Weighted / Mass : Centre;
+}
+
+int32 FSpaceRocksGravitySim::SplitOctants(int32 BodyBegin, int32 BodyEnd, int32 Depth, int32 OutBegin[8], int32 OutEnd[8], int32 OutOctant[8]) const
+{
+	// Bodies are Morton sorted and share the same prefix above this depth, so each octant is one contiguous run
+	const uint32 Shift = 3 * (GRAVITY_MORTON_BITS - 1 - Depth);
+
+	int32 NumOctants = 0;
+	int32 Index = BodyBegin;
+	while (Index < BodyEnd)
+	{
+		const int32 Octant = (Morton[Index].Code >> Shift) & 7;
+		OutBegin[NumOctants] = Index;
+		while (Index < BodyEnd && (int32)((Morton[Index].Code >> Shift) & 7) == Octant)
+		{
+			Index++;
+		}
+		OutEnd[NumOctants] = Index;
+		OutOctant[NumOctants] = Octant;
+		NumOctants++;
+	}
+	return NumOctants;
+}
+
+void FSpaceRocksGravitySim::BuildNode(TArray<FNode>& OutNodes, int32 NodeIndex, int32 Depth) const
+{
+	const int32 BodyBegin = OutNodes[NodeIndex].BodyBegin;
+	const int32 BodyEnd = OutNodes[NodeIndex].BodyEnd;
+
+	if (BodyEnd - BodyBegin <= LeafSize || Depth >= GRAVITY_MORTON_BITS)
+	{
+		return;
+	}
+
+	int32 Begin[8], End[8], Octant[8];
+	const int32 NumOctants = SplitOctants(BodyBegin, BodyEnd, Depth, Begin, End, Octant);
+
+	const FVector Centre = OutNodes[NodeIndex].Centre;
+	const float HalfSize = OutNodes[NodeIndex].HalfSize;
+	const int32 FirstChild = OutNodes.Num();
+
+	OutNodes[NodeIndex].FirstChild = FirstChild;
+	OutNodes[NodeIndex].NumChildren = NumOctants;
+
+	// Children go in contiguously, then each one is built in turn (note OutNodes may reallocate)
+	OutNodes.AddUninitialized(NumOctants);
+	for (int32 Child = 0; Child < NumOctants; Child++)
+	{
+		InitNode(OutNodes[FirstChild + Child], Begin[Child], End[Child], OctantCentre(Centre, HalfSize, Octant[Child]), HalfSize * 0.5f);
+	}
+	for (int32 Child = 0; Child < NumOctants; Child++)
+	{
+		BuildNode(OutNodes, FirstChild + Child, Depth + 1);
+	}
+}
+
+void FSpaceRocksGravitySim::Build(const TArray<FSpaceRocksGravityBody>& Bodies)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpaceRocksGravityBuild);
+	const double StartTime = FPlatformTime::Seconds();
+
+	const int32 NumSources = Bodies.Num();
+	Nodes.Reset();
+	Morton.Reset();
+	SortedBodies.Reset();
+
+	if (NumSources == 0)
+	{
+		LastBuildSeconds = FPlatformTime::Seconds() - StartTime;
+		return;
+	}
+
+	// ** Bounding cube around every body **
+
+	FBox Bounds(0);
+	for (int32 Index = 0; Index < NumSources; Index++)
+	{
+		Bounds += Bodies[Index].Position;
+	}
+	const FVector Centre = Bounds.GetCenter();
+	const float HalfSize = FMath::Max(Bounds.GetExtent().GetMax() * 1.001f, 1.f);
+	const FVector Min = Centre - FVector(HalfSize, HalfSize, HalfSize);
+	const float Scale = (float)((1 << GRAVITY_MORTON_BITS) - 1) / (2.f * HalfSize);
+
+	// ** Morton sort the bodies, so every node covers a contiguous run of them **
+
+	Morton.AddUninitialized(NumSources);
+	SpaceRocksParallelFor(NumSources, [&](int32 Index)
+	{
+		const FVector Local = (Bodies[Index].Position - Min) * Scale;
+		Morton[Index].Code = (SpreadBits3((uint32)Local.X) << 2) | (SpreadBits3((uint32)Local.Y) << 1) | SpreadBits3((uint32)Local.Z);
+		Morton[Index].Index = Index;
+	}, 1024);
+	Morton.Sort();
+
+	SortedBodies.AddUninitialized(NumSources);
+	SpaceRocksParallelFor(NumSources, [&](int32 Index)
+	{
+		SortedBodies[Index] = Bodies[Morton[Index].Index];
+	}, 1024);
+
+	// ** Build the tree. The root's octants are independent, so they are built on worker threads then stitched together **
+
+	Nodes.AddUninitialized(1);
+	InitNode(Nodes[0], 0, NumSources, Centre, HalfSize);
+
+	if (NumSources > LeafSize)
+	{
+		int32 Begin[8], End[8], Octant[8];
+		const int32 NumOctants = SplitOctants(0, NumSources, 0, Begin, End, Octant);
+
+		TArray<FNode> SubTrees[8];
+		SpaceRocksParallelFor(NumOctants, [&](int32 Child)
+		{
+			SubTrees[Child].AddUninitialized(1);
+			InitNode(SubTrees[Child][0], Begin[Child], End[Child], OctantCentre(Centre, HalfSize, Octant[Child]), HalfSize * 0.5f);
+			BuildNode(SubTrees[Child], 0, 1);
+		}, 1);
+
+		Nodes[0].FirstChild = 1;
+		Nodes[0].NumChildren = NumOctants;
+		Nodes.AddUninitialized(NumOctants);
+
+		for (int32 Child = 0; Child < NumOctants; Child++)
+		{
+			// Sub tree node 0 goes in the root's child slot, the rest are appended. Remap child indices to match.
+			const TArray<FNode>& SubTree = SubTrees[Child];
+			const int32 Base = Nodes.Num() - 1;
+
+			for (int32 Index = 0; Index < SubTree.Num(); Index++)
+			{
+				FNode Node = SubTree[Index];
+				if (Node.FirstChild != INDEX_NONE)
+				{
+					Node.FirstChild += Base;
+				}
+
+				if (Index == 0)
+				{
+					Nodes[1 + Child] = Node;
+				}
+				else
+				{
+					Nodes.Add(Node);
+				}
+			}
+		}
+	}
+
+	LastBuildSeconds = FPlatformTime::Seconds() - StartTime;
+}
+
+FVector FSpaceRocksGravitySim::AccelerationAt(const FVector& Position) const
+{
+	if (Nodes.Num() == 0)
+	{
+		return FVector::ZeroVector;
+	}
+
+	const float Theta2 = OpeningAngle * OpeningAngle;
+	const float Soft2 = Softening * Softening;
+
+	// Deepest path is GRAVITY_MORTON_BITS levels with at most 7 siblings left on the stack per level
+	int32 Stack[8 * (GRAVITY_MORTON_BITS + 1)];
+	int32 StackSize = 0;
+	Stack[StackSize++] = 0;
+
+	FVector Acc(0.f, 0.f, 0.f);
+	while (StackSize > 0)
+	{
+		const FNode& Node = Nodes[Stack[--StackSize]];
+
+		if (Node.FirstChild == INDEX_NONE)
+		{
+			// Leaf, add each body directly. A body exactly at Position contributes nothing, so no self check is needed.
+			for (int32 Index = Node.BodyBegin; Index < Node.BodyEnd; Index++)
+			{
+				const FSpaceRocksGravityBody& Body = SortedBodies[Index];
+				const FVector Delta = Body.Position - Position;
+				const float InvDist = FMath::InvSqrt(Delta.SizeSquared() + Soft2);
+				Acc += Delta * (Body.Mass * InvDist * InvDist * InvDist);
+			}
+			continue;
+		}
+
+		const FVector Delta = Node.CentreOfMass - Position;
+		const float Dist2 = Delta.SizeSquared() + Soft2;
+		const float Size = 2.f * Node.HalfSize;
+
+		if (Size * Size < Theta2 * Dist2)
+		{
+			// Far enough away to treat the whole node as one mass
+			const float InvDist = FMath::InvSqrt(Dist2);
+			Acc += Delta * (Node.Mass * InvDist * InvDist * InvDist);
+		}
+		else
+		{
+			for (int32 Child = 0; Child < Node.NumChildren; Child++)
+			{
+				Stack[StackSize++] = Node.FirstChild + Child;
+			}
+		}
+	}
+
+	return Acc * GravityConstant;
+}
+
+FVector FSpaceRocksGravitySim::AccelerationAtExact(const FVector& Position) const
+{
+	const float Soft2 = Softening * Softening;
+
+	FVector Acc(0.f, 0.f, 0.f);
+	for (int32 Index = 0; Index < SortedBodies.Num(); Index++)
+	{
+		const FSpaceRocksGravityBody& Body = SortedBodies[Index];
+		const FVector Delta = Body.Position - Position;
+		const float InvDist = FMath::InvSqrt(Delta.SizeSquared() + Soft2);
+		Acc += Delta * (Body.Mass * InvDist * InvDist * InvDist);
+	}
+	return Acc * GravityConstant;
+}
+
+void FSpaceRocksGravitySim::ComputeAccelerations(const TArray<FVector>& Positions, TArray<FVector>& OutAccelerations) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpaceRocksGravitySolve);
+	const double StartTime = FPlatformTime::Seconds();
+
+	OutAccelerations.Reset();
+	OutAccelerations.AddUninitialized(Positions.Num());
+
+	SpaceRocksParallelFor(Positions.Num(), [&](int32 Index)
+	{
+		OutAccelerations[Index] = AccelerationAt(Positions[Index]);
+	});
+
+	LastSolveSeconds = FPlatformTime::Seconds() - StartTime;
+}
+
+void FSpaceRocksGravitySim::RunBenchmark(int32 MaxBodies, float OpeningAngle)
+{
+	const int32 NumIterations = 5;
+	const int32 NumErrorSamples = 64;
+
+	UE_LOG(LogFlying, Display, TEXT("Gravity benchmark: opening angle %.2f, %d iterations per size"), OpeningAngle, NumIterations);
+
+	for (int32 NumSources = 100; NumSources <= MaxBodies; NumSources *= 10)
+	{
+		// Random field of rocks in a 1km cube
+		FRandomStream Random(NumSources);
+		TArray<FSpaceRocksGravityBody> Bodies;
+		TArray<FVector> Positions;
+		Bodies.AddUninitialized(NumSources);
+		Positions.AddUninitialized(NumSources);
+		for (int32 Index = 0; Index < NumSources; Index++)
+		{
+			Positions[Index] = FVector(Random.FRandRange(-50000.f, 50000.f), Random.FRandRange(-50000.f, 50000.f), Random.FRandRange(-50000.f, 50000.f));
+			Bodies[Index] = FSpaceRocksGravityBody(Positions[Index], Random.FRandRange(1000.f, 100000.f));
+		}
+
+		FSpaceRocksGravitySim Sim;
+		Sim.OpeningAngle = OpeningAngle;
+
+		TArray<FVector> Accelerations;
+		double BuildSeconds = 0.0;
+		double SolveSeconds = 0.0;
+		for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+		{
+			Sim.Build(Bodies);
+			Sim.ComputeAccelerations(Positions, Accelerations);
+			BuildSeconds += Sim.LastBuildSeconds;
+			SolveSeconds += Sim.LastSolveSeconds;
+		}
+
+		// RMS relative error against brute force, on a few bodies
+		double ErrorSum = 0.0;
+		for (int32 Sample = 0; Sample < NumErrorSamples; Sample++)
+		{
+			const int32 Index = Random.RandHelper(NumSources);
+			const FVector Exact = Sim.AccelerationAtExact(Positions[Index]);
+			const float ExactSize = FMath::Max(Exact.Size(), SMALL_NUMBER);
+			ErrorSum += FMath::Square((Accelerations[Index] - Exact).Size() / ExactSize);
+		}
+
+		UE_LOG(LogFlying, Display, TEXT("  %6d bodies: %4d nodes, build %.3f ms, solve %.3f ms, step %.3f ms, rms error %.4f%%"),
+			NumSources, Sim.NumNodes(),
+			BuildSeconds * 1000.0 / NumIterations, SolveSeconds * 1000.0 / NumIterations, (BuildSeconds + SolveSeconds) * 1000.0 / NumIterations,
+			FMath::Sqrt(ErrorSum / NumErrorSamples) * 100.0);
+	}
+}
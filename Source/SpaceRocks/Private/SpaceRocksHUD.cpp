@@ -0,0 +1,177 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksHUD.h"
+#include "SpaceRocksPawn.h"
+#include "SpaceRocksRock.h"
+#include "SpaceRocksGameState.h"
+
+ASpaceRocksHUD::ASpaceRocksHUD(const class FPostConstructInitializeProperties& PCIP)
+	: Super(PCIP)
+{
+	bShowRadar = true;
+	RadarUpdateRate = 4.f;
+	RadarRange = 20000.f;
+	RadarGridCells = 16;
+	RadarMaxThreats = 4;
+	RadarScreenSize = 0.15f;
+}
+
+void ASpaceRocksHUD::DrawHUD()
+{
+	Super::DrawHUD();
+
+	if (bShowRadar)
+	{
+		Radar.UpdateRate = RadarUpdateRate;
+		Radar.Params.Range = RadarRange;
+		Radar.Params.GridCells = RadarGridCells;
+		Radar.Params.MaxThreats = RadarMaxThreats;
+		Radar.Update(GetWorld(), Cast<ASpaceRocksPawn>(GetOwningPawn()));
+
+		DrawRadar();
+	}
+
+	DrawTracers();
+	DrawLockOn();
+}
+
+void ASpaceRocksHUD::DrawTracers()
+{
+	const ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState == NULL)
+	{
+		return;
+	}
+
+	const FLinearColor TracerColour(0.3f, 0.9f, 1.f);
+	const TArray<FSpaceRocksTargetRay>& Tracers = GameState->GetHitscanTracers();
+	for (int32 Index = 0; Index < Tracers.Num(); Index++)
+	{
+		const FSpaceRocksTargetRay& Tracer = Tracers[Index];
+		const FVector Start = Project(Tracer.Origin);
+		const FVector End = Project(Tracer.Origin + Tracer.Direction * Tracer.Length);
+		if (Start.Z <= 0.f || End.Z <= 0.f)
+		{
+			continue;	// Behind the camera
+		}
+		DrawLine(Start.X, Start.Y, End.X, End.Y, TracerColour);
+	}
+}
+
+void ASpaceRocksHUD::DrawLockOn()
+{
+	const ASpaceRocksPawn* const Pawn = Cast<ASpaceRocksPawn>(GetOwningPawn());
+	if (Pawn == NULL)
+	{
+		return;
+	}
+
+	const FLinearColor LockColour(1.f, 0.8f, 0.1f);
+	for (int32 Index = 0; Index < Pawn->LockedTargets.Num(); Index++)
+	{
+		const AActor* const Target = Pawn->LockedTargets[Index];
+		if (Target == NULL)
+		{
+			continue;
+		}
+
+		// Bracket sized to the target's bounds on screen
+		const ASpaceRocksRock* const Rock = Cast<ASpaceRocksRock>(Target);
+		const float Radius = Rock ? Rock->Radius : Target->GetRootComponent()->Bounds.SphereRadius;
+		const FVector Location = Target->GetActorLocation();
+		const FVector Centre = Project(Location);
+		const FVector Edge = Project(Location + Pawn->PlaneMesh->GetUpVector() * Radius);
+		if (Centre.Z <= 0.f)
+		{
+			continue;	// Behind the camera
+		}
+
+		const float Half = FMath::Max(FVector2D(Edge.X - Centre.X, Edge.Y - Centre.Y).Size(), 8.f);
+		const float Corner = Half * 0.4f;
+		for (int32 SignX = -1; SignX <= 1; SignX += 2)
+		{
+			for (int32 SignY = -1; SignY <= 1; SignY += 2)
+			{
+				const float X = Centre.X + SignX * Half;
+				const float Y = Centre.Y + SignY * Half;
+				DrawLine(X, Y, X - SignX * Corner, Y, LockColour);
+				DrawLine(X, Y, X, Y - SignY * Corner, LockColour);
+			}
+		}
+
+		// The nearest target is the primary lock
+		if (Index == 0)
+		{
+			DrawText(FString::Printf(TEXT("%.0fm"), (Location - Pawn->GetActorLocation()).Size() / 100.f), LockColour, Centre.X + Half + 4.f, Centre.Y - Half);
+		}
+	}
+}
+
+FVector2D ASpaceRocksHUD::RadarToScreen(const FVector& Local, const FVector2D& Centre, float Size, FVector2D& OutBase) const
+{
+	// Disc tilted away from the viewer: forward is up the screen, right is right, height is a stem off the disc
+	const float Scale = Size / FMath::Max(Radar.GetResult().Range, 1.f);
+	OutBase = FVector2D(Centre.X + Local.Y * Scale, Centre.Y - Local.X * Scale * 0.5f);
+	return FVector2D(OutBase.X, OutBase.Y - Local.Z * Scale * 0.5f);
+}
+
+void ASpaceRocksHUD::DrawRadar()
+{
+	const FSpaceRocksRadarResult& Result = Radar.GetResult();
+
+	const float Size = Canvas->ClipY * RadarScreenSize;
+	const FVector2D Centre(Canvas->ClipX - Size * 1.2f, Canvas->ClipY - Size * 0.8f);
+
+	// ** Disc and craft **
+
+	const FLinearColor DiscColour(0.1f, 0.6f, 0.1f, 0.6f);
+	const int32 NumSegments = 32;
+	for (int32 Segment = 0; Segment < NumSegments; Segment++)
+	{
+		const float A0 = (2.f * PI * Segment) / NumSegments;
+		const float A1 = (2.f * PI * (Segment + 1)) / NumSegments;
+		DrawLine(Centre.X + FMath::Cos(A0) * Size, Centre.Y + FMath::Sin(A0) * Size * 0.5f,
+			Centre.X + FMath::Cos(A1) * Size, Centre.Y + FMath::Sin(A1) * Size * 0.5f, DiscColour);
+	}
+	DrawLine(Centre.X - Size, Centre.Y, Centre.X + Size, Centre.Y, DiscColour);
+	DrawLine(Centre.X, Centre.Y - Size * 0.5f, Centre.X, Centre.Y + Size * 0.5f, DiscColour);
+	DrawRect(FLinearColor::White, Centre.X - 2.f, Centre.Y - 2.f, 4.f, 4.f);
+
+	// ** Blips - bigger for more (or bigger) rocks **
+
+	const FLinearColor BlipColours[ESpaceRocksRadarContact::NUM_TYPES] =
+	{
+		FLinearColor(0.8f, 0.7f, 0.5f),		// Rock
+		FLinearColor(1.f, 0.3f, 1.f),		// Projectile
+	};
+
+	for (int32 Index = 0; Index < Result.Blips.Num(); Index++)
+	{
+		const FSpaceRocksRadarBlip& Blip = Result.Blips[Index];
+
+		FVector2D Base;
+		const FVector2D Pos = RadarToScreen(Blip.Location, Centre, Size, Base);
+		const float BlipSize = FMath::Clamp(2.f + FMath::Loge((float)Blip.Count) + Blip.Radius / 500.f, 2.f, 8.f);
+
+		DrawLine(Base.X, Base.Y, Pos.X, Pos.Y, DiscColour);
+		DrawRect(BlipColours[Blip.Type], Pos.X - BlipSize * 0.5f, Pos.Y - BlipSize * 0.5f, BlipSize, BlipSize);
+	}
+
+	// ** Threats, with seconds to impact **
+
+	const FLinearColor ThreatColour(1.f, 0.1f, 0.1f);
+	for (int32 Index = 0; Index < Result.Threats.Num(); Index++)
+	{
+		const FSpaceRocksRadarThreat& Threat = Result.Threats[Index];
+
+		FVector2D Base;
+		const FVector2D Pos = RadarToScreen(Threat.Location, Centre, Size, Base);
+
+		DrawLine(Pos.X - 6.f, Pos.Y - 6.f, Pos.X + 6.f, Pos.Y + 6.f, ThreatColour);
+		DrawLine(Pos.X - 6.f, Pos.Y + 6.f, Pos.X + 6.f, Pos.Y - 6.f, ThreatColour);
+		DrawText(FString::Printf(TEXT("%.1fs"), Threat.TimeToImpact), ThreatColour, Pos.X + 8.f, Pos.Y - 6.f);
+	}
+
+	DrawText(FString::Printf(TEXT("%d contacts"), Result.NumContacts), DiscColour, Centre.X - Size, Centre.Y + Size * 0.5f + 4.f);
+}
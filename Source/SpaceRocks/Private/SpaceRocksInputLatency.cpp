@@ -0,0 +1,188 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksInputLatency.h"
+#include "SpaceRocksTrace.h"
+
+static const TCHAR* ControlNames[ESpaceRocksControl::NUM_CONTROLS] =
+{
+	TEXT("Pitch"), TEXT("Yaw"), TEXT("Roll"), TEXT("RearThrust"), TEXT("SideThrust"), TEXT("BottomThrust")
+};
+
+void FSpaceRocksLatencyHistogram::Reset()
+{
+	FMemory::Memzero(Buckets, sizeof(Buckets));
+	Count = 0;
+	SumMs = 0.0;
+	MinMs = 0.f;
+	MaxMs = 0.f;
+}
+
+float FSpaceRocksLatencyHistogram::BucketUpperMs(int32 Bucket)
+{
+	return 0.1f * FMath::Pow(2.f, (Bucket + 1) * 0.5f);
+}
+
+void FSpaceRocksLatencyHistogram::Add(float Ms)
+{
+	// Bucket from log2(Ms / 0.1) in half octaves
+	const int32 Bucket = (Ms <= 0.1f) ? 0 : FMath::Clamp(FMath::FloorToInt(2.f * FMath::Log2(Ms / 0.1f)), 0, NumBuckets - 1);
+	Buckets[Bucket]++;
+
+	MinMs = Count ? FMath::Min(MinMs, Ms) : Ms;
+	MaxMs = Count ? FMath::Max(MaxMs, Ms) : Ms;
+	SumMs += Ms;
+	Count++;
+}
+
+float FSpaceRocksLatencyHistogram::Percentile(float Fraction) const
+{
+	const uint32 Target = (uint32)FMath::CeilToInt(Fraction * Count);
+	uint32 Total = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets; Bucket++)
+	{
+		Total += Buckets[Bucket];
+		if (Total >= Target && Total > 0)
+		{
+			return FMath::Min(BucketUpperMs(Bucket), MaxMs);
+		}
+	}
+	return MaxMs;
+}
+
+FString FSpaceRocksLatencyHistogram::Summary() const
+{
+	return FString::Printf(TEXT("%6d samples, mean %6.2f ms, min %6.2f, p50 %6.2f, p95 %6.2f, p99 %6.2f, max %6.2f"),
+		Count, MeanMs(), MinMs, Percentile(0.5f), Percentile(0.95f), Percentile(0.99f), MaxMs);
+}
+
+double FSpaceRocksInputLatency::ArrivalTimes[FSpaceRocksInputLatency::MAX_CONTROLLERS] = { 0.0 };
+
+FSpaceRocksInputLatency::FSpaceRocksInputLatency()
+	: ControllerId(INDEX_NONE)
+{
+	Reset();
+}
+
+void FSpaceRocksInputLatency::NoteArrival(int32 ControllerId)
+{
+	if (ControllerId >= 0 && ControllerId < MAX_CONTROLLERS)
+	{
+		ArrivalTimes[ControllerId] = FPlatformTime::Seconds();
+	}
+}
+
+void FSpaceRocksInputLatency::Reset()
+{
+	for (int32 Control = 0; Control < ESpaceRocksControl::NUM_CONTROLS; Control++)
+	{
+		Histograms[Control].Reset();
+		LastValue[Control] = 0.f;
+		PendingTime[Control] = 0.0;
+	}
+}
+
+void FSpaceRocksInputLatency::OnInput(ESpaceRocksControl::Type Control, float Value)
+{
+	// Axis handlers are called every frame, so only changes are new samples
+	if (Value == LastValue[Control])
+	{
+		return;
+	}
+	LastValue[Control] = Value;
+
+	if (Control >= ESpaceRocksControl::RearThrust)
+	{
+		SPACEROCKS_TRACE_EVENT(Thrust, Control - ESpaceRocksControl::RearThrust, Value);
+	}
+
+	// Time from the oldest sample not yet applied: when its event arrived if it was since the previous frame
+	// began, otherwise the start of this frame
+	if (PendingTime[Control] == 0.0)
+	{
+		const double FrameStart = FApp::GetCurrentTime();
+		const double Arrival = (ControllerId >= 0 && ControllerId < MAX_CONTROLLERS) ? ArrivalTimes[ControllerId] : 0.0;
+		PendingTime[Control] = (Arrival > FrameStart - FApp::GetDeltaTime()) ? Arrival : FrameStart;
+
+		// Fixed time steps (-benchmark) don't run on the real clock
+		if (FApp::UseFixedTimeStep())
+		{
+			PendingTime[Control] = FPlatformTime::Seconds();
+		}
+	}
+}
+
+void FSpaceRocksInputLatency::OnApplied(ESpaceRocksControl::Type FirstControl, ESpaceRocksControl::Type LastControl)
+{
+	const double Now = FPlatformTime::Seconds();
+	for (int32 Control = FirstControl; Control <= LastControl; Control++)
+	{
+		if (PendingTime[Control] != 0.0)
+		{
+			const float Ms = (float)((Now - PendingTime[Control]) * 1000.0);
+			Histograms[Control].Add(Ms);
+			PendingTime[Control] = 0.0;
+
+			SPACEROCKS_TRACE_EVENT(InputLatency, Control, Ms / 1000.f);
+		}
+	}
+}
+
+FSpaceRocksLatencyHistogram FSpaceRocksInputLatency::GetCombined() const
+{
+	FSpaceRocksLatencyHistogram Combined;
+	for (int32 Control = 0; Control < ESpaceRocksControl::NUM_CONTROLS; Control++)
+	{
+		const FSpaceRocksLatencyHistogram& Histogram = Histograms[Control];
+		if (Histogram.Count == 0)
+		{
+			continue;
+		}
+
+		for (int32 Bucket = 0; Bucket < FSpaceRocksLatencyHistogram::NumBuckets; Bucket++)
+		{
+			Combined.Buckets[Bucket] += Histogram.Buckets[Bucket];
+		}
+		Combined.MinMs = Combined.Count ? FMath::Min(Combined.MinMs, Histogram.MinMs) : Histogram.MinMs;
+		Combined.MaxMs = Combined.Count ? FMath::Max(Combined.MaxMs, Histogram.MaxMs) : Histogram.MaxMs;
+		Combined.SumMs += Histogram.SumMs;
+		Combined.Count += Histogram.Count;
+	}
+	return Combined;
+}
+
+void FSpaceRocksInputLatency::LogReport(const FString& Label) const
+{
+	UE_LOG(LogFlying, Display, TEXT("Input latency (%s), input arrival to applied in Tick:"), *Label);
+	for (int32 Control = 0; Control < ESpaceRocksControl::NUM_CONTROLS; Control++)
+	{
+		UE_LOG(LogFlying, Display, TEXT("  %-12s %s"), ControlNames[Control], *Histograms[Control].Summary());
+	}
+
+	const FSpaceRocksLatencyHistogram Combined = GetCombined();
+	UE_LOG(LogFlying, Display, TEXT("  %-12s %s"), TEXT("All"), *Combined.Summary());
+	if (Combined.Count == 0)
+	{
+		return;
+	}
+
+	// Bar chart over the occupied range of buckets
+	uint32 Largest = 0;
+	int32 FirstBucket = FSpaceRocksLatencyHistogram::NumBuckets;
+	int32 LastBucket = 0;
+	for (int32 Bucket = 0; Bucket < FSpaceRocksLatencyHistogram::NumBuckets; Bucket++)
+	{
+		if (Combined.Buckets[Bucket])
+		{
+			Largest = FMath::Max(Largest, Combined.Buckets[Bucket]);
+			FirstBucket = FMath::Min(FirstBucket, Bucket);
+			LastBucket = Bucket;
+		}
+	}
+
+	for (int32 Bucket = FirstBucket; Bucket <= LastBucket; Bucket++)
+	{
+		const int32 BarLength = (int32)((40ull * Combined.Buckets[Bucket] + Largest - 1) / Largest);
+		UE_LOG(LogFlying, Display, TEXT("  <= %8.2f ms %6u %s"), FSpaceRocksLatencyHistogram::BucketUpperMs(Bucket), Combined.Buckets[Bucket], *FString::ChrN(BarLength, TEXT('#')));
+	}
+}
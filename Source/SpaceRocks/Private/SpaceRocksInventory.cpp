@@ -0,0 +1,129 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksInventory.h"
+
+FSpaceRocksInventory::FSpaceRocksInventory()
+{
+	FMemory::Memzero(weaponInventory, sizeof(weaponInventory));
+	FMemory::Memzero(ammo, sizeof(ammo));
+	FMemory::Memzero(cooldown, sizeof(cooldown));
+	FMemory::Memzero(items, sizeof(items));
+}
+
+void FSpaceRocksInventory::Reset(const FSpaceRocksWeaponInfo& WeapInfo)
+{
+	*this = FSpaceRocksInventory();
+
+	weaponInventory[0] = ESpaceRocksWeapon::PHASEOID;
+	ammo[0] = WeapInfo.Get(ESpaceRocksWeapon::PHASEOID).StartAmmo;
+}
+
+int32 FSpaceRocksInventory::AddToWeapInv(int32 WeaponID, const FSpaceRocksWeaponInfo& WeapInfo)
+{
+	if (WeaponID <= ESpaceRocksWeapon::EMPTY || WeaponID >= WeapInfo.Num() || WeaponID > MAX_uint8)
+	{
+		return -1;
+	}
+
+	// Already have it? Treat it as an ammo pack
+	for (int32 slot = 0; slot < NUM_WEAP_SLOTS; slot++)
+	{
+		if (weaponInventory[slot] == WeaponID)
+		{
+			return AddToAmmo(WeaponID, WeapInfo) ? slot : -1;
+		}
+	}
+
+	for (int32 slot = 0; slot < NUM_WEAP_SLOTS; slot++)
+	{
+		if (weaponInventory[slot] == ESpaceRocksWeapon::EMPTY)
+		{
+			weaponInventory[slot] = (uint8)WeaponID;
+			ammo[slot] = WeapInfo.Get(WeaponID).StartAmmo;
+			cooldown[slot] = 0.f;
+			return slot;
+		}
+	}
+
+	return -1;
+}
+
+bool FSpaceRocksInventory::AddToAmmo(int32 WeaponID, const FSpaceRocksWeaponInfo& WeapInfo)
+{
+	const FSpaceRocksWeaponDef& Def = WeapInfo.Get(WeaponID);
+
+	for (int32 slot = 0; slot < NUM_WEAP_SLOTS; slot++)
+	{
+		if (weaponInventory[slot] != WeaponID || WeaponID == ESpaceRocksWeapon::EMPTY)
+		{
+			continue;
+		}
+
+		// Unlimited, or already full
+		if (ammo[slot] < 0 || (Def.MaxAmmo >= 0 && ammo[slot] >= Def.MaxAmmo))
+		{
+			return false;
+		}
+
+		ammo[slot] += Def.AmmoPerPickup;
+		if (Def.MaxAmmo >= 0 && ammo[slot] > Def.MaxAmmo) ammo[slot] = Def.MaxAmmo;
+		return true;
+	}
+
+	return false;
+}
+
+bool FSpaceRocksInventory::AddToInv(int32 PUtype)
+{
+	if (PUtype <= 0 || PUtype > MAX_uint8)
+	{
+		return false;
+	}
+
+	for (int32 slot = 0; slot < NUM_INV_SLOTS; slot++)
+	{
+		if (items[slot] == 0)
+		{
+			items[slot] = (uint8)PUtype;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool FSpaceRocksInventory::LookForInv(int32 PUtype) const
+{
+	for (int32 slot = 0; slot < NUM_INV_SLOTS; slot++)
+	{
+		if (items[slot] == PUtype && PUtype != 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool FSpaceRocksInventory::Serialize(FArchive& Ar)
+{
+	// Everything is fixed size, so serialize it as flat blocks
+	Ar.Serialize(weaponInventory, sizeof(weaponInventory));
+	for (int32 slot = 0; slot < NUM_WEAP_SLOTS; slot++)
+	{
+		Ar << ammo[slot];
+	}
+	for (int32 slot = 0; slot < NUM_WEAP_SLOTS; slot++)
+	{
+		Ar << cooldown[slot];
+	}
+	Ar.Serialize(items, sizeof(items));
+	return true;
+}
+
+bool FSpaceRocksInventory::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = Serialize(Ar);
+	return true;
+}
@@ -2,6 +2,13 @@
 
 #include "SpaceRocks.h"
 #include "SpaceRocksPawn.h"
+#include "SpaceRocksProjectile.h"
+#include "SpaceRocksGameState.h"
+#include "SpaceRocksTrace.h"
+#include "SpaceRocksFlight.h"
+#include "SpaceRocksDebris.h"
+#include "SpaceRocksCollision.h"
+#include "Net/UnrealNetwork.h"
 
 ASpaceRocksPawn::ASpaceRocksPawn(const class FPostConstructInitializeProperties& PCIP) 
 	: Super(PCIP)
@@ -30,7 +37,7 @@ ASpaceRocksPawn::ASpaceRocksPawn(const class FPostConstructInitializeProperties&
 	RootComponent = ShieldMesh;
 	// Turn on physics for static mesh - how cool is this! Craft will be subject to world physics (e.g. fall due to gravity etc)
 	ShieldMesh->SetSimulatePhysics(false);
-	ShieldMesh->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	ShieldMesh->SetCollisionProfileName(FSpaceRocksCollision::CraftProfile);
 
 
 
@@ -124,16 +131,62 @@ ASpaceRocksPawn::ASpaceRocksPawn(const class FPostConstructInitializeProperties&
 	CrossHair_TraceParams.bReturnPhysicalMaterial = false;
 	CrossHair_Hit = FHitResult(ForceInit);
 
-	//Set Up Inventories
+	// Set Up Helpers (weapon table is compiled in PostInitializeComponents)
 
-	//PlayerInv = ReconOneInventory();
+	WeaponTable = NULL;
+	DefaultProjectileClass = ASpaceRocksProjectile::StaticClass();
 
-	// Set Up Helpers
+	//Set Up Inventories
 
-	//WeapInfo = ReconOneWeaponInfo();
+	PlayerInv.Reset(WeapInfo);
 
 	// Behaviour
-	//ShieldLevel = MAX_SHIELD;
+	ShieldLevel = MAX_SHIELD;
+
+	// Lock-on
+	LockOnHalfAngle = 15.f;
+	LockOnRange = 20000.f;
+	MaxLockTargets = 4;
+	TargetProxy = INDEX_NONE;
+	bFlownByGameState = false;
+}
+
+void ASpaceRocksPawn::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Compile the weapon DataTable into a flat array, so firing never needs to look anything up
+	WeapInfo.Compile(WeaponTable, *DefaultProjectileClass);
+	PlayerInv.Reset(WeapInfo);
+}
+
+void ASpaceRocksPawn::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState)
+	{
+		GameState->RegisterCraft(this);
+	}
+}
+
+void ASpaceRocksPawn::Destroyed()
+{
+	ASpaceRocksGameState* const GameState = GetWorld() ? Cast<ASpaceRocksGameState>(GetWorld()->GameState) : NULL;
+	if (GameState)
+	{
+		GameState->UnregisterCraft(this);
+	}
+
+	Super::Destroyed();
+}
+
+void ASpaceRocksPawn::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ASpaceRocksPawn, PlayerInv);
 }
 
 void ASpaceRocksPawn::OnConstruction(const FTransform& Transform)
@@ -157,13 +210,14 @@ void ASpaceRocksPawn::OnConstruction(const FTransform& Transform)
 
 }
 
-void ASpaceRocksPawn::Tick(float DeltaSeconds)
+void ASpaceRocksPawn::StepFlight(float DeltaSeconds)
 {
 	const FVector LocalMove = FVector(CurrentXAxisSpeed * DeltaSeconds, CurrentYAxisSpeed * DeltaSeconds, CurrentZAxisSpeed * DeltaSeconds);
 
 	// Move Craft's Root Component through X,Y and Z axis (with sweep so we stop when we collide with things)
 	// Note that orientation/rotation of root component always remains fixed, but the craft's static mesh + camera do the rotation.
 	AddActorLocalOffset(LocalMove, true);
+	InputLatency.OnApplied(ESpaceRocksControl::RearThrust, ESpaceRocksControl::BottomThrust);
 
 	// Calculate change in rotation this frame (For player's mesh and camera)
 	FRotator DeltaRotation(0, 0, 0);
@@ -173,46 +227,55 @@ void ASpaceRocksPawn::Tick(float DeltaSeconds)
 
 	// Rotate Craft
 	PlaneMesh->AddLocalRotation(DeltaRotation);
+	InputLatency.OnApplied(ESpaceRocksControl::Pitch, ESpaceRocksControl::Roll);
+}
+
+void ASpaceRocksPawn::Tick(float DeltaSeconds)
+{
+	// Registered craft are flown by the game state's craft stage, along with all the others
+	if (!bFlownByGameState)
+	{
+		StepFlight(DeltaSeconds);
+	}
 
 	// Call any parent class Tick implementation
 	Super::Tick(DeltaSeconds);
 
+	if (!bFlownByGameState)
+	{
+		UpdateLockOn();
+	}
+
 	// Are the fire button(s) pressed? If so, do something about it
-	/*
 	if (primary_on)
 	{
 		// Primary Fire
 
-		// Just some test(ish) code to start with
+		const float TimeSeconds = GetWorld()->GetTimeSeconds();
 
-		// Fire, if firerate not breached
-		if (lastfired <= (this->GetWorld()->GetTimeSeconds() - WeapInfo.getFireRate(PlayerInv.weaponInventory[weapon])))
+		// Fire, if firerate not breached and we have ammo
+		if (PlayerInv.CanFire(weapon, TimeSeconds))
 		{
-			// ** TODO ** Can we make this all more efficient?
+			const FSpaceRocksWeaponDef& WeapDef = WeapInfo.Get(PlayerInv.weaponInventory[weapon]);
 
 			// This big gets the Location an orientation of the player
-			//FireLocation = ShieldMesh->RelativeLocation;
 			FireLocation = RootComponent->RelativeLocation;
 			FireRotation = PlaneMesh->RelativeRotation;
 
 			// This gets the default direction the fire should head from the PlaneMesh forward vector.
-			FireDirection = PlaneMesh->GetForwardVector();
+			const FVector Forward = PlaneMesh->GetForwardVector();
+			const FVector Right = PlaneMesh->GetRightVector();
+			FireDirection = Forward;
 
 			//Now we calculate various offsets to the player position, so we are not firing from the middle of the mesh
 
-
-
 			// - Mid Left
-			//FireLocation_Mid_Left = FireLocation;
-			FireLocation_Mid_Left = FireLocation - PlaneMesh->GetRightVector() * 105.f;
-			FireLocation_Mid_Left = FireLocation_Mid_Left + PlaneMesh->GetForwardVector() * 50.f;
+			FireLocation_Mid_Left = FireLocation - Right * 105.f + Forward * 50.f;
 			FireDirection_Mid_Left = FireDirection;
 			FireRotation_Mid_Left = FireRotation;
 
 			// - Mid Right
-			//FireLocation_Mid_Right = FireLocation;
-			FireLocation_Mid_Right = FireLocation + PlaneMesh->GetRightVector() * 105.f;
-			FireLocation_Mid_Right = FireLocation_Mid_Right + PlaneMesh->GetForwardVector() * 50.f;
+			FireLocation_Mid_Right = FireLocation + Right * 105.f + Forward * 50.f;
 			FireDirection_Mid_Right = FireDirection;
 			FireRotation_Mid_Right = FireRotation;
 
@@ -233,70 +296,78 @@ void ASpaceRocksPawn::Tick(float DeltaSeconds)
 				LineTraceEnd = LineTraceStart + TP_Camera->GetForwardVector() * 10000.f;
 			}
 
-
 			GetWorld()->LineTraceSingle(
 				CrossHair_Hit,			 //result
 				LineTraceStart,					//start
 				LineTraceEnd,					//end
-				ECC_Pawn,				//collision channel
+				COLLISION_AIM,			//collision channel
 				CrossHair_TraceParams
 				);
 
 			if (CrossHair_Hit.bBlockingHit)
 			{
+				FireDirection = CrossHair_Hit.ImpactPoint - FireLocation;
+				FireRotation = FireDirection.Rotation();
 				FireDirection_Mid_Left = CrossHair_Hit.ImpactPoint - FireLocation_Mid_Left;
-
 				FireRotation_Mid_Left = FireDirection_Mid_Left.Rotation();
 				FireDirection_Mid_Right = CrossHair_Hit.ImpactPoint - FireLocation_Mid_Right;
-
 				FireRotation_Mid_Right = FireDirection_Mid_Right.Rotation();
 				CrossHair_Hit.bBlockingHit = false;	// why I have to reset this, I don't know? UE bug?
 			}
 
-
 			// Finally, fire the appropriate weapon
-			if (PlayerInv.ammo[weapon] != 0)
+			if (WeapDef.HitscanRays > 0)
 			{
+				PlayerInv.ConsumeShot(weapon, TimeSeconds, WeapDef.FireRate);
+				SPACEROCKS_TRACE_EVENT(Fire, (int32)GetUniqueID(), (float)PlayerInv.weaponInventory[weapon], (float)weapon);
 
-				AActor * spawned;
+				FireHitscan(WeapDef, DeltaSeconds);
 
-				if (PlayerInv.ammo[weapon] > 0) PlayerInv.ammo[weapon] --;
+				lastfired = TimeSeconds;
+			}
+			else if (WeapDef.ProjectileClass)
+			{
+				PlayerInv.ConsumeShot(weapon, TimeSeconds, WeapDef.FireRate);
+				SPACEROCKS_TRACE_EVENT(Fire, (int32)GetUniqueID(), (float)PlayerInv.weaponInventory[weapon], (float)weapon);
 
-				switch (PlayerInv.weaponInventory[weapon])
+				AActor * spawned;
+				FVector SpawnDirection;
+
+				if (WeapDef.FireMount == ESpaceRocksFireMount::MidWings)
 				{
-				case PHASEOID:
-					spawned = GetWorld()->SpawnActor(AReconOneWP_phaseoid::StaticClass(), &FireLocation, &FireRotation);
-					break;
-				case PULSER:
 					if (weap_cycle == 1 || weap_cycle == 3)
 					{
-						spawned = GetWorld()->SpawnActor(AReconOneWP_pulser::StaticClass(), &FireLocation_Mid_Left, &FireRotation_Mid_Left);
+						spawned = GetWorld()->SpawnActor(WeapDef.ProjectileClass, &FireLocation_Mid_Left, &FireRotation_Mid_Left);
+						SpawnDirection = FireDirection_Mid_Left;
 					}
 					else
 					{
-						spawned = GetWorld()->SpawnActor(AReconOneWP_pulser::StaticClass(), &FireLocation_Mid_Right, &FireRotation_Mid_Right);
+						spawned = GetWorld()->SpawnActor(WeapDef.ProjectileClass, &FireLocation_Mid_Right, &FireRotation_Mid_Right);
+						SpawnDirection = FireDirection_Mid_Right;
 					}
-					break;
-				default:
-					spawned = GetWorld()->SpawnActor(AReconOneWP_phaseoid::StaticClass(), &FireLocation, &FireRotation);
-					break;
+				}
+				else
+				{
+					spawned = GetWorld()->SpawnActor(WeapDef.ProjectileClass, &FireLocation, &FireRotation);
+					SpawnDirection = FireDirection;
 				}
 
 				// Tag the projectile with the name of the Actor that spawned it.
-				AReconOneWeaponProjectile* const TestProj = Cast<AReconOneWeaponProjectile>(spawned);
+				ASpaceRocksProjectile* const TestProj = Cast<ASpaceRocksProjectile>(spawned);
 				if (TestProj)
 				{
-					TestProj->SpawnedBy = GetUniqueID();
+					TestProj->InitProjectile((int32)GetUniqueID(), WeapDef.Damage, SpawnDirection, WeapDef.ProjectileSpeed);
+
+					// Homing weapons spread their shots over the locked targets
+					if (WeapDef.HomingAcceleration > 0.f && LockedTargets.Num() > 0)
+					{
+						TestProj->SetHomingTarget(LockedTargets[weap_cycle % LockedTargets.Num()], WeapDef.HomingAcceleration);
+					}
 				}
 
-				lastfired = this->GetWorld()->GetTimeSeconds();
+				lastfired = TimeSeconds;
 			}
 
-			//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, GetFName().ToString());
-			//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, FString::Printf(TEXT("UniqueID = %d"), GetUniqueID()));
-
-
-
 			// Increment weapon fire position cycle
 			weap_cycle++;
 			if (weap_cycle > 4)
@@ -305,31 +376,61 @@ void ASpaceRocksPawn::Tick(float DeltaSeconds)
 			}
 		}
 	}
-	*/
+}
+
+void ASpaceRocksPawn::FireHitscan(const FSpaceRocksWeaponDef& WeapDef, float DeltaSeconds)
+{
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState == NULL)
+	{
+		return;
+	}
+
+	// A continuous beam fires every frame, so its damage is per second
+	const float Damage = (WeapDef.FireRate > 0.f) ? WeapDef.Damage : WeapDef.Damage * DeltaSeconds;
+	const float Spread = FMath::DegreesToRadians(WeapDef.HitscanSpread);
+
+	for (int32 Ray = 0; Ray < WeapDef.HitscanRays; Ray++)
+	{
+		FVector Origin = FireLocation;
+		FVector Aim = FireDirection;
+
+		// Mid wing weapons split their rays between the two hardpoints
+		if (WeapDef.FireMount == ESpaceRocksFireMount::MidWings)
+		{
+			const bool bLeft = (Ray % 2) == 0;
+			Origin = bLeft ? FireLocation_Mid_Left : FireLocation_Mid_Right;
+			Aim = bLeft ? FireDirection_Mid_Left : FireDirection_Mid_Right;
+		}
+
+		Aim = Aim.SafeNormal();
+		const FVector Direction = (Spread > 0.f) ? FMath::VRandCone(Aim, Spread) : Aim;
+		GameState->QueueRay(FSpaceRocksTargetRay(Origin, Direction, WeapDef.HitscanRange, this), Damage);
+	}
 }
 
 void ASpaceRocksPawn::ReceiveHit(class UPrimitiveComponent* MyComp, class AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
 {
 	Super::ReceiveHit(MyComp, Other, OtherComp, bSelfMoved, HitLocation, HitNormal, NormalImpulse, Hit);
 
+	SPACEROCKS_TRACE_EVENT(Hit, Other ? (int32)Other->GetUniqueID() : 0, HitLocation.X, HitLocation.Y, HitLocation.Z, NormalImpulse.Size());
+
+	// Sparks off the shield
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState && GameState->Debris)
+	{
+		GameState->Debris->AddShieldHit(HitLocation, HitNormal, FVector(CurrentXAxisSpeed, CurrentYAxisSpeed, CurrentZAxisSpeed));
+	}
+
 	// Force Actor rotation to be 0 - Only the Plane Mesh should rotate/
 
 	FRotator SALRotation(0, 0, 0);
 	SetActorRotation(SALRotation);
 
 
-	// If we hit a projectile remove some shield
-
-	/*
-	AReconOneWeaponProjectile* const TestProj = Cast<AReconOneWeaponProjectile>(Other);
-	if (TestProj)
+	// Projectile hits come off the shield in the game state's damage stage (the projectile queues them)
+	if (Cast<ASpaceRocksProjectile>(Other) == NULL)
 	{
-
-		ShieldLevel = ShieldLevel - TestProj->damage_delt;
-
-	}
-	else
-	{*/
 		// If it's not a projectile, bounce off (loosing some momentum in the process)
 		// -- This bounce is a bit rubbish as I can't really work out the maths, but it sort of works well enough
 
@@ -353,9 +454,7 @@ void ASpaceRocksPawn::ReceiveHit(class UPrimitiveComponent* MyComp, class AActor
 		CurrentXAxisSpeed = (CurrentXAxisSpeed * -ImpactAngle.X) / 1;
 		CurrentYAxisSpeed = (CurrentYAxisSpeed * -ImpactAngle.Y) / 1;
 		CurrentZAxisSpeed = (CurrentZAxisSpeed * -ImpactAngle.Z) / 1;
-
-
-	//}
+	}
 }
 
 void ASpaceRocksPawn::ReceiveActorBeginOverlap(class AActor * Other)
@@ -383,7 +482,7 @@ void ASpaceRocksPawn::ReceiveActorBeginOverlap(class AActor * Other)
 			}
 			else
 			{
-				weap_slot = PlayerInv.AddToWeapInv(TestPickup->PickupType);
+				weap_slot = PlayerInv.AddToWeapInv(TestPickup->PickupType, WeapInfo);
 				if (weap_slot >= 0)
 				{
 					TestPickup->OnPickedUp_Implementation();
@@ -406,7 +505,7 @@ void ASpaceRocksPawn::ReceiveActorBeginOverlap(class AActor * Other)
 			else
 			{
 				// Try adding as ammo pack
-				if (PlayerInv.AddToAmmo(TestPickup->PickupType))
+				if (PlayerInv.AddToAmmo(TestPickup->PickupType, WeapInfo))
 				{
 					TestPickup->OnPickedUp_Implementation();
 				}
@@ -425,6 +524,18 @@ void ASpaceRocksPawn::SetupPlayerInputComponent(class UInputComponent* InputComp
 
 	check(InputComponent);
 
+	// Input latency is timed from this player's events arriving at the viewport
+	APlayerController* const PlayerController = Cast<APlayerController>(Controller);
+	const ULocalPlayer* const LocalPlayer = PlayerController ? Cast<ULocalPlayer>(PlayerController->Player) : NULL;
+	InputLatency.ControllerId = LocalPlayer ? LocalPlayer->ControllerId : INDEX_NONE;
+
+	// The game state flies the craft, so it has to tick after the controller that processes this input
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState && PlayerController)
+	{
+		GameState->RegisterCraftController(PlayerController);
+	}
+
 	// ** Bind inputs to control functions **
 	// Firstly, the orientation/axis thrusters
 
@@ -448,7 +559,6 @@ void ASpaceRocksPawn::SetupPlayerInputComponent(class UInputComponent* InputComp
 	InputComponent->BindAction("PrimaryFire", IE_Pressed, this, &ASpaceRocksPawn::firePrimary_pressed);
 	InputComponent->BindAction("PrimaryFire", IE_Released, this, &ASpaceRocksPawn::firePrimary_released);
 
-	/*
 	InputComponent->BindAction("Weap1", IE_Pressed, this, &ASpaceRocksPawn::weap_slot_1);
 	InputComponent->BindAction("Weap2", IE_Pressed, this, &ASpaceRocksPawn::weap_slot_2);
 	InputComponent->BindAction("Weap3", IE_Pressed, this, &ASpaceRocksPawn::weap_slot_3);
@@ -459,224 +569,122 @@ void ASpaceRocksPawn::SetupPlayerInputComponent(class UInputComponent* InputComp
 	InputComponent->BindAction("Weap8", IE_Pressed, this, &ASpaceRocksPawn::weap_slot_8);
 	InputComponent->BindAction("Weap9", IE_Pressed, this, &ASpaceRocksPawn::weap_slot_9);
 	InputComponent->BindAction("Weap0", IE_Pressed, this, &ASpaceRocksPawn::weap_slot_0);
-	*/
 }
 
 // Weapon Select
-/*
-void ASpaceRocksPawn::weap_slot_1()
-{
-	if (PlayerInv.weaponInventory[0] != EMPTY) weapon = 0;
-}
-void ASpaceRocksPawn::weap_slot_2()
-{
-	if (PlayerInv.weaponInventory[1] != EMPTY) weapon = 1;
-}
-void ASpaceRocksPawn::weap_slot_3()
+void ASpaceRocksPawn::SelectWeapon(int32 slot)
 {
-	if (PlayerInv.weaponInventory[2] != EMPTY) weapon = 2;
-}
-void ASpaceRocksPawn::weap_slot_4()
-{
-	if (PlayerInv.weaponInventory[3] != EMPTY) weapon = 3;
-}
-void ASpaceRocksPawn::weap_slot_5()
-{
-	if (PlayerInv.weaponInventory[4] != EMPTY) weapon = 4;
-}
-void ASpaceRocksPawn::weap_slot_6()
-{
-	if (PlayerInv.weaponInventory[5] != EMPTY) weapon = 5;
-}
-void ASpaceRocksPawn::weap_slot_7()
-{
-	if (PlayerInv.weaponInventory[6] != EMPTY) weapon = 6;
-}
-void ASpaceRocksPawn::weap_slot_8()
-{
-	if (PlayerInv.weaponInventory[7] != EMPTY) weapon = 7;
-}
-void ASpaceRocksPawn::weap_slot_9()
-{
-	if (PlayerInv.weaponInventory[8] != EMPTY) weapon = 8;
-}
-void ASpaceRocksPawn::weap_slot_0()
-{
-	if (PlayerInv.weaponInventory[9] != EMPTY) weapon = 9;
+	if (PlayerInv.weaponInventory[slot] != ESpaceRocksWeapon::EMPTY)
+	{
+		weapon = slot;
+		SPACEROCKS_TRACE_EVENT(WeaponSelect, (int32)GetUniqueID(), (float)slot);
+	}
 }
-*/
+void ASpaceRocksPawn::weap_slot_1() { SelectWeapon(0); }
+void ASpaceRocksPawn::weap_slot_2() { SelectWeapon(1); }
+void ASpaceRocksPawn::weap_slot_3() { SelectWeapon(2); }
+void ASpaceRocksPawn::weap_slot_4() { SelectWeapon(3); }
+void ASpaceRocksPawn::weap_slot_5() { SelectWeapon(4); }
+void ASpaceRocksPawn::weap_slot_6() { SelectWeapon(5); }
+void ASpaceRocksPawn::weap_slot_7() { SelectWeapon(6); }
+void ASpaceRocksPawn::weap_slot_8() { SelectWeapon(7); }
+void ASpaceRocksPawn::weap_slot_9() { SelectWeapon(8); }
+void ASpaceRocksPawn::weap_slot_0() { SelectWeapon(9); }
 
 void ASpaceRocksPawn::PitchCraft(float val)
 {
-	// ** Player is firing Pitch Thrusters **
-	// Target pitch speed is based in input
-
-	// Is there no input?
-	bool bHasInput = !FMath::IsNearlyEqual(val, 0.f);
+	InputLatency.OnInput(ESpaceRocksControl::Pitch, val);
 
-	// If not turning, roll to reverse current roll value
-	float TargetPitchSpeed = bHasInput ? (val * TurnSpeed * -1.f) : (PlaneMesh->RelativeRotation.Pitch * -ReturnSpeed);
-
-	// Smoothly inerpolate to target pitch speed
-	CurrentPitchSpeed = FMath::Clamp(FMath::FInterpTo(CurrentPitchSpeed, TargetPitchSpeed, GetWorld()->GetDeltaSeconds(), AxisSmoothing), MinSpeed, MaxSpeed);
+	// ** Player is firing Pitch Thrusters **
+	// Target pitch speed is based in input. Smoothly interpolate to it.
+	const FSpaceRocksFlightParams Params = GetFlightParams();
+	CurrentPitchSpeed = FSpaceRocksFlight::SmoothTurnRate(Params, CurrentPitchSpeed, FSpaceRocksFlight::TargetPitchRate(Params, val, PlaneMesh->RelativeRotation.Pitch), GetWorld()->GetDeltaSeconds());
 }
 void ASpaceRocksPawn::YawCraft(float val)
 {
-	// ** Player is firing Yaw Thrusters **
-	// Target yaw speed is based in input	
-
-	// Is there no input?
-	bool bHasInput = !FMath::IsNearlyEqual(val, 0.f);
-
-	// If not turning, don't do anything - We don't rest yaw like we do pitch and roll
-	float TargetYawSpeed = bHasInput ? (val * TurnSpeed) : 0;
+	InputLatency.OnInput(ESpaceRocksControl::Yaw, val);
 
-	// Smoothly interpolate yaw speed
-	CurrentYawSpeed = FMath::Clamp(FMath::FInterpTo(CurrentYawSpeed, TargetYawSpeed, GetWorld()->GetDeltaSeconds(), AxisSmoothing), MinSpeed, MaxSpeed);
+	// ** Player is firing Yaw Thrusters **
+	// Target yaw speed is based in input. Smoothly interpolate to it.
+	const FSpaceRocksFlightParams Params = GetFlightParams();
+	CurrentYawSpeed = FSpaceRocksFlight::SmoothTurnRate(Params, CurrentYawSpeed, FSpaceRocksFlight::TargetYawRate(Params, val), GetWorld()->GetDeltaSeconds());
 }
 void ASpaceRocksPawn::RollCraft(float val)
 {
-	// ** Player is firing Roll Thrusters **
-	// Target yaw speed is based in input	
+	InputLatency.OnInput(ESpaceRocksControl::Roll, val);
 
-	// Is there no input?
-	bool bHasInput = !FMath::IsNearlyEqual(val, 0.f);
-
-	// If not turning, roll to reverse current roll value
-	float TargetRollSpeed = bHasInput ? (val * TurnSpeed) : (PlaneMesh->RelativeRotation.Roll * -ReturnSpeed);
-
-	// Smoothly interpolate roll speed
-	CurrentRollSpeed = FMath::Clamp(FMath::FInterpTo(CurrentRollSpeed, TargetRollSpeed, GetWorld()->GetDeltaSeconds(), AxisSmoothing), MinSpeed, MaxSpeed);
+	// ** Player is firing Roll Thrusters **
+	// Target roll speed is based in input. Smoothly interpolate to it.
+	const FSpaceRocksFlightParams Params = GetFlightParams();
+	CurrentRollSpeed = FSpaceRocksFlight::SmoothTurnRate(Params, CurrentRollSpeed, FSpaceRocksFlight::TargetRollRate(Params, val, PlaneMesh->RelativeRotation.Roll), GetWorld()->GetDeltaSeconds());
 }
 
 void ASpaceRocksPawn::RearThrust(float val)
 {
+	InputLatency.OnInput(ESpaceRocksControl::RearThrust, val);
 
 	// ** Player is Firing the Rear/Front Thrusters **
 	// ** The orientation/rotation of the Root component is always fixed. **
 	// ** So, speed up/slow down on each axis is based on the direction vector of where the player's craft mesh is pointing **
-
-	float x_factor = 0.f;
-	float y_factor = 0.f;
-	float z_factor = 0.f;
-
-	FVector Up = PlaneMesh->GetForwardVector();
-
-	// ** Let's First calculate forward speed (aka X axis speed) **
-
-	x_factor = Up.X;
-	CurrentXAxisSpeed = CalcThrust(val, x_factor, CurrentXAxisSpeed);
-
-	// ** Now for Y axis
-
-	y_factor = Up.Y;
-	CurrentYAxisSpeed = CalcThrust(val, y_factor, CurrentYAxisSpeed);
-
-	// ** Now for Z axis speed **
-
-	z_factor = Up.Z;
-	CurrentZAxisSpeed = CalcThrust(val, z_factor, CurrentZAxisSpeed);
-
-
+	ApplyThrust(val, PlaneMesh->GetForwardVector());
 }
 
 void ASpaceRocksPawn::SideThrust(float val)
 {
-	// ** Player is Firing the Side Thrusters **
-	// ** The orientation/rotation of the Root component is always fixed. **
-	// ** So, speed up/slow down on each axis is based on the direction vector of where the player's craft mesh is pointing **
-
-	float x_factor = 0.f;
-	float y_factor = 0.f;
-	float z_factor = 0.f;
-
-	FVector Up = PlaneMesh->GetRightVector();
-
-	// ** Let's First calculate forward speed (aka X axis speed) **
-
-	x_factor = Up.X;
-	CurrentXAxisSpeed = CalcThrust(val, x_factor, CurrentXAxisSpeed);
-
-	// ** Now for Y axis
+	InputLatency.OnInput(ESpaceRocksControl::SideThrust, val);
 
-	y_factor = Up.Y;
-	CurrentYAxisSpeed = CalcThrust(val, y_factor, CurrentYAxisSpeed);
-
-	// ** Now for Z axis speed **
-
-	z_factor = Up.Z;
-	CurrentZAxisSpeed = CalcThrust(val, z_factor, CurrentZAxisSpeed);
+	// ** Player is Firing the Side Thrusters **
+	ApplyThrust(val, PlaneMesh->GetRightVector());
 }
 void ASpaceRocksPawn::BottomThrust(float val)
 {
+	InputLatency.OnInput(ESpaceRocksControl::BottomThrust, val);
 
 	// ** Player is Firing the Bottom/Top Thrusters **
-	// ** The orientation/rotation of the Root component is always fixed. **
-	// ** So, speed up/slow down on each axis is based on the direction vector of where the player's craft mesh is pointing **
-
-	float x_factor = 0.f;
-	float y_factor = 0.f;
-	float z_factor = 0.f;
-
-	FVector Up = PlaneMesh->GetUpVector();
-
-	//float x = Up.X;
-	//float y = Up.Y;
-	//float z = Up.Z;
-	//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::White, FString::Printf(TEXT("Pitch = %f, Roll = %f, Yaw = %f"), craftorientation.getPitchDegs(), craftorientation.getRollDegs(), craftorientation.getYawDegs()));
-	//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, FString::Printf(TEXT("Pitch = %f, Roll = %f, Yaw = %f"), craftorientation.getPitchFactor(0), craftorientation.getRollFactor(0), craftorientation.getYawFactor(0)));
-
-
-	// ** Let's First calculate forward speed (aka X axis speed) **
-
-	x_factor = Up.X;
-	//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, FString::Printf(TEXT("vX = %f, vY = %f, vZ = %f"), x,y,z));
-	//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, FString::Printf(TEXT("X factor = %f"), x_factor));
-	CurrentXAxisSpeed = CalcThrust(val, x_factor, CurrentXAxisSpeed);
-
-	// ** Now for Y axis
-
-	y_factor = Up.Y;
-	//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, FString::Printf(TEXT("Y factor = %f"), y_factor));
-	CurrentYAxisSpeed = CalcThrust(val, y_factor, CurrentYAxisSpeed);
-
-	// ** Now for Z axis speed **
+	ApplyThrust(val, PlaneMesh->GetUpVector());
+}
 
-	z_factor = Up.Z;
-	//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, FString::Printf(TEXT("Z factor = %f"), z_factor));
-	CurrentZAxisSpeed = CalcThrust(val, z_factor, CurrentZAxisSpeed);
+void ASpaceRocksPawn::ApplyThrust(float val, const FVector& ThrustAxis)
+{
+	const FVector Velocity = FSpaceRocksFlight::ApplyThrust(GetFlightParams(), val, ThrustAxis,
+		FVector(CurrentXAxisSpeed, CurrentYAxisSpeed, CurrentZAxisSpeed), GetWorld()->GetDeltaSeconds());
 
+	CurrentXAxisSpeed = Velocity.X;
+	CurrentYAxisSpeed = Velocity.Y;
+	CurrentZAxisSpeed = Velocity.Z;
 }
 
-
-float ASpaceRocksPawn::CalcThrust(float InputVal, float factor, float CurrentAxisSpeed)
+FSpaceRocksFlightParams ASpaceRocksPawn::GetFlightParams() const
 {
+	FSpaceRocksFlightParams Params;
+	Params.Acceleration = Acceleration;
+	Params.Deceleration = Deceleration;
+	Params.TurnSpeed = TurnSpeed;
+	Params.ReturnSpeed = ReturnSpeed;
+	Params.MinSpeed = MinSpeed;
+	Params.MaxSpeed = MaxSpeed;
+	Params.AxisSmoothing = AxisSmoothing;
+	return Params;
+}
 
-	float CurrentAcc = 0.f;
-	float NewSpeed = 0.f;
-
-	// Is there no input?
-	bool bHasInput = !FMath::IsNearlyEqual(InputVal, 0.f);
+void ASpaceRocksPawn::UpdateLockOn()
+{
+	LockedTargets.Reset();
 
-	if (bHasInput)
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState == NULL || MaxLockTargets <= 0)
 	{
-		CurrentAcc = (InputVal * Acceleration) * factor;
+		return;
 	}
-	else
-	{
 
-		if (FMath::IsNegativeFloat(CurrentAxisSpeed))
-		{
-			CurrentAcc = 0.5f * Deceleration;
-		}
-		else
-		{
-			CurrentAcc = -0.5f * Deceleration;
-		}
-	}
-	NewSpeed = CurrentAxisSpeed + (GetWorld()->GetDeltaSeconds() * CurrentAcc);
-	return FMath::Clamp(NewSpeed, MinSpeed, MaxSpeed);
+	const FSpaceRocksTargetCone Cone(PlaneMesh->GetComponentLocation(), PlaneMesh->GetForwardVector(), LockOnHalfAngle, LockOnRange, this);
 
+	FSpaceRocksTargetHit Hits[MAX_LOCK_TARGETS];
+	const int32 NumHits = GameState->FindTargets(Cone, Hits, FMath::Min(MaxLockTargets, MAX_LOCK_TARGETS));
+	for (int32 Index = 0; Index < NumHits; Index++)
+	{
+		LockedTargets.Add(Hits[Index].Actor);
+	}
 }
 
 void ASpaceRocksPawn::ToggleView()
@@ -689,14 +697,14 @@ void ASpaceRocksPawn::ToggleView()
 		bIsThirdPerson = false;
 		FP_Camera->Activate();
 		TP_Camera->Deactivate();
-		PlaneMesh->SetVisibility(false, false);
+		PlaneMesh->SetOwnerNoSee(true);		// Only hidden from our own view, so split-screen players still see us
 	}
 	else
 	{
 		bIsThirdPerson = true;
 		FP_Camera->Deactivate();
 		TP_Camera->Activate();
-		PlaneMesh->SetVisibility(true, false);
+		PlaneMesh->SetOwnerNoSee(false);
 	}
 
 
@@ -735,7 +743,6 @@ bool ASpaceRocksPawn::LookForInv(int32 PUtype)
 {
 	// Does the passed pickup type exist in the inventory?
 
-	//return PlayerInv.LookForInv(PUtype);
-	return 0;
+	return PlayerInv.LookForInv(PUtype);
 }
 
@@ -0,0 +1,104 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksProjectile.h"
+#include "SpaceRocksGameState.h"
+#include "SpaceRocksCollision.h"
+
+ASpaceRocksProjectile::ASpaceRocksProjectile(const class FPostConstructInitializeProperties& PCIP)
+	: Super(PCIP)
+{
+	struct FConstructorStatics
+	{
+		ConstructorHelpers::FObjectFinderOptional<UStaticMesh> ProjectileMesh;
+		FConstructorStatics()
+			: ProjectileMesh(TEXT("StaticMesh'/Game/SpaceRocks/StaticMeshes/SM_Simple_Sphere.SM_Simple_Sphere'"))
+		{
+		}
+	};
+	static FConstructorStatics ConstructorStatics;
+
+	// Collision sphere is the root, so we sweep against things as we move
+	CollisionComp = PCIP.CreateDefaultSubobject<USphereComponent>(this, TEXT("SphereComp0"));
+	CollisionComp->InitSphereRadius(10.f);
+	CollisionComp->SetCollisionProfileName(FSpaceRocksCollision::ProjectileProfile);
+	RootComponent = CollisionComp;
+
+	ProjectileMesh = PCIP.CreateDefaultSubobject<UStaticMeshComponent>(this, TEXT("ProjectileMesh0"));
+	ProjectileMesh->SetStaticMesh(ConstructorStatics.ProjectileMesh.Get());
+	ProjectileMesh->AttachTo(RootComponent);
+	ProjectileMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	ProjectileMesh->SetRelativeScale3D(FVector(0.1f, 0.1f, 0.1f));
+
+	ProjectileMovement = PCIP.CreateDefaultSubobject<UProjectileMovementComponent>(this, TEXT("ProjectileMovement0"));
+	ProjectileMovement->UpdatedComponent = CollisionComp;
+	ProjectileMovement->InitialSpeed = 8000.f;
+	ProjectileMovement->MaxSpeed = 0.f;	// No limit
+	ProjectileMovement->ProjectileGravityScale = 0.f;
+	ProjectileMovement->bRotationFollowsVelocity = true;
+	ProjectileMovement->bShouldBounce = false;
+
+	// Don't fly forever
+	InitialLifeSpan = 3.f;
+
+	SpawnedBy = 0;
+	damage_delt = 10.f;
+}
+
+void ASpaceRocksProjectile::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState)
+	{
+		GameState->RegisterProjectile(this);
+	}
+}
+
+void ASpaceRocksProjectile::Destroyed()
+{
+	ASpaceRocksGameState* const GameState = GetWorld() ? Cast<ASpaceRocksGameState>(GetWorld()->GameState) : NULL;
+	if (GameState)
+	{
+		GameState->UnregisterProjectile(this);
+	}
+
+	Super::Destroyed();
+}
+
+void ASpaceRocksProjectile::ReceiveHit(class UPrimitiveComponent* MyComp, class AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
+{
+	Super::ReceiveHit(MyComp, Other, OtherComp, bSelfMoved, HitLocation, HitNormal, NormalImpulse, Hit);
+
+	if (IsPendingKill())
+	{
+		return;
+	}
+
+	// Damage is only queued here - the game state applies the frame's hits all at once
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState && Other && (int32)Other->GetUniqueID() != SpawnedBy)
+	{
+		GameState->QueueDamage(Other, damage_delt, HitLocation, SpawnedBy);
+	}
+
+	Destroy();
+}
+
+void ASpaceRocksProjectile::InitProjectile(int32 InSpawnedBy, float Damage, const FVector& Direction, float Speed)
+{
+	SpawnedBy = InSpawnedBy;
+	damage_delt = Damage;
+	ProjectileMovement->Velocity = Direction.SafeNormal() * Speed;
+}
+
+void ASpaceRocksProjectile::SetHomingTarget(AActor* Target, float Acceleration)
+{
+	if (Target && Target->GetRootComponent())
+	{
+		ProjectileMovement->bIsHomingProjectile = true;
+		ProjectileMovement->HomingTargetComponent = Target->GetRootComponent();
+		ProjectileMovement->HomingAccelerationMagnitude = Acceleration;
+	}
+}
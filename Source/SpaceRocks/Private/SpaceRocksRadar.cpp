@@ -0,0 +1,225 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksRadar.h"
+#include "SpaceRocksGameState.h"
+#include "SpaceRocksPawn.h"
+
+DEFINE_STAT(STAT_SpaceRocksRadarGather);
+DEFINE_STAT(STAT_SpaceRocksRadarBuild);
+
+static bool SortThreatsByTime(const FSpaceRocksRadarThreat& A, const FSpaceRocksRadarThreat& B)
+{
+	return A.TimeToImpact < B.TimeToImpact;
+}
+
+void FSpaceRocksRadar::Build(const FSpaceRocksRadarParams& Params, const TArray<FSpaceRocksRadarContact>& Contacts, FSpaceRocksRadarResult& OutResult)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpaceRocksRadarBuild);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	OutResult.Blips.Reset();
+	OutResult.Threats.Reset();
+	OutResult.NumContacts = 0;
+	OutResult.Range = Params.Range;
+
+	const int32 GridCells = FMath::Clamp(Params.GridCells, 1, MAX_RADAR_GRID_CELLS);
+	const float CellSize = (Params.Range * 2.f) / GridCells;
+	const float RangeSquared = Params.Range * Params.Range;
+
+	// Blip index for each occupied cell and type. Only cells with something in them are stored, so the cost
+	// follows the number of contacts, not the size of the grid.
+	TMap<int32, int32> CellBlips;
+
+	for (int32 Index = 0; Index < Contacts.Num(); Index++)
+	{
+		const FSpaceRocksRadarContact& Contact = Contacts[Index];
+		if (Contact.OwnerId != 0 && Contact.OwnerId == Params.CraftId)
+		{
+			continue;
+		}
+
+		const FVector Offset = Contact.Location - Params.CraftLocation;
+		if (Offset.SizeSquared() > RangeSquared)
+		{
+			continue;
+		}
+		OutResult.NumContacts++;
+
+		const FVector Local = Params.CraftRotation.Inverse().RotateVector(Offset);
+
+		// ** Add to the cell's blip **
+
+		const int32 X = FMath::Clamp(FMath::FloorToInt((Local.X + Params.Range) / CellSize), 0, GridCells - 1);
+		const int32 Y = FMath::Clamp(FMath::FloorToInt((Local.Y + Params.Range) / CellSize), 0, GridCells - 1);
+		const int32 Z = FMath::Clamp(FMath::FloorToInt((Local.Z + Params.Range) / CellSize), 0, GridCells - 1);
+		const int32 Cell = ((Z * GridCells + Y) * GridCells + X) * ESpaceRocksRadarContact::NUM_TYPES + Contact.Type;
+
+		int32* BlipIndex = CellBlips.Find(Cell);
+		if (BlipIndex == NULL)
+		{
+			BlipIndex = &CellBlips.Add(Cell, OutResult.Blips.Num());
+
+			FSpaceRocksRadarBlip Blip;
+			Blip.Location = FVector(0.f, 0.f, 0.f);
+			Blip.Radius = 0.f;
+			Blip.Count = 0;
+			Blip.Type = Contact.Type;
+			OutResult.Blips.Add(Blip);
+		}
+
+		FSpaceRocksRadarBlip& Blip = OutResult.Blips[*BlipIndex];
+		Blip.Location += Local;		// Summed here, averaged below
+		Blip.Radius = FMath::Max(Blip.Radius, Contact.Radius);
+		Blip.Count++;
+
+		// ** Is it going to hit us? Closest approach of the relative motion **
+
+		const FVector RelativeVelocity = Contact.Velocity - Params.CraftVelocity;
+		const float HitDistance = Contact.Radius + Params.CraftRadius;
+		const float SpeedSquared = RelativeVelocity.SizeSquared();
+
+		float TimeToImpact = -1.f;
+		if (Offset.SizeSquared() < HitDistance * HitDistance)
+		{
+			TimeToImpact = 0.f;
+		}
+		else if (SpeedSquared > KINDA_SMALL_NUMBER)
+		{
+			const float ClosestTime = -FVector::DotProduct(Offset, RelativeVelocity) / SpeedSquared;
+			if (ClosestTime > 0.f && ClosestTime < Params.ThreatTime && (Offset + RelativeVelocity * ClosestTime).SizeSquared() < HitDistance * HitDistance)
+			{
+				TimeToImpact = ClosestTime;
+			}
+		}
+
+		if (TimeToImpact >= 0.f)
+		{
+			FSpaceRocksRadarThreat Threat;
+			Threat.Location = Local;
+			Threat.Distance = Offset.Size();
+			Threat.TimeToImpact = TimeToImpact;
+			Threat.Type = Contact.Type;
+			OutResult.Threats.Add(Threat);
+		}
+	}
+
+	for (int32 Index = 0; Index < OutResult.Blips.Num(); Index++)
+	{
+		OutResult.Blips[Index].Location /= (float)OutResult.Blips[Index].Count;
+	}
+
+	OutResult.Threats.Sort(SortThreatsByTime);
+	if (OutResult.Threats.Num() > Params.MaxThreats)
+	{
+		OutResult.Threats.RemoveAt(Params.MaxThreats, OutResult.Threats.Num() - Params.MaxThreats);
+	}
+
+	OutResult.BuildSeconds = FPlatformTime::Seconds() - StartTime;
+}
+
+void FSpaceRocksRadarTask::DoWork()
+{
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SpaceRocksRadarGather);
+
+		FSpaceRocksSnapshotReader Snapshot(*Snapshots);
+		if (Snapshot.IsValid())
+		{
+			Contacts.Reserve(Snapshot->Rocks.Num() + Snapshot->Projectiles.Num());
+			for (int32 Index = 0; Index < Snapshot->Rocks.Num(); Index++)
+			{
+				const FSpaceRocksRockSnapshot& Rock = Snapshot->Rocks[Index];
+
+				FSpaceRocksRadarContact Contact;
+				Contact.Location = Rock.Location;
+				Contact.Velocity = Rock.Velocity;
+				Contact.Radius = Rock.Radius;
+				Contact.OwnerId = 0;
+				Contact.Type = ESpaceRocksRadarContact::Rock;
+				Contacts.Add(Contact);
+			}
+			for (int32 Index = 0; Index < Snapshot->Projectiles.Num(); Index++)
+			{
+				const FSpaceRocksProjectileSnapshot& Projectile = Snapshot->Projectiles[Index];
+
+				FSpaceRocksRadarContact Contact;
+				Contact.Location = Projectile.Location;
+				Contact.Velocity = Projectile.Velocity;
+				Contact.Radius = Projectile.Radius;
+				Contact.OwnerId = Projectile.OwnerId;
+				Contact.Type = ESpaceRocksRadarContact::Projectile;
+				Contacts.Add(Contact);
+			}
+		}
+	}
+
+	FSpaceRocksRadar::Build(Params, Contacts, *Result);
+}
+
+FSpaceRocksRadarProvider::FSpaceRocksRadarProvider()
+	: UpdateRate(4.f)
+	, Task(NULL)
+	, FrontIndex(0)
+	, NextUpdateTime(0.0)
+{
+}
+
+FSpaceRocksRadarProvider::~FSpaceRocksRadarProvider()
+{
+	if (Task)
+	{
+		Task->EnsureCompletion();
+		delete Task;
+	}
+}
+
+void FSpaceRocksRadarProvider::Update(UWorld* World, const ASpaceRocksPawn* Pawn)
+{
+	// ** Pick up a finished sweep **
+
+	if (Task)
+	{
+		if (!Task->IsDone())
+		{
+			return;
+		}
+
+		FrontIndex = 1 - FrontIndex;
+		delete Task;
+		Task = NULL;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (Now < NextUpdateTime || Pawn == NULL)
+	{
+		return;
+	}
+	NextUpdateTime = Now + 1.0 / FMath::Max(UpdateRate, 0.1f);
+
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(World->GameState);
+	if (GameState == NULL)
+	{
+		return;
+	}
+
+	// ** Hand the worker the craft and the snapshots, and start the next sweep into the back buffer **
+
+	Task = new FAsyncTask<FSpaceRocksRadarTask>();
+	FSpaceRocksRadarTask& Sweep = Task->GetTask();
+
+	Sweep.Params = Params;
+	Sweep.Params.CraftLocation = Pawn->GetActorLocation();
+	Sweep.Params.CraftRotation = Pawn->PlaneMesh->GetComponentTransform().GetRotation();
+	Sweep.Params.CraftVelocity = FVector(Pawn->CurrentXAxisSpeed, Pawn->CurrentYAxisSpeed, Pawn->CurrentZAxisSpeed);
+	Sweep.Params.CraftRadius = Pawn->GetRootComponent()->Bounds.SphereRadius;
+	Sweep.Params.CraftId = (int32)Pawn->GetUniqueID();
+	Sweep.Snapshots = GameState->GetSnapshots();
+
+	FSpaceRocksRadarResult& Back = Results[1 - FrontIndex];
+	Back.Time = Now;
+	Sweep.Result = &Back;
+
+	Task->StartBackgroundTask();
+}
@@ -0,0 +1,215 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksRock.h"
+#include "SpaceRocksGameState.h"
+#include "SpaceRocksDebris.h"
+#include "SpaceRocksTrace.h"
+#include "SpaceRocksCollision.h"
+
+ASpaceRocksRock::ASpaceRocksRock(const class FPostConstructInitializeProperties& PCIP)
+	: Super(PCIP)
+{
+	struct FConstructorStatics
+	{
+		ConstructorHelpers::FObjectFinderOptional<UStaticMesh> RockMesh;
+		FConstructorStatics()
+			: RockMesh(TEXT("StaticMesh'/Game/SpaceRocks/StaticMeshes/SM_Cave_Rock_Med_01a.SM_Cave_Rock_Med_01a'"))
+		{
+		}
+	};
+	static FConstructorStatics ConstructorStatics;
+
+	// Rocks drift freely - no gravity (other than our own) and no damping
+	RockMesh = PCIP.CreateDefaultSubobject<UStaticMeshComponent>(this, TEXT("RockMesh0"));
+	RockMesh->SetStaticMesh(ConstructorStatics.RockMesh.Get());
+	RockMesh->SetMobility(EComponentMobility::Movable);
+	RockMesh->SetSimulatePhysics(true);
+	RockMesh->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	RockMesh->BodyInstance.bEnableGravity = false;
+	RockMesh->BodyInstance.LinearDamping = 0.f;
+	RockMesh->BodyInstance.AngularDamping = 0.f;
+	RockMesh->SetNotifyRigidBodyCollision(true);
+	RockMesh->SetCollisionProfileName(FSpaceRocksCollision::RockProfile);
+	RootComponent = RockMesh;
+
+	Mass = 0.f;
+	Density = 1.f;
+	Health = 0.f;
+	Toughness = 0.25f;
+	Radius = 100.f;
+	bAutoMass = false;
+	bAutoHealth = false;
+	bQueryOnly = false;
+	KinematicVelocity = FVector::ZeroVector;
+	MeshVariant = INDEX_NONE;
+	TargetProxy = INDEX_NONE;
+}
+
+void ASpaceRocksRock::BeginPlay()
+{
+	Super::BeginPlay();
+
+	bAutoMass = (Mass <= 0.f);
+	bAutoHealth = (Health <= 0.f);
+	UpdateRockSize();
+
+	const FVector Location = GetActorLocation();
+	SPACEROCKS_TRACE_EVENT(Spawn, (int32)GetUniqueID(), Location.X, Location.Y, Location.Z, Radius);
+
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState)
+	{
+		GameState->RegisterRock(this);
+	}
+}
+
+void ASpaceRocksRock::Destroyed()
+{
+	SPACEROCKS_TRACE_EVENT(Destroy, (int32)GetUniqueID());
+
+	ASpaceRocksGameState* const GameState = GetWorld() ? Cast<ASpaceRocksGameState>(GetWorld()->GameState) : NULL;
+	if (GameState)
+	{
+		// Break up into debris (only once the rock is in play - not for rocks that never registered)
+		if (GameState->Debris && TargetProxy != INDEX_NONE)
+		{
+			GameState->Debris->AddRockExplosion(GetActorLocation(), GetRockVelocity(), Radius, RockMesh->StaticMesh);
+		}
+
+		GameState->UnregisterRock(this);
+	}
+
+	Super::Destroyed();
+}
+
+void ASpaceRocksRock::UpdateRockSize()
+{
+	Radius = RockMesh->Bounds.SphereRadius;
+
+	// Mass from the volume of the bounding sphere, in cubic metres
+	if (bAutoMass)
+	{
+		const float RadiusMetres = Radius * 0.01f;
+		Mass = Density * 1000.f * (4.f / 3.f) * PI * RadiusMetres * RadiusMetres * RadiusMetres;
+	}
+
+	if (bAutoHealth)
+	{
+		Health = Toughness * Radius;
+	}
+}
+
+FVector ASpaceRocksRock::GetRockVelocity() const
+{
+	return bQueryOnly ? KinematicVelocity : RockMesh->GetPhysicsLinearVelocity();
+}
+
+void ASpaceRocksRock::SetRockVelocity(FVector NewVelocity)
+{
+	if (bQueryOnly)
+	{
+		KinematicVelocity = NewVelocity;
+	}
+	else
+	{
+		RockMesh->SetPhysicsLinearVelocity(NewVelocity);
+	}
+}
+
+void ASpaceRocksRock::AddRockVelocity(const FVector& DeltaVelocity)
+{
+	if (bQueryOnly)
+	{
+		KinematicVelocity += DeltaVelocity;
+	}
+	else
+	{
+		RockMesh->SetPhysicsLinearVelocity(DeltaVelocity, true);
+	}
+}
+
+void ASpaceRocksRock::SetQueryOnly(bool bInQueryOnly)
+{
+	if (bInQueryOnly == bQueryOnly)
+	{
+		return;
+	}
+
+	// Carry the velocity across
+	const FVector Velocity = GetRockVelocity();
+	bQueryOnly = bInQueryOnly;
+	if (bQueryOnly)
+	{
+		RockMesh->SetSimulatePhysics(false);
+		RockMesh->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+		KinematicVelocity = Velocity;
+	}
+	else
+	{
+		RockMesh->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+		RockMesh->SetSimulatePhysics(true);
+		RockMesh->SetPhysicsLinearVelocity(Velocity);
+	}
+}
+
+void ASpaceRocksRock::StepKinematic(float DeltaSeconds, const FBox& ArenaBounds)
+{
+	if (!bQueryOnly || KinematicVelocity.IsZero())
+	{
+		return;
+	}
+
+	const FVector Start = GetActorLocation();
+	FVector End = Start + KinematicVelocity * DeltaSeconds;
+
+	// ** Static arena geometry: sweep the rock's sphere, stop where it touches and bounce off **
+
+	static const FName KinematicSweepTag(TEXT("SpaceRocksKinematicRock"));
+	FCollisionObjectQueryParams StaticObjects;
+	StaticObjects.AddObjectTypesToQuery(ECC_WorldStatic);
+	StaticObjects.AddObjectTypesToQuery(COLLISION_ARENA);
+
+	FHitResult Hit;
+	if (GetWorld()->SweepSingle(Hit, Start, End, FQuat::Identity, FCollisionShape::MakeSphere(Radius), FCollisionQueryParams(KinematicSweepTag, false, this), StaticObjects))
+	{
+		// Already overlapping (e.g. spawned touching a wall) - carry on, but head away from it
+		if (!Hit.bStartPenetrating)
+		{
+			End = Hit.Location;
+		}
+
+		const float Approach = FVector::DotProduct(KinematicVelocity, Hit.ImpactNormal);
+		if (Approach < 0.f)
+		{
+			KinematicVelocity -= 2.f * Approach * Hit.ImpactNormal;
+		}
+	}
+
+	// ** Arena bounds: reflect off the sides, so rocks never drift out of the arena **
+
+	if (ArenaBounds.IsValid)
+	{
+		const FVector Min = ArenaBounds.Min + FVector(Radius, Radius, Radius);
+		const FVector Max = ArenaBounds.Max - FVector(Radius, Radius, Radius);
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			if (Min[Axis] > Max[Axis])
+			{
+				continue;		// Rock bigger than the arena
+			}
+			if (End[Axis] < Min[Axis])
+			{
+				End[Axis] = Min[Axis];
+				KinematicVelocity[Axis] = FMath::Abs(KinematicVelocity[Axis]);
+			}
+			else if (End[Axis] > Max[Axis])
+			{
+				End[Axis] = Max[Axis];
+				KinematicVelocity[Axis] = -FMath::Abs(KinematicVelocity[Axis]);
+			}
+		}
+	}
+
+	SetActorLocation(End, false);
+}
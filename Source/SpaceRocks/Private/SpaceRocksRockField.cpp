@@ -0,0 +1,168 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksRockField.h"
+
+// Upper limit on the placement grid size (cells get bigger for huge arenas instead)
+#define ROCKFIELD_MAX_GRID_CELLS (1 << 21)
+
+FSpaceRocksRockFieldParams::FSpaceRocksRockFieldParams()
+	: Seed(0)
+	, ArenaBounds(FVector(-20000.f, -20000.f, -20000.f), FVector(20000.f, 20000.f, 20000.f))
+	, NumRocks(0)
+	, Speed(1000.f)
+	, MinRadius(100.f)
+	, MaxRadius(600.f)
+	, SizeExponent(2.f)
+	, Spacing(200.f)
+	, ClearCentre(0.f, 0.f, 0.f)
+	, ClearRadius(2000.f)
+	, MaxAttempts(30)
+{
+}
+
+// Sample a radius from a power law distribution (pdf proportional to r^-Exponent) between Min and Max
+static float SampleRadius(FRandomStream& Random, float Min, float Max, float Exponent)
+{
+	const float U = Random.FRand();
+
+	if (Max <= Min)
+	{
+		return Min;
+	}
+
+	if (FMath::IsNearlyEqual(Exponent, 1.f))
+	{
+		return Min * FMath::Pow(Max / Min, U);
+	}
+
+	const float OneMinusK = 1.f - Exponent;
+	const float A = FMath::Pow(Min, OneMinusK);
+	const float B = FMath::Pow(Max, OneMinusK);
+	return FMath::Pow(A + U * (B - A), 1.f / OneMinusK);
+}
+
+int32 FSpaceRocksRockFieldGenerator::Generate(const FSpaceRocksRockFieldParams& Params, TArray<FSpaceRocksRockSpawn>& OutRocks)
+{
+	OutRocks.Reset();
+
+	if (Params.NumRocks <= 0 || !Params.ArenaBounds.IsValid)
+	{
+		return 0;
+	}
+
+	FRandomStream Random(Params.Seed);
+
+	const float MinRadius = FMath::Max(Params.MinRadius, 1.f);
+	const float MaxRadius = FMath::Max(Params.MaxRadius, MinRadius);
+
+	// ** Pick all the sizes up front, then place the largest first (they are the hardest to fit) **
+
+	TArray<float> Radii;
+	Radii.AddUninitialized(Params.NumRocks);
+	for (int32 Index = 0; Index < Params.NumRocks; Index++)
+	{
+		Radii[Index] = SampleRadius(Random, MinRadius, MaxRadius, Params.SizeExponent);
+	}
+	Radii.Sort([](const float A, const float B) { return A > B; });
+
+	// ** Uniform grid over the arena. Cells are at least as big as the largest possible overlap distance,
+	// ** so a candidate only ever needs checking against the 27 cells around it.
+
+	const FVector ArenaMin = Params.ArenaBounds.Min;
+	const FVector ArenaSize = Params.ArenaBounds.GetSize();
+
+	float CellSize = 2.f * MaxRadius + Params.Spacing;
+	CellSize = FMath::Max(CellSize, FMath::Pow((ArenaSize.X * ArenaSize.Y * ArenaSize.Z) / ROCKFIELD_MAX_GRID_CELLS, 1.f / 3.f));
+
+	const int32 DimX = FMath::Max(FMath::CeilToInt(ArenaSize.X / CellSize), 1);
+	const int32 DimY = FMath::Max(FMath::CeilToInt(ArenaSize.Y / CellSize), 1);
+	const int32 DimZ = FMath::Max(FMath::CeilToInt(ArenaSize.Z / CellSize), 1);
+
+	TArray<int32> CellHead;
+	CellHead.Init(INDEX_NONE, DimX * DimY * DimZ);
+	TArray<int32> CellNext;
+	CellNext.Reserve(Params.NumRocks);
+	OutRocks.Reserve(Params.NumRocks);
+
+	for (int32 RockIndex = 0; RockIndex < Params.NumRocks; RockIndex++)
+	{
+		const float Radius = Radii[RockIndex];
+
+		// Keep the whole rock inside the arena
+		const FVector Min = ArenaMin + FVector(Radius, Radius, Radius);
+		const FVector Max = Params.ArenaBounds.Max - FVector(Radius, Radius, Radius);
+		if (Min.X > Max.X || Min.Y > Max.Y || Min.Z > Max.Z)
+		{
+			continue;
+		}
+
+		for (int32 Attempt = 0; Attempt < Params.MaxAttempts; Attempt++)
+		{
+			const FVector Candidate(
+				Random.FRandRange(Min.X, Max.X),
+				Random.FRandRange(Min.Y, Max.Y),
+				Random.FRandRange(Min.Z, Max.Z));
+
+			// Stay out of the clear zone
+			if (FVector::DistSquared(Candidate, Params.ClearCentre) < FMath::Square(Params.ClearRadius + Radius))
+			{
+				continue;
+			}
+
+			const int32 CX = FMath::Clamp(FMath::FloorToInt((Candidate.X - ArenaMin.X) / CellSize), 0, DimX - 1);
+			const int32 CY = FMath::Clamp(FMath::FloorToInt((Candidate.Y - ArenaMin.Y) / CellSize), 0, DimY - 1);
+			const int32 CZ = FMath::Clamp(FMath::FloorToInt((Candidate.Z - ArenaMin.Z) / CellSize), 0, DimZ - 1);
+
+			// Check for overlaps in the surrounding cells
+			bool bOverlaps = false;
+			for (int32 Z = FMath::Max(CZ - 1, 0); Z <= FMath::Min(CZ + 1, DimZ - 1) && !bOverlaps; Z++)
+			{
+				for (int32 Y = FMath::Max(CY - 1, 0); Y <= FMath::Min(CY + 1, DimY - 1) && !bOverlaps; Y++)
+				{
+					for (int32 X = FMath::Max(CX - 1, 0); X <= FMath::Min(CX + 1, DimX - 1) && !bOverlaps; X++)
+					{
+						for (int32 Other = CellHead[(Z * DimY + Y) * DimX + X]; Other != INDEX_NONE; Other = CellNext[Other])
+						{
+							const float MinDist = Radius + OutRocks[Other].Radius + Params.Spacing;
+							if (FVector::DistSquared(Candidate, OutRocks[Other].Location) < MinDist * MinDist)
+							{
+								bOverlaps = true;
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			if (bOverlaps)
+			{
+				continue;
+			}
+
+			// ** Found a spot. Give the rock a random orientation and a random heading **
+
+			FSpaceRocksRockSpawn Rock;
+			Rock.Location = Candidate;
+			Rock.Radius = Radius;
+			Rock.Rotation = FRotator(Random.FRandRange(-90.f, 90.f), Random.FRandRange(-180.f, 180.f), Random.FRandRange(-180.f, 180.f));
+			Rock.Velocity = Random.GetUnitVector() * (Params.Speed * Random.FRandRange(0.5f, 1.f));
+
+			const int32 Cell = (CZ * DimY + CY) * DimX + CX;
+			CellNext.Add(CellHead[Cell]);
+			CellHead[Cell] = OutRocks.Add(Rock);
+			break;
+		}
+	}
+
+	return OutRocks.Num();
+}
+
+void FSpaceRocksRockFieldTask::DoWork()
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	FSpaceRocksRockFieldGenerator::Generate(Params, Rocks);
+
+	GenerateSeconds = FPlatformTime::Seconds() - StartTime;
+}
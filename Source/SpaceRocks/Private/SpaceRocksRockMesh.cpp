@@ -0,0 +1,441 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksRockMesh.h"
+#include "SpaceRocksTasks.h"
+#if WITH_EDITOR
+#include "RawMesh.h"
+#endif
+
+// File magic for cached rock meshes
+#define ROCKMESH_CACHE_MAGIC 0x4D525253	// 'SRRM'
+
+FSpaceRocksRockMeshParams::FSpaceRocksRockMeshParams()
+	: Seed(0)
+	, Subdivisions(4)
+	, NumLODs(3)
+	, NoiseAmplitude(0.35f)
+	, NoiseFrequency(1.5f)
+	, NoiseOctaves(4)
+	, MaxStretch(0.3f)
+{
+}
+
+FArchive& operator<<(FArchive& Ar, FSpaceRocksRockMeshParams& Params)
+{
+	Ar << Params.Seed;
+	Ar << Params.Subdivisions;
+	Ar << Params.NumLODs;
+	Ar << Params.NoiseAmplitude;
+	Ar << Params.NoiseFrequency;
+	Ar << Params.NoiseOctaves;
+	Ar << Params.MaxStretch;
+	return Ar;
+}
+
+FString FSpaceRocksRockMeshParams::GetCacheKey() const
+{
+	// Hash every param (and the generator version), but keep the seed readable
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	int32 Version = ROCKMESH_CACHE_VERSION;
+	Writer << Version;
+	Writer << const_cast<FSpaceRocksRockMeshParams&>(*this);
+
+	return FString::Printf(TEXT("Rock_%d_%08X"), Seed, FCrc::MemCrc32(Bytes.GetData(), Bytes.Num()));
+}
+
+bool FSpaceRocksRockMeshParams::operator==(const FSpaceRocksRockMeshParams& Other) const
+{
+	return Seed == Other.Seed
+		&& Subdivisions == Other.Subdivisions
+		&& NumLODs == Other.NumLODs
+		&& NoiseAmplitude == Other.NoiseAmplitude
+		&& NoiseFrequency == Other.NoiseFrequency
+		&& NoiseOctaves == Other.NoiseOctaves
+		&& MaxStretch == Other.MaxStretch;
+}
+
+FArchive& operator<<(FArchive& Ar, FSpaceRocksRockMeshLOD& LOD)
+{
+	Ar << LOD.Positions;
+	Ar << LOD.Normals;
+	Ar << LOD.UVs;
+	Ar << LOD.Indices;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FSpaceRocksRockMeshData& Data)
+{
+	Ar << Data.Params;
+	Ar << Data.LODs;
+	Ar << Data.CollisionRadius;
+	Ar << Data.ConvexHull;
+	return Ar;
+}
+
+// ** Noise **
+
+static FORCEINLINE uint32 HashLattice(int32 X, int32 Y, int32 Z, int32 Seed)
+{
+	uint32 H = (uint32)Seed * 0x9E3779B1u;
+	H ^= (uint32)X * 0x85EBCA6Bu;
+	H = (H << 13) | (H >> 19);
+	H ^= (uint32)Y * 0xC2B2AE35u;
+	H = (H << 13) | (H >> 19);
+	H ^= (uint32)Z * 0x27D4EB2Fu;
+	H ^= H >> 16;
+	H *= 0x7FEB352Du;
+	H ^= H >> 15;
+	H *= 0x846CA68Bu;
+	H ^= H >> 16;
+	return H;
+}
+
+// Random value in -1..1 at a lattice point
+static FORCEINLINE float LatticeValue(int32 X, int32 Y, int32 Z, int32 Seed)
+{
+	return (float)(HashLattice(X, Y, Z, Seed) & 0xffffff) * (2.f / (float)0xffffff) - 1.f;
+}
+
+// Smoothly interpolated value noise, -1..1
+static float ValueNoise(const FVector& P, int32 Seed)
+{
+	const int32 X0 = FMath::FloorToInt(P.X);
+	const int32 Y0 = FMath::FloorToInt(P.Y);
+	const int32 Z0 = FMath::FloorToInt(P.Z);
+
+	float FX = P.X - X0;
+	float FY = P.Y - Y0;
+	float FZ = P.Z - Z0;
+	FX = FX * FX * (3.f - 2.f * FX);
+	FY = FY * FY * (3.f - 2.f * FY);
+	FZ = FZ * FZ * (3.f - 2.f * FZ);
+
+	const float X00 = FMath::Lerp(LatticeValue(X0, Y0, Z0, Seed), LatticeValue(X0 + 1, Y0, Z0, Seed), FX);
+	const float X10 = FMath::Lerp(LatticeValue(X0, Y0 + 1, Z0, Seed), LatticeValue(X0 + 1, Y0 + 1, Z0, Seed), FX);
+	const float X01 = FMath::Lerp(LatticeValue(X0, Y0, Z0 + 1, Seed), LatticeValue(X0 + 1, Y0, Z0 + 1, Seed), FX);
+	const float X11 = FMath::Lerp(LatticeValue(X0, Y0 + 1, Z0 + 1, Seed), LatticeValue(X0 + 1, Y0 + 1, Z0 + 1, Seed), FX);
+
+	return FMath::Lerp(FMath::Lerp(X00, X10, FY), FMath::Lerp(X01, X11, FY), FZ);
+}
+
+// Fractal (fBm) noise, -1..1
+static float FractalNoise(const FVector& P, int32 Seed, int32 Octaves)
+{
+	float Sum = 0.f;
+	float Amplitude = 1.f;
+	float Total = 0.f;
+	float Frequency = 1.f;
+	for (int32 Octave = 0; Octave < Octaves; Octave++)
+	{
+		Sum += ValueNoise(P * Frequency, Seed + Octave * 1013) * Amplitude;
+		Total += Amplitude;
+		Amplitude *= 0.5f;
+		Frequency *= 2.f;
+	}
+	return (Total > 0.f) ? Sum / Total : 0.f;
+}
+
+// ** Icosphere **
+
+static int32 GetMidpoint(TArray<FVector>& Dirs, TMap<uint64, int32>& MidpointCache, int32 A, int32 B)
+{
+	const uint64 Key = (A < B) ? (((uint64)A << 32) | (uint32)B) : (((uint64)B << 32) | (uint32)A);
+
+	const int32* Found = MidpointCache.Find(Key);
+	if (Found)
+	{
+		return *Found;
+	}
+
+	const int32 Index = Dirs.Add((Dirs[A] + Dirs[B]).SafeNormal());
+	MidpointCache.Add(Key, Index);
+	return Index;
+}
+
+// Unit icosphere. Triangles wind so that (B - A) ^ (C - A) points outwards.
+static void BuildIcosphere(int32 Subdivisions, TArray<FVector>& OutDirs, TArray<int32>& OutIndices)
+{
+	const float T = (1.f + FMath::Sqrt(5.f)) * 0.5f;
+
+	OutDirs.Reset();
+	OutDirs.Add(FVector(-1.f, T, 0.f).SafeNormal());
+	OutDirs.Add(FVector(1.f, T, 0.f).SafeNormal());
+	OutDirs.Add(FVector(-1.f, -T, 0.f).SafeNormal());
+	OutDirs.Add(FVector(1.f, -T, 0.f).SafeNormal());
+	OutDirs.Add(FVector(0.f, -1.f, T).SafeNormal());
+	OutDirs.Add(FVector(0.f, 1.f, T).SafeNormal());
+	OutDirs.Add(FVector(0.f, -1.f, -T).SafeNormal());
+	OutDirs.Add(FVector(0.f, 1.f, -T).SafeNormal());
+	OutDirs.Add(FVector(T, 0.f, -1.f).SafeNormal());
+	OutDirs.Add(FVector(T, 0.f, 1.f).SafeNormal());
+	OutDirs.Add(FVector(-T, 0.f, -1.f).SafeNormal());
+	OutDirs.Add(FVector(-T, 0.f, 1.f).SafeNormal());
+
+	static const int32 IcosahedronFaces[60] =
+	{
+		0, 11, 5,	0, 5, 1,	0, 1, 7,	0, 7, 10,	0, 10, 11,
+		1, 5, 9,	5, 11, 4,	11, 10, 2,	10, 7, 6,	7, 1, 8,
+		3, 9, 4,	3, 4, 2,	3, 2, 6,	3, 6, 8,	3, 8, 9,
+		4, 9, 5,	2, 4, 11,	6, 2, 10,	8, 6, 7,	9, 8, 1,
+	};
+	OutIndices.Reset();
+	OutIndices.Append(IcosahedronFaces, ARRAY_COUNT(IcosahedronFaces));
+
+	TMap<uint64, int32> MidpointCache;
+	TArray<int32> NextIndices;
+	for (int32 Level = 0; Level < Subdivisions; Level++)
+	{
+		MidpointCache.Reset();
+		NextIndices.Reset();
+		for (int32 Tri = 0; Tri < OutIndices.Num(); Tri += 3)
+		{
+			const int32 A = OutIndices[Tri];
+			const int32 B = OutIndices[Tri + 1];
+			const int32 C = OutIndices[Tri + 2];
+			const int32 AB = GetMidpoint(OutDirs, MidpointCache, A, B);
+			const int32 BC = GetMidpoint(OutDirs, MidpointCache, B, C);
+			const int32 CA = GetMidpoint(OutDirs, MidpointCache, C, A);
+
+			const int32 NewTris[12] = { A, AB, CA,	B, BC, AB,	C, CA, BC,	AB, BC, CA };
+			NextIndices.Append(NewTris, ARRAY_COUNT(NewTris));
+		}
+		Exchange(OutIndices, NextIndices);
+	}
+
+	// Make sure every triangle winds outwards, whatever the face table above says
+	for (int32 Tri = 0; Tri < OutIndices.Num(); Tri += 3)
+	{
+		const FVector& A = OutDirs[OutIndices[Tri]];
+		const FVector& B = OutDirs[OutIndices[Tri + 1]];
+		const FVector& C = OutDirs[OutIndices[Tri + 2]];
+		if ((((B - A) ^ (C - A)) | (A + B + C)) < 0.f)
+		{
+			Exchange(OutIndices[Tri + 1], OutIndices[Tri + 2]);
+		}
+	}
+}
+
+void FSpaceRocksRockMeshGenerator::Generate(const FSpaceRocksRockMeshParams& Params, FSpaceRocksRockMeshData& OutData)
+{
+	OutData.Params = Params;
+	OutData.LODs.Reset();
+	OutData.ConvexHull.Reset();
+
+	// Overall shape: a random squash/stretch per axis
+	FRandomStream Random(Params.Seed);
+	const FVector Stretch(
+		1.f + Random.FRandRange(-Params.MaxStretch, Params.MaxStretch),
+		1.f + Random.FRandRange(-Params.MaxStretch, Params.MaxStretch),
+		1.f + Random.FRandRange(-Params.MaxStretch, Params.MaxStretch));
+	const int32 NoiseSeed = Random.GetCurrentSeed();
+
+	const int32 NumLODs = FMath::Max(Params.NumLODs, 1);
+	TArray<FVector> Dirs;
+
+	for (int32 LODIndex = 0; LODIndex < NumLODs; LODIndex++)
+	{
+		FSpaceRocksRockMeshLOD& LOD = OutData.LODs[OutData.LODs.AddZeroed()];
+
+		// Every LOD samples the same noise, so they all have the same overall shape
+		BuildIcosphere(FMath::Max(Params.Subdivisions - LODIndex, 0), Dirs, LOD.Indices);
+
+		const int32 NumVerts = Dirs.Num();
+		LOD.Positions.AddUninitialized(NumVerts);
+		LOD.UVs.AddUninitialized(NumVerts);
+		LOD.Normals.AddZeroed(NumVerts);
+
+		for (int32 Vert = 0; Vert < NumVerts; Vert++)
+		{
+			const FVector& Dir = Dirs[Vert];
+			const float Displacement = 1.f + Params.NoiseAmplitude * FractalNoise(Dir * Params.NoiseFrequency, NoiseSeed, Params.NoiseOctaves);
+			LOD.Positions[Vert] = Dir * Stretch * (Displacement * ROCKMESH_BASE_RADIUS);
+			LOD.UVs[Vert] = FVector2D(FMath::Atan2(Dir.Y, Dir.X) / (2.f * PI) + 0.5f, FMath::Acos(FMath::Clamp(Dir.Z, -1.f, 1.f)) / PI);
+		}
+
+		// Smooth normals from the (area weighted) face normals
+		for (int32 Tri = 0; Tri < LOD.Indices.Num(); Tri += 3)
+		{
+			const FVector& A = LOD.Positions[LOD.Indices[Tri]];
+			const FVector& B = LOD.Positions[LOD.Indices[Tri + 1]];
+			const FVector& C = LOD.Positions[LOD.Indices[Tri + 2]];
+			const FVector FaceNormal = (B - A) ^ (C - A);
+			LOD.Normals[LOD.Indices[Tri]] += FaceNormal;
+			LOD.Normals[LOD.Indices[Tri + 1]] += FaceNormal;
+			LOD.Normals[LOD.Indices[Tri + 2]] += FaceNormal;
+		}
+		for (int32 Vert = 0; Vert < NumVerts; Vert++)
+		{
+			LOD.Normals[Vert] = LOD.Normals[Vert].SafeNormal();
+		}
+	}
+
+	// ** Simple collision: the lowest LOD as a convex hull, and a sphere of the mean radius to fall back on **
+
+	const FSpaceRocksRockMeshLOD& LOD0 = OutData.LODs[0];
+	float RadiusSum = 0.f;
+	for (int32 Vert = 0; Vert < LOD0.Positions.Num(); Vert++)
+	{
+		RadiusSum += LOD0.Positions[Vert].Size();
+	}
+	OutData.CollisionRadius = RadiusSum / FMath::Max(LOD0.Positions.Num(), 1);
+	OutData.ConvexHull = OutData.LODs.Last().Positions;
+}
+
+// ** Cache **
+
+FString FSpaceRocksRockMeshCache::GetCachePath(const FSpaceRocksRockMeshParams& Params)
+{
+	return FPaths::GameSavedDir() / TEXT("RockMeshCache") / (Params.GetCacheKey() + TEXT(".rockmesh"));
+}
+
+bool FSpaceRocksRockMeshCache::Load(const FSpaceRocksRockMeshParams& Params, FSpaceRocksRockMeshData& OutData)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *GetCachePath(Params), FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	int32 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+	if (Magic != ROCKMESH_CACHE_MAGIC || Version != ROCKMESH_CACHE_VERSION)
+	{
+		return false;
+	}
+
+	Reader << OutData;
+
+	// Guard against a corrupt file, or a key collision (the file name is the hashed key, so compare the params themselves)
+	return !Reader.IsError() && OutData.LODs.Num() > 0 && OutData.Params == Params;
+}
+
+bool FSpaceRocksRockMeshCache::Save(FSpaceRocksRockMeshData& Data)
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	uint32 Magic = ROCKMESH_CACHE_MAGIC;
+	int32 Version = ROCKMESH_CACHE_VERSION;
+	Writer << Magic;
+	Writer << Version;
+	Writer << Data;
+
+	return FFileHelper::SaveArrayToFile(Bytes, *GetCachePath(Data.Params));
+}
+
+void FSpaceRocksRockMeshCache::FindOrGenerate(const FSpaceRocksRockMeshParams& Params, FSpaceRocksRockMeshData& OutData, bool& bOutFromCache)
+{
+	bOutFromCache = Load(Params, OutData);
+	if (bOutFromCache)
+	{
+		return;
+	}
+
+	FSpaceRocksRockMeshGenerator::Generate(Params, OutData);
+	if (!Save(OutData))
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Couldn't write rock mesh cache file %s"), *GetCachePath(Params));
+	}
+}
+
+UStaticMesh* FSpaceRocksRockMeshCache::CreateStaticMesh(const FSpaceRocksRockMeshData& Data, UObject* Outer, UMaterialInterface* Material)
+{
+#if WITH_EDITOR
+	UStaticMesh* StaticMesh = ConstructObject<UStaticMesh>(UStaticMesh::StaticClass(), Outer, NAME_None, RF_Transient);
+	StaticMesh->Materials.Add(Material);
+
+	// LOD screen sizes, highest detail first
+	static const float LODScreenSizes[] = { 1.f, 0.3f, 0.1f, 0.03f, 0.01f };
+
+	for (int32 LODIndex = 0; LODIndex < Data.LODs.Num(); LODIndex++)
+	{
+		const FSpaceRocksRockMeshLOD& LOD = Data.LODs[LODIndex];
+
+		FRawMesh RawMesh;
+		RawMesh.VertexPositions = LOD.Positions;
+
+		// Engine triangles face the other way to ours
+		for (int32 Tri = 0; Tri < LOD.Indices.Num(); Tri += 3)
+		{
+			static const int32 Corners[3] = { 0, 2, 1 };
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const int32 Vert = LOD.Indices[Tri + Corners[Corner]];
+				RawMesh.WedgeIndices.Add(Vert);
+				RawMesh.WedgeTangentX.Add(FVector::ZeroVector);
+				RawMesh.WedgeTangentY.Add(FVector::ZeroVector);
+				RawMesh.WedgeTangentZ.Add(LOD.Normals[Vert]);
+				RawMesh.WedgeTexCoords[0].Add(LOD.UVs[Vert]);
+			}
+			RawMesh.FaceMaterialIndices.Add(0);
+			RawMesh.FaceSmoothingMask.Add(1);
+		}
+
+		FStaticMeshSourceModel* SourceModel = new(StaticMesh->SourceModels) FStaticMeshSourceModel();
+		SourceModel->BuildSettings.bRecomputeNormals = false;
+		SourceModel->BuildSettings.bRecomputeTangents = true;
+		SourceModel->ScreenSize = LODScreenSizes[FMath::Min(LODIndex, (int32)ARRAY_COUNT(LODScreenSizes) - 1)];
+		SourceModel->RawMeshBulkData->SaveRawMesh(RawMesh);
+	}
+
+	StaticMesh->Build(true);
+
+	// Simple collision only - rocks never need per poly collision. The hull, or the sphere if there isn't enough of one.
+	StaticMesh->CreateBodySetup();
+	if (Data.ConvexHull.Num() >= 4)
+	{
+		FKConvexElem Convex;
+		Convex.VertexData = Data.ConvexHull;
+		Convex.UpdateElemBox();
+		StaticMesh->BodySetup->AggGeom.ConvexElems.Add(Convex);
+	}
+	else
+	{
+		StaticMesh->BodySetup->AggGeom.SphereElems.Add(FKSphereElem(Data.CollisionRadius));
+	}
+	StaticMesh->BodySetup->CollisionTraceFlag = CTF_UseSimpleAsComplex;
+	StaticMesh->BodySetup->InvalidatePhysicsData();
+	StaticMesh->BodySetup->CreatePhysicsMeshes();
+
+	return StaticMesh;
+#else
+	// Cooked builds can't build static meshes at runtime. Callers fall back to the authored rock meshes.
+	return NULL;
+#endif
+}
+
+// ** Async task **
+
+void FSpaceRocksRockMeshTask::DoWork()
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	Variants.Reset();
+	Variants.AddDefaulted(NumVariants);
+
+	TArray<bool> FromCache;
+	FromCache.AddZeroed(NumVariants);
+
+	// Each variant is independent, so spread them over the task graph workers
+	SpaceRocksParallelFor(NumVariants, [&](int32 Variant)
+	{
+		FSpaceRocksRockMeshParams Params = BaseParams;
+		Params.Seed = BaseParams.Seed + Variant;
+
+		bool bFromCache = false;
+		FSpaceRocksRockMeshCache::FindOrGenerate(Params, Variants[Variant], bFromCache);
+		FromCache[Variant] = bFromCache;
+	}, 1);
+
+	NumFromCache = 0;
+	for (int32 Variant = 0; Variant < NumVariants; Variant++)
+	{
+		NumFromCache += FromCache[Variant] ? 1 : 0;
+	}
+
+	TaskSeconds = FPlatformTime::Seconds() - StartTime;
+}
@@ -0,0 +1,207 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksRockMeshLibrary.h"
+#include "SpaceRocksRock.h"
+#include "SpaceRocksGameState.h"
+#include "SpaceRocksTrace.h"
+
+ASpaceRocksRockMeshLibrary::ASpaceRocksRockMeshLibrary(const class FPostConstructInitializeProperties& PCIP)
+	: Super(PCIP)
+{
+	struct FConstructorStatics
+	{
+		ConstructorHelpers::FObjectFinderOptional<UMaterialInterface> RockMaterial;
+		FConstructorStatics()
+			: RockMaterial(TEXT("MaterialInstanceConstant'/Game/SpaceRocks/Materials/M_Cave_Rock_Small_Inst.M_Cave_Rock_Small_Inst'"))
+		{
+		}
+	};
+	static FConstructorStatics ConstructorStatics;
+
+	// Instanced components are attached to this, at the origin, so instance space is world space
+	RootComponent = PCIP.CreateDefaultSubobject<USceneComponent>(this, TEXT("SceneComp0"));
+
+	NumVariants = 8;
+	BaseSeed = 1;
+	Subdivisions = 4;
+	NumLODs = 3;
+	NoiseAmplitude = 0.35f;
+	NoiseFrequency = 1.5f;
+	RockMaterial = ConstructorStatics.RockMaterial.Get();
+	bInstancedRendering = true;
+
+	MeshTask = NULL;
+
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void ASpaceRocksRockMeshLibrary::BeginPlay()
+{
+	Super::BeginPlay();
+
+	SetActorLocationAndRotation(FVector::ZeroVector, FRotator::ZeroRotator);
+
+	FSpaceRocksRockMeshParams Params;
+	Params.Seed = BaseSeed;
+	Params.Subdivisions = Subdivisions;
+	Params.NumLODs = NumLODs;
+	Params.NoiseAmplitude = NoiseAmplitude;
+	Params.NoiseFrequency = NoiseFrequency;
+
+	// Load or generate all the variants on the thread pool
+	MeshTask = new FAsyncTask<FSpaceRocksRockMeshTask>(Params, FMath::Max(NumVariants, 1));
+	MeshTask->StartBackgroundTask();
+}
+
+void ASpaceRocksRockMeshLibrary::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Can't leave a worker writing into us (Destroyed isn't called when the map is torn down)
+	if (MeshTask)
+	{
+		MeshTask->EnsureCompletion();
+		delete MeshTask;
+		MeshTask = NULL;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ASpaceRocksRockMeshLibrary::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (MeshTask && MeshTask->IsDone())
+	{
+		FinishVariants();
+		delete MeshTask;
+		MeshTask = NULL;
+	}
+
+	if (!IsReady())
+	{
+		return;
+	}
+
+	// Hand out variants to any new rocks
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState)
+	{
+		for (int32 Index = 0; Index < GameState->SpaceRocks.Num(); Index++)
+		{
+			ASpaceRocksRock* const Rock = GameState->SpaceRocks[Index];
+			if (Rock && Rock->MeshVariant == INDEX_NONE)
+			{
+				AssignVariant(Rock, GetTypeHash(Rock->GetFName()));
+			}
+		}
+	}
+
+	if (bInstancedRendering)
+	{
+		UpdateInstances();
+	}
+}
+
+void ASpaceRocksRockMeshLibrary::FinishVariants()
+{
+	const FSpaceRocksRockMeshTask& Task = MeshTask->GetTask();
+
+	UE_LOG(LogFlying, Log, TEXT("Rock meshes: %d variants (%d from cache) in %.2f ms"), Task.Variants.Num(), Task.NumFromCache, Task.TaskSeconds * 1000.0);
+
+	VariantMeshes.Reset();
+	for (int32 Variant = 0; Variant < Task.Variants.Num(); Variant++)
+	{
+		UStaticMesh* const Mesh = FSpaceRocksRockMeshCache::CreateStaticMesh(Task.Variants[Variant], this, RockMaterial);
+		if (Mesh == NULL)
+		{
+			// Can't build meshes here (cooked build) - leave the rocks with their authored meshes
+			UE_LOG(LogFlying, Log, TEXT("Rock meshes: can't build static meshes at runtime, keeping authored rock meshes"));
+			VariantMeshes.Reset();
+			return;
+		}
+		VariantMeshes.Add(Mesh);
+	}
+
+	if (!bInstancedRendering)
+	{
+		return;
+	}
+
+	for (int32 Variant = 0; Variant < VariantMeshes.Num(); Variant++)
+	{
+		UInstancedStaticMeshComponent* const Instances = ConstructObject<UInstancedStaticMeshComponent>(UInstancedStaticMeshComponent::StaticClass(), this);
+		Instances->SetStaticMesh(VariantMeshes[Variant]);
+		Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);	// The rocks themselves still collide
+		Instances->SetMobility(EComponentMobility::Movable);
+		Instances->AttachTo(RootComponent);
+		Instances->RegisterComponent();
+		VariantInstances.Add(Instances);
+	}
+}
+
+void ASpaceRocksRockMeshLibrary::AssignVariant(ASpaceRocksRock* Rock, int32 RockSeed)
+{
+	if (!IsReady())
+	{
+		return;
+	}
+
+	const int32 Variant = (int32)((uint32)RockSeed % (uint32)VariantMeshes.Num());
+
+	// Changing mesh recreates the physics body, so hang on to the rock's velocity
+	const FVector Velocity = Rock->GetRockVelocity();
+	Rock->MeshVariant = Variant;
+	Rock->RockMesh->SetStaticMesh(VariantMeshes[Variant]);
+	Rock->SetRockVelocity(Velocity);
+	Rock->UpdateRockSize();
+
+	if (bInstancedRendering)
+	{
+		Rock->RockMesh->SetHiddenInGame(true);
+	}
+}
+
+void ASpaceRocksRockMeshLibrary::UpdateInstances()
+{
+	SPACEROCKS_TRACE_SCOPE(RockInstances);
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState == NULL || VariantInstances.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<int32, TInlineAllocator<16> > Counts;
+	Counts.AddZeroed(VariantInstances.Num());
+
+	// One instance per live rock. Instances are reused from frame to frame, only added when a variant needs more.
+	for (int32 Index = 0; Index < GameState->SpaceRocks.Num(); Index++)
+	{
+		const ASpaceRocksRock* const Rock = GameState->SpaceRocks[Index];
+		if (Rock == NULL || !VariantInstances.IsValidIndex(Rock->MeshVariant))
+		{
+			continue;
+		}
+
+		UInstancedStaticMeshComponent* const Instances = VariantInstances[Rock->MeshVariant];
+		const int32 Instance = Counts[Rock->MeshVariant]++;
+		if (Instance < Instances->GetInstanceCount())
+		{
+			Instances->UpdateInstanceTransform(Instance, Rock->GetTransform(), true);
+		}
+		else
+		{
+			Instances->AddInstanceWorldSpace(Rock->GetTransform());
+		}
+	}
+
+	// Remove instances left over from rocks that have gone since last frame, from the end so nothing else moves
+	for (int32 Variant = 0; Variant < VariantInstances.Num(); Variant++)
+	{
+		UInstancedStaticMeshComponent* const Instances = VariantInstances[Variant];
+		for (int32 Instance = Instances->GetInstanceCount() - 1; Instance >= Counts[Variant]; Instance--)
+		{
+			Instances->RemoveInstance(Instance);
+		}
+	}
+}
@@ -0,0 +1,121 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksSnapshot.h"
+
+DEFINE_STAT(STAT_SpaceRocksSnapshotPublish);
+
+FSpaceRocksSnapshotBuffer::FSpaceRocksSnapshotBuffer()
+	: Latest(INDEX_NONE)
+	, Writing(INDEX_NONE)
+	, NumSkipped(0)
+{
+}
+
+FSpaceRocksWorldSnapshot* FSpaceRocksSnapshotBuffer::BeginPublish()
+{
+	check(IsInGameThread() && Writing == INDEX_NONE);
+
+	// Any slot but the latest that nobody is reading. A reader that pins a slot after this check
+	// sees it isn't the latest and lets go again (see Acquire).
+	const int32 CurrentLatest = Latest;
+	for (int32 Slot = 0; Slot < NUM_SLOTS; Slot++)
+	{
+		if (Slot != CurrentLatest && Readers[Slot].GetValue() == 0)
+		{
+			Writing = Slot;
+			return &Slots[Slot];
+		}
+	}
+
+	NumSkipped++;
+	return NULL;
+}
+
+void FSpaceRocksSnapshotBuffer::EndPublish()
+{
+	check(IsInGameThread() && Writing != INDEX_NONE);
+
+	// Full barrier - the snapshot's contents are visible before it is
+	FPlatformAtomics::InterlockedExchange(&Latest, Writing);
+	Writing = INDEX_NONE;
+}
+
+int32 FSpaceRocksSnapshotBuffer::Acquire()
+{
+	for (;;)
+	{
+		const int32 Slot = Latest;
+		if (Slot == INDEX_NONE)
+		{
+			return INDEX_NONE;
+		}
+
+		// Pin it, then make sure it is still the latest. If it is, the writer can't pick it until we let go.
+		// If not, the writer may already be filling it in, so try again with the newer one.
+		Readers[Slot].Increment();
+		if (Latest == Slot)
+		{
+			return Slot;
+		}
+		Readers[Slot].Decrement();
+	}
+}
+
+void FSpaceRocksSnapshotBuffer::Release(int32 Slot)
+{
+	Readers[Slot].Decrement();
+}
+
+void FSpaceRocksSnapshotCheckTask::DoWork()
+{
+	const double EndTime = FPlatformTime::Seconds() + Seconds;
+
+	int32 NumReads = 0;
+	int32 NumTorn = 0;
+	int32 NumBackwards = 0;
+	int32 NumFrames = 0;
+	uint64 LastFrame = 0;
+
+	while (FPlatformTime::Seconds() < EndTime)
+	{
+		FSpaceRocksSnapshotReader Snapshot(*Buffer);
+		if (!Snapshot.IsValid())
+		{
+			FPlatformProcess::Sleep(0.001f);
+			continue;
+		}
+		NumReads++;
+
+		// Go through everything, as a real reader would, then check nothing changed underneath us
+		const uint64 Frame = Snapshot->Frame;
+		int32 NumCraft = 0;
+		for (int32 Index = 0; Index < Snapshot->Craft.Num(); Index++)
+		{
+			NumCraft += (Snapshot->Craft[Index].Id != 0) ? 1 : 0;
+		}
+		int32 NumRocks = 0;
+		for (int32 Index = 0; Index < Snapshot->Rocks.Num(); Index++)
+		{
+			NumRocks += (Snapshot->Rocks[Index].Radius > 0.f) ? 1 : 0;
+		}
+
+		if (Snapshot->EndFrame != Frame || Snapshot->Frame != Frame || NumCraft != Snapshot->Craft.Num() || NumRocks != Snapshot->Rocks.Num())
+		{
+			NumTorn++;
+		}
+		if (Snapshot->Frame < LastFrame)
+		{
+			NumBackwards++;
+		}
+		else if (Snapshot->Frame > LastFrame)
+		{
+			NumFrames++;
+			LastFrame = Snapshot->Frame;
+		}
+	}
+
+	UE_LOG(LogFlying, Display, TEXT("Snapshot check: %d reads of %d frames in %.1f s, %d torn, %d out of order, %d frames skipped by the writer: %s"),
+		NumReads, NumFrames, Seconds, NumTorn, NumBackwards, Buffer->GetNumSkipped(),
+		(NumTorn == 0 && NumBackwards == 0) ? TEXT("ok") : TEXT("FAILED"));
+}
@@ -0,0 +1,418 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksSoakTest.h"
+#include "SpaceRocksGameState.h"
+#include "SpaceRocksPawn.h"
+#include "SpaceRocksRock.h"
+#include "SpaceRocksProjectile.h"
+
+ASpaceRocksSoakTest::ASpaceRocksSoakTest(const class FPostConstructInitializeProperties& PCIP)
+	: Super(PCIP)
+{
+	SampleInterval = 10.f;
+	WarmupSeconds = 300.f;
+	MinTrendSamples = 30;
+	MaxMemorySlopeMBPerHour = 20.f;
+	MaxObjectSlopePerHour = 500.f;
+	MaxActorSlopePerHour = 100.f;
+	MaxFrameTimeSlopeMsPerHour = 1.f;
+	LevelTimeLimit = 120.f;
+	bFailed = false;
+
+	StartTime = 0.0;
+	LastFrameTime = 0.0;
+	NextSampleTime = 0.0;
+	LevelStartTime = 0.0;
+	PhysicsKickoffToFetchMsSum = 0.0;
+	ContactPairsSum = 0.0;
+	NumPhysicsFrames = 0;
+	SoakDuration = 0.0;
+	WeaponSwitchTimer = 0.f;
+	AutopilotWeapon = 0;
+
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bTickEvenWhenPaused = true;
+}
+
+bool ASpaceRocksSoakTest::IsSoakRequested()
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("SpaceRocksSoak"));
+}
+
+void ASpaceRocksSoakTest::BeginPlay()
+{
+	Super::BeginPlay();
+
+	float Duration = 0.f;
+	if (FParse::Value(FCommandLine::Get(), TEXT("SoakDuration="), Duration))
+	{
+		SoakDuration = Duration;
+	}
+
+	StartTime = FPlatformTime::Seconds();
+	LastFrameTime = StartTime;
+	NextSampleTime = SampleInterval;
+	LevelStartTime = StartTime;
+
+	CsvPath = FPaths::GameSavedDir() / TEXT("Soak") / FString::Printf(TEXT("Soak_%s.csv"), *FDateTime::Now().ToString());
+	FFileHelper::SaveStringToFile(TEXT("Time,UsedMemoryMB,NumObjects,NumActors,NumRocks,NumProjectiles,FrameTimeP50,FrameTimeP95,FrameTimeP99,InputLatencyP95,PhysicsKickoffToFetchMs,ContactPairs,Level,Map\n"), *CsvPath);
+
+	// The soak test needs a constant supply of rocks, so always generate them
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState)
+	{
+		GameState->bGenerateRockField = true;
+		if (GameState->SpaceRocks.Num() == 0 && !GameState->IsRockFieldPending())
+		{
+			GameState->StartRockField();
+		}
+	}
+
+	UE_LOG(LogFlying, Display, TEXT("Soak test started (%s), writing samples to %s"),
+		SoakDuration > 0.0 ? *FString::Printf(TEXT("%.0f seconds"), SoakDuration) : TEXT("until stopped"), *CsvPath);
+}
+
+void ASpaceRocksSoakTest::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	// Wall clock frame time (DeltaSeconds may be fixed under -benchmark)
+	const double Now = FPlatformTime::Seconds();
+	FrameTimes.Add((float)((Now - LastFrameTime) * 1000.0));
+	LastFrameTime = Now;
+
+	const ASpaceRocksGameState* const PhysicsGameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (PhysicsGameState)
+	{
+		PhysicsKickoffToFetchMsSum += PhysicsGameState->PhysicsKickoffToFetchMs;
+		ContactPairsSum += PhysicsGameState->PhysicsContactPairs;
+		NumPhysicsFrames++;
+	}
+
+	ASpaceRocksPawn* Pawn = NULL;
+	for (TActorIterator<ASpaceRocksPawn> It(GetWorld()); It && !Pawn; ++It)
+	{
+		Pawn = *It;
+	}
+
+	if (Pawn)
+	{
+		// Take the controls away from the player, so the input bindings don't fight the autopilot
+		if (ControlledPawn.Get() != Pawn)
+		{
+			ControlledPawn = Pawn;
+			Pawn->DisableInput(Cast<APlayerController>(Pawn->Controller));
+		}
+
+		UpdateAutopilot(Pawn, DeltaSeconds);
+	}
+
+	UpdateLevels();
+
+	if (Now - StartTime >= NextSampleTime)
+	{
+		NextSampleTime += SampleInterval;
+		TakeSample();
+		CheckTrends();
+	}
+
+	if (!bFailed && SoakDuration > 0.0 && Now - StartTime >= SoakDuration)
+	{
+		LogReport();
+		UE_LOG(LogFlying, Display, TEXT("Soak test PASSED after %.0f seconds"), Now - StartTime);
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void ASpaceRocksSoakTest::UpdateAutopilot(ASpaceRocksPawn* Pawn, float DeltaSeconds)
+{
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+
+	const FVector CraftLocation = Pawn->GetActorLocation();
+	const FTransform CraftTransform = Pawn->PlaneMesh->GetComponentTransform();
+
+	// ** Find the nearest rock, and the nearest rock in our flight path **
+
+	const ASpaceRocksRock* Target = NULL;
+	float TargetDist2 = MAX_FLT;
+	float ObstacleDist = MAX_FLT;
+	FVector ObstacleLocal(0.f, 0.f, 0.f);
+
+	if (GameState)
+	{
+		for (int32 Index = 0; Index < GameState->SpaceRocks.Num(); Index++)
+		{
+			const ASpaceRocksRock* const Rock = GameState->SpaceRocks[Index];
+			if (Rock == NULL)
+			{
+				continue;
+			}
+
+			const FVector Delta = Rock->GetActorLocation() - CraftLocation;
+			const float Dist2 = Delta.SizeSquared();
+			if (Dist2 < TargetDist2)
+			{
+				TargetDist2 = Dist2;
+				Target = Rock;
+			}
+
+			const FVector Local = CraftTransform.InverseTransformVectorNoScale(Delta);
+			if (Local.X > 0.f && Local.X < 3000.f && Local.X < ObstacleDist && FMath::Sqrt(Local.Y * Local.Y + Local.Z * Local.Z) < Rock->Radius + 300.f)
+			{
+				ObstacleDist = Local.X;
+				ObstacleLocal = Local;
+			}
+		}
+	}
+
+	// ** Steer at the target (or wander if there isn't one) **
+
+	float Yaw = 0.3f;
+	float Pitch = 0.f;
+	float Forward = 0.5f;
+	float Side = 0.f;
+	float Up = 0.f;
+	bool bFire = false;
+
+	if (Target)
+	{
+		const FVector Local = CraftTransform.InverseTransformVectorNoScale(Target->GetActorLocation() - CraftLocation);
+		const float YawAngle = FMath::RadiansToDegrees(FMath::Atan2(Local.Y, Local.X));
+		const float PitchAngle = FMath::RadiansToDegrees(FMath::Atan2(Local.Z, FMath::Sqrt(Local.X * Local.X + Local.Y * Local.Y)));
+		const float Dist = FMath::Sqrt(TargetDist2);
+
+		// Note pitch input is inverted (mouse style)
+		Yaw = FMath::Clamp(YawAngle / 30.f, -1.f, 1.f);
+		Pitch = FMath::Clamp(-PitchAngle / 30.f, -1.f, 1.f);
+		Forward = (Dist > 3000.f) ? 1.f : ((Dist < 1500.f) ? -1.f : 0.f);
+		bFire = FMath::Abs(YawAngle) < 10.f && FMath::Abs(PitchAngle) < 10.f;
+	}
+
+	// Dodge whatever is in the way
+	if (ObstacleDist < MAX_FLT && ObstacleDist < 1500.f)
+	{
+		Side = (ObstacleLocal.Y > 0.f) ? -1.f : 1.f;
+		Up = (ObstacleLocal.Z > 0.f) ? -1.f : 1.f;
+	}
+
+	Pawn->YawCraft(Yaw);
+	Pawn->PitchCraft(Pitch);
+	Pawn->RollCraft(0.f);
+	Pawn->RearThrust(Forward);
+	Pawn->SideThrust(Side);
+	Pawn->BottomThrust(Up);
+
+	if (bFire != Pawn->primary_on)
+	{
+		if (bFire)
+		{
+			Pawn->firePrimary_pressed();
+		}
+		else
+		{
+			Pawn->firePrimary_released();
+		}
+	}
+
+	// Try a different weapon slot now and then
+	WeaponSwitchTimer += DeltaSeconds;
+	if (WeaponSwitchTimer > 20.f)
+	{
+		WeaponSwitchTimer = 0.f;
+		AutopilotWeapon = (AutopilotWeapon + 1) % NUM_WEAP_SLOTS;
+		Pawn->SelectWeapon(AutopilotWeapon);
+	}
+}
+
+void ASpaceRocksSoakTest::UpdateLevels()
+{
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	if (GameState == NULL || GameState->IsRockFieldPending())
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (GameState->SpaceRocks.Num() > 0 && Now - LevelStartTime < LevelTimeLimit)
+	{
+		return;
+	}
+
+	// Clear whatever is left (Destroy unregisters, so work from a copy) and move on
+	TArray<ASpaceRocksRock*> RocksLeft = GameState->SpaceRocks;
+	for (int32 Index = 0; Index < RocksLeft.Num(); Index++)
+	{
+		if (RocksLeft[Index])
+		{
+			RocksLeft[Index]->Destroy();
+		}
+	}
+
+	GameState->NextLevel();
+	LevelStartTime = Now;
+
+	UE_LOG(LogFlying, Log, TEXT("Soak test: level %d, %d rocks"), GameState->curr_level, GameState->curr_spacerocks);
+}
+
+void ASpaceRocksSoakTest::TakeSample()
+{
+	FSpaceRocksSoakSample Sample;
+	Sample.Time = FPlatformTime::Seconds() - StartTime;
+	Sample.UsedMemoryMB = (float)((double)FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0));
+
+	Sample.NumObjects = 0;
+	for (FObjectIterator It; It; ++It)
+	{
+		Sample.NumObjects++;
+	}
+
+	Sample.NumActors = 0;
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		Sample.NumActors++;
+	}
+
+	ASpaceRocksGameState* const GameState = Cast<ASpaceRocksGameState>(GetWorld()->GameState);
+	Sample.NumRocks = GameState ? GameState->SpaceRocks.Num() : 0;
+	Sample.NumProjectiles = GameState ? GameState->Projectiles.Num() : 0;
+	Sample.Level = GameState ? GameState->curr_level : 0;
+
+	// Frame time percentiles over the interval
+	FrameTimes.Sort();
+	const int32 NumFrames = FrameTimes.Num();
+	Sample.FrameTimeP50 = NumFrames ? FrameTimes[FMath::Min(NumFrames / 2, NumFrames - 1)] : 0.f;
+	Sample.FrameTimeP95 = NumFrames ? FrameTimes[FMath::Min((NumFrames * 95) / 100, NumFrames - 1)] : 0.f;
+	Sample.FrameTimeP99 = NumFrames ? FrameTimes[FMath::Min((NumFrames * 99) / 100, NumFrames - 1)] : 0.f;
+	FrameTimes.Reset();
+
+	const ASpaceRocksPawn* const Pawn = ControlledPawn.Get();
+	Sample.InputLatencyP95 = Pawn ? Pawn->InputLatency.GetCombined().Percentile(0.95f) : 0.f;
+
+	Sample.PhysicsKickoffToFetchMs = NumPhysicsFrames ? (float)(PhysicsKickoffToFetchMsSum / NumPhysicsFrames) : 0.f;
+	Sample.ContactPairs = NumPhysicsFrames ? (float)(ContactPairsSum / NumPhysicsFrames) : 0.f;
+	PhysicsKickoffToFetchMsSum = 0.0;
+	ContactPairsSum = 0.0;
+	NumPhysicsFrames = 0;
+
+	Samples.Add(Sample);
+
+	// Map name without the editor's PIE prefix, so runs compare the same wherever they came from (see Tools/SpaceRocksPerf)
+	const FString MapName = UWorld::RemovePIEPrefix(GetWorld()->GetMapName());
+	const FString Line = FString::Printf(TEXT("%.1f,%.2f,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%d,%s\n"),
+		Sample.Time, Sample.UsedMemoryMB, Sample.NumObjects, Sample.NumActors, Sample.NumRocks, Sample.NumProjectiles,
+		Sample.FrameTimeP50, Sample.FrameTimeP95, Sample.FrameTimeP99, Sample.InputLatencyP95, Sample.PhysicsKickoffToFetchMs, Sample.ContactPairs,
+		Sample.Level, *MapName);
+	FFileHelper::SaveStringToFile(Line, *CsvPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+}
+
+double ASpaceRocksSoakTest::FitSlope(const TArray<double>& Values) const
+{
+	// Least squares fit, time in hours
+	double SumX = 0.0, SumY = 0.0;
+	int32 Count = 0;
+	for (int32 Index = 0; Index < Samples.Num(); Index++)
+	{
+		if (Samples[Index].Time >= WarmupSeconds)
+		{
+			SumX += Samples[Index].Time / 3600.0;
+			SumY += Values[Index];
+			Count++;
+		}
+	}
+
+	if (Count < 2)
+	{
+		return 0.0;
+	}
+
+	const double MeanX = SumX / Count;
+	const double MeanY = SumY / Count;
+	double Covariance = 0.0, Variance = 0.0;
+	for (int32 Index = 0; Index < Samples.Num(); Index++)
+	{
+		if (Samples[Index].Time >= WarmupSeconds)
+		{
+			const double DX = Samples[Index].Time / 3600.0 - MeanX;
+			Covariance += DX * (Values[Index] - MeanY);
+			Variance += DX * DX;
+		}
+	}
+
+	return (Variance > 0.0) ? Covariance / Variance : 0.0;
+}
+
+void ASpaceRocksSoakTest::CheckTrends()
+{
+	int32 NumTrendSamples = 0;
+	for (int32 Index = 0; Index < Samples.Num(); Index++)
+	{
+		NumTrendSamples += (Samples[Index].Time >= WarmupSeconds) ? 1 : 0;
+	}
+	if (bFailed || NumTrendSamples < MinTrendSamples)
+	{
+		return;
+	}
+
+	TArray<double> Memory, Objects, Actors, FrameTime;
+	for (int32 Index = 0; Index < Samples.Num(); Index++)
+	{
+		Memory.Add(Samples[Index].UsedMemoryMB);
+		Objects.Add(Samples[Index].NumObjects);
+		Actors.Add(Samples[Index].NumActors);
+		FrameTime.Add(Samples[Index].FrameTimeP99);
+	}
+
+	struct FTrend
+	{
+		const TCHAR* Name;
+		double Slope;
+		float Limit;
+	};
+	const FTrend Trends[] =
+	{
+		{ TEXT("Used memory (MB/hour)"), FitSlope(Memory), MaxMemorySlopeMBPerHour },
+		{ TEXT("UObjects (/hour)"), FitSlope(Objects), MaxObjectSlopePerHour },
+		{ TEXT("Actors (/hour)"), FitSlope(Actors), MaxActorSlopePerHour },
+		{ TEXT("p99 frame time (ms/hour)"), FitSlope(FrameTime), MaxFrameTimeSlopeMsPerHour },
+	};
+
+	for (int32 Index = 0; Index < ARRAY_COUNT(Trends); Index++)
+	{
+		if (Trends[Index].Slope > Trends[Index].Limit)
+		{
+			UE_LOG(LogFlying, Error, TEXT("Soak test: %s trend %.3f is over the limit of %.3f"), Trends[Index].Name, Trends[Index].Slope, Trends[Index].Limit);
+			bFailed = true;
+		}
+	}
+
+	if (bFailed)
+	{
+		LogReport();
+		UE_LOG(LogFlying, Error, TEXT("Soak test FAILED after %.0f seconds (samples in %s)"), Samples.Last().Time, *CsvPath);
+
+		// A normal exit returns 0. A forced exit with GIsCriticalError set returns non-zero, so CI sees the failure.
+		GIsCriticalError = true;
+		GLog->Flush();
+		FPlatformMisc::RequestExit(true);
+	}
+}
+
+void ASpaceRocksSoakTest::LogReport() const
+{
+	if (Samples.Num() == 0)
+	{
+		return;
+	}
+
+	const FSpaceRocksSoakSample& Last = Samples.Last();
+	UE_LOG(LogFlying, Display, TEXT("Soak test at %.0fs: level %d, %.1f MB used, %d objects, %d actors, %d rocks, %d projectiles, frame p50/p95/p99 %.2f/%.2f/%.2f ms"),
+		Last.Time, Last.Level, Last.UsedMemoryMB, Last.NumObjects, Last.NumActors, Last.NumRocks, Last.NumProjectiles,
+		Last.FrameTimeP50, Last.FrameTimeP95, Last.FrameTimeP99);
+
+	const ASpaceRocksPawn* const Pawn = ControlledPawn.Get();
+	if (Pawn)
+	{
+		Pawn->InputLatency.LogReport(TEXT("soak autopilot"));
+	}
+}
@@ -0,0 +1,786 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksTargeting.h"
+
+DEFINE_STAT(STAT_SpaceRocksTargetRefit);
+DEFINE_STAT(STAT_SpaceRocksTargetQuery);
+DEFINE_STAT(STAT_SpaceRocksTargetRayCast);
+
+static FORCEINLINE float BoxArea(const FBox& Box)
+{
+	const FVector Size = Box.Max - Box.Min;
+	return 2.f * (Size.X * Size.Y + Size.Y * Size.Z + Size.Z * Size.X);
+}
+
+static FORCEINLINE FBox BoxUnion(const FBox& A, const FBox& B)
+{
+	return FBox(FVector(FMath::Min(A.Min.X, B.Min.X), FMath::Min(A.Min.Y, B.Min.Y), FMath::Min(A.Min.Z, B.Min.Z)),
+		FVector(FMath::Max(A.Max.X, B.Max.X), FMath::Max(A.Max.Y, B.Max.Y), FMath::Max(A.Max.Z, B.Max.Z)));
+}
+
+static FORCEINLINE bool BoxContains(const FBox& Outer, const FBox& Inner)
+{
+	return Outer.Min.X <= Inner.Min.X && Outer.Min.Y <= Inner.Min.Y && Outer.Min.Z <= Inner.Min.Z
+		&& Outer.Max.X >= Inner.Max.X && Outer.Max.Y >= Inner.Max.Y && Outer.Max.Z >= Inner.Max.Z;
+}
+
+// Squared distance from a point to a box (0 inside)
+static FORCEINLINE float BoxDistanceSquared(const FBox& Box, const FVector& Point)
+{
+	const float DX = FMath::Max3(Box.Min.X - Point.X, 0.f, Point.X - Box.Max.X);
+	const float DY = FMath::Max3(Box.Min.Y - Point.Y, 0.f, Point.Y - Box.Max.Y);
+	const float DZ = FMath::Max3(Box.Min.Z - Point.Z, 0.f, Point.Z - Box.Max.Z);
+	return DX * DX + DY * DY + DZ * DZ;
+}
+
+// Does a ray (given as its origin and 1 / direction) pass through a box before MaxDistance? Slab test.
+static FORCEINLINE bool RayHitsBox(const FBox& Box, const FVector& Origin, const FVector& InvDirection, float MaxDistance)
+{
+	const float X1 = (Box.Min.X - Origin.X) * InvDirection.X;
+	const float X2 = (Box.Max.X - Origin.X) * InvDirection.X;
+	const float Y1 = (Box.Min.Y - Origin.Y) * InvDirection.Y;
+	const float Y2 = (Box.Max.Y - Origin.Y) * InvDirection.Y;
+	const float Z1 = (Box.Min.Z - Origin.Z) * InvDirection.Z;
+	const float Z2 = (Box.Max.Z - Origin.Z) * InvDirection.Z;
+
+	const float Enter = FMath::Max(FMath::Max3(FMath::Min(X1, X2), FMath::Min(Y1, Y2), FMath::Min(Z1, Z2)), 0.f);
+	const float Exit = FMath::Min(FMath::Min3(FMath::Max(X1, X2), FMath::Max(Y1, Y2), FMath::Max(Z1, Z2)), MaxDistance);
+	return Enter <= Exit;
+}
+
+// 1 / Value, but huge rather than infinite for (near) 0, so a ray parallel to a slab never gives 0 * inf
+static FORCEINLINE float SafeInverse(float Value)
+{
+	return (FMath::Abs(Value) > SMALL_NUMBER) ? 1.f / Value : BIG_NUMBER;
+}
+
+FSpaceRocksTargetBVH::FSpaceRocksTargetBVH()
+	: FatMargin(100.f)
+	, DisplacementMultiplier(4.f)
+	, Root(INDEX_NONE)
+	, FreeList(INDEX_NONE)
+	, ProxyCount(0)
+{
+}
+
+int32 FSpaceRocksTargetBVH::AllocateNode()
+{
+	int32 Node = FreeList;
+	if (Node == INDEX_NONE)
+	{
+		Node = Nodes.AddUninitialized();
+	}
+	else
+	{
+		FreeList = Nodes[Node].Parent;
+	}
+
+	FNode& NewNode = Nodes[Node];
+	NewNode.Actor = NULL;
+	NewNode.Parent = INDEX_NONE;
+	NewNode.Child1 = INDEX_NONE;
+	NewNode.Child2 = INDEX_NONE;
+	NewNode.Height = 0;
+	NewNode.Radius = 0.f;
+	return Node;
+}
+
+void FSpaceRocksTargetBVH::FreeNode(int32 Node)
+{
+	Nodes[Node].Parent = FreeList;
+	Nodes[Node].Height = -1;
+	Nodes[Node].Actor = NULL;
+	FreeList = Node;
+}
+
+int32 FSpaceRocksTargetBVH::CreateProxy(const FVector& Centre, float Radius, AActor* Actor)
+{
+	const int32 Proxy = AllocateNode();
+
+	FNode& Leaf = Nodes[Proxy];
+	Leaf.Centre = Centre;
+	Leaf.Radius = Radius;
+	Leaf.Actor = Actor;
+	Leaf.Bounds = FBox(Centre - FVector(Radius + FatMargin), Centre + FVector(Radius + FatMargin));
+
+	InsertLeaf(Proxy);
+	ProxyCount++;
+	return Proxy;
+}
+
+void FSpaceRocksTargetBVH::DestroyProxy(int32 Proxy)
+{
+	check(Nodes.IsValidIndex(Proxy) && Nodes[Proxy].IsLeaf() && Nodes[Proxy].Height == 0);
+
+	RemoveLeaf(Proxy);
+	FreeNode(Proxy);
+	ProxyCount--;
+}
+
+bool FSpaceRocksTargetBVH::MoveProxy(int32 Proxy, const FVector& Centre, float Radius, const FVector& Displacement)
+{
+	FNode& Leaf = Nodes[Proxy];
+	Leaf.Centre = Centre;
+	Leaf.Radius = Radius;
+
+	const FBox Tight(Centre - FVector(Radius), Centre + FVector(Radius));
+	if (BoxContains(Leaf.Bounds, Tight))
+	{
+		return false;
+	}
+
+	// Left the fat box - grow a new one, stretched in the direction of travel, and reinsert
+	RemoveLeaf(Proxy);
+
+	FBox Fat(Tight.Min - FVector(FatMargin), Tight.Max + FVector(FatMargin));
+	const FVector Stretch = Displacement * DisplacementMultiplier;
+	Fat.Min += FVector(FMath::Min(Stretch.X, 0.f), FMath::Min(Stretch.Y, 0.f), FMath::Min(Stretch.Z, 0.f));
+	Fat.Max += FVector(FMath::Max(Stretch.X, 0.f), FMath::Max(Stretch.Y, 0.f), FMath::Max(Stretch.Z, 0.f));
+	Nodes[Proxy].Bounds = Fat;
+
+	InsertLeaf(Proxy);
+	return true;
+}
+
+void FSpaceRocksTargetBVH::InsertLeaf(int32 Leaf)
+{
+	if (Root == INDEX_NONE)
+	{
+		Root = Leaf;
+		Nodes[Root].Parent = INDEX_NONE;
+		return;
+	}
+
+	// ** Find the best sibling: walk down, at each node comparing the cost of pairing here with descending **
+
+	const FBox LeafBounds = Nodes[Leaf].Bounds;
+	int32 Index = Root;
+	while (!Nodes[Index].IsLeaf())
+	{
+		const FNode& Node = Nodes[Index];
+		const float Area = BoxArea(Node.Bounds);
+		const float CombinedArea = BoxArea(BoxUnion(Node.Bounds, LeafBounds));
+
+		// Cost of making a new parent for this node and the leaf
+		const float Cost = 2.f * CombinedArea;
+
+		// Minimum cost of pushing the leaf further down the tree
+		const float InheritanceCost = 2.f * (CombinedArea - Area);
+
+		float ChildCosts[2];
+		const int32 Children[2] = { Node.Child1, Node.Child2 };
+		for (int32 Child = 0; Child < 2; Child++)
+		{
+			const FNode& ChildNode = Nodes[Children[Child]];
+			const float ChildArea = BoxArea(BoxUnion(LeafBounds, ChildNode.Bounds));
+			ChildCosts[Child] = ChildNode.IsLeaf() ? (ChildArea + InheritanceCost) : (ChildArea - BoxArea(ChildNode.Bounds) + InheritanceCost);
+		}
+
+		if (Cost < ChildCosts[0] && Cost < ChildCosts[1])
+		{
+			break;
+		}
+		Index = (ChildCosts[0] < ChildCosts[1]) ? Children[0] : Children[1];
+	}
+
+	// ** Make a new parent for the sibling and the leaf **
+
+	const int32 Sibling = Index;
+	const int32 OldParent = Nodes[Sibling].Parent;
+	const int32 NewParent = AllocateNode();		// May reallocate Nodes
+
+	Nodes[NewParent].Parent = OldParent;
+	Nodes[NewParent].Bounds = BoxUnion(LeafBounds, Nodes[Sibling].Bounds);
+	Nodes[NewParent].Height = Nodes[Sibling].Height + 1;
+	Nodes[NewParent].Child1 = Sibling;
+	Nodes[NewParent].Child2 = Leaf;
+	Nodes[Sibling].Parent = NewParent;
+	Nodes[Leaf].Parent = NewParent;
+
+	if (OldParent == INDEX_NONE)
+	{
+		Root = NewParent;
+	}
+	else if (Nodes[OldParent].Child1 == Sibling)
+	{
+		Nodes[OldParent].Child1 = NewParent;
+	}
+	else
+	{
+		Nodes[OldParent].Child2 = NewParent;
+	}
+
+	// ** Walk back up, refitting and rebalancing **
+
+	Index = Nodes[Leaf].Parent;
+	while (Index != INDEX_NONE)
+	{
+		Index = Balance(Index);
+
+		FNode& Node = Nodes[Index];
+		Node.Height = 1 + FMath::Max(Nodes[Node.Child1].Height, Nodes[Node.Child2].Height);
+		Node.Bounds = BoxUnion(Nodes[Node.Child1].Bounds, Nodes[Node.Child2].Bounds);
+
+		Index = Node.Parent;
+	}
+}
+
+void FSpaceRocksTargetBVH::RemoveLeaf(int32 Leaf)
+{
+	if (Leaf == Root)
+	{
+		Root = INDEX_NONE;
+		return;
+	}
+
+	const int32 Parent = Nodes[Leaf].Parent;
+	const int32 GrandParent = Nodes[Parent].Parent;
+	const int32 Sibling = (Nodes[Parent].Child1 == Leaf) ? Nodes[Parent].Child2 : Nodes[Parent].Child1;
+
+	// The sibling takes the parent's place
+	if (GrandParent == INDEX_NONE)
+	{
+		Root = Sibling;
+		Nodes[Sibling].Parent = INDEX_NONE;
+		FreeNode(Parent);
+		return;
+	}
+
+	if (Nodes[GrandParent].Child1 == Parent)
+	{
+		Nodes[GrandParent].Child1 = Sibling;
+	}
+	else
+	{
+		Nodes[GrandParent].Child2 = Sibling;
+	}
+	Nodes[Sibling].Parent = GrandParent;
+	FreeNode(Parent);
+
+	int32 Index = GrandParent;
+	while (Index != INDEX_NONE)
+	{
+		Index = Balance(Index);
+
+		FNode& Node = Nodes[Index];
+		Node.Height = 1 + FMath::Max(Nodes[Node.Child1].Height, Nodes[Node.Child2].Height);
+		Node.Bounds = BoxUnion(Nodes[Node.Child1].Bounds, Nodes[Node.Child2].Bounds);
+
+		Index = Node.Parent;
+	}
+}
+
+int32 FSpaceRocksTargetBVH::Balance(int32 A)
+{
+	if (Nodes[A].IsLeaf() || Nodes[A].Height < 2)
+	{
+		return A;
+	}
+
+	const int32 B = Nodes[A].Child1;
+	const int32 C = Nodes[A].Child2;
+	const int32 HeightDiff = Nodes[C].Height - Nodes[B].Height;
+
+	if (HeightDiff > 1 || HeightDiff < -1)
+	{
+		// Promote the taller child (Up) in place of A. A takes the shorter of Up's children.
+		const int32 Up = (HeightDiff > 1) ? C : B;
+		const int32 Stay = (HeightDiff > 1) ? B : C;
+
+		const int32 F = Nodes[Up].Child1;
+		const int32 G = Nodes[Up].Child2;
+
+		// Swap A and Up
+		Nodes[Up].Child1 = A;
+		Nodes[Up].Parent = Nodes[A].Parent;
+		Nodes[A].Parent = Up;
+
+		if (Nodes[Up].Parent == INDEX_NONE)
+		{
+			Root = Up;
+		}
+		else if (Nodes[Nodes[Up].Parent].Child1 == A)
+		{
+			Nodes[Nodes[Up].Parent].Child1 = Up;
+		}
+		else
+		{
+			Nodes[Nodes[Up].Parent].Child2 = Up;
+		}
+
+		// Up keeps its taller child, A gets the other
+		const int32 Keep = (Nodes[F].Height > Nodes[G].Height) ? F : G;
+		const int32 Give = (Keep == F) ? G : F;
+
+		Nodes[Up].Child2 = Keep;
+		Nodes[A].Child1 = Stay;
+		Nodes[A].Child2 = Give;
+		Nodes[Give].Parent = A;
+
+		Nodes[A].Bounds = BoxUnion(Nodes[Stay].Bounds, Nodes[Give].Bounds);
+		Nodes[A].Height = 1 + FMath::Max(Nodes[Stay].Height, Nodes[Give].Height);
+		Nodes[Up].Bounds = BoxUnion(Nodes[A].Bounds, Nodes[Keep].Bounds);
+		Nodes[Up].Height = 1 + FMath::Max(Nodes[A].Height, Nodes[Keep].Height);
+
+		return Up;
+	}
+
+	return A;
+}
+
+bool FSpaceRocksTargetBVH::SphereMayTouchCone(const FSpaceRocksTargetCone& Cone, const FVector& Centre, float Radius)
+{
+	// Distance from the sphere's centre to the cone's surface is (Perp * cos - Along * sin).
+	// This underestimates behind the apex, so it never rejects anything that touches.
+	const FVector Offset = Centre - Cone.Origin;
+	const float Along = FVector::DotProduct(Offset, Cone.Direction);
+	const float Perp = FMath::Sqrt(FMath::Max(Offset.SizeSquared() - Along * Along, 0.f));
+	return (Perp * Cone.CosHalfAngle - Along * Cone.SinHalfAngle) <= Radius;
+}
+
+bool FSpaceRocksTargetBVH::SphereInCone(const FSpaceRocksTargetCone& Cone, const FVector& Centre, float Radius)
+{
+	const FVector Offset = Centre - Cone.Origin;
+	const float Along = FVector::DotProduct(Offset, Cone.Direction);
+	const float Perp = FMath::Sqrt(FMath::Max(Offset.SizeSquared() - Along * Along, 0.f));
+
+	// Behind the apex, where the closest point of the cone is the apex itself, only a sphere round the apex touches
+	if (Along * Cone.CosHalfAngle + Perp * Cone.SinHalfAngle < 0.f)
+	{
+		return Offset.SizeSquared() <= Radius * Radius;
+	}
+	return (Perp * Cone.CosHalfAngle - Along * Cone.SinHalfAngle) <= Radius;
+}
+
+bool FSpaceRocksTargetBVH::SphereInConeByAngle(const FSpaceRocksTargetCone& Cone, const FVector& Centre, float Radius)
+{
+	// The sphere covers asin(Radius / Distance) either side of its centre, as seen from the apex
+	const FVector Offset = Centre - Cone.Origin;
+	const float Distance = Offset.Size();
+	if (Distance <= Radius)
+	{
+		return true;
+	}
+	const float Angle = FMath::Acos(FMath::Clamp(FVector::DotProduct(Offset, Cone.Direction) / Distance, -1.f, 1.f));
+	const float HalfAngle = FMath::Atan2(Cone.SinHalfAngle, Cone.CosHalfAngle);
+	return Angle - FMath::Asin(Radius / Distance) <= HalfAngle;
+}
+
+float FSpaceRocksTargetBVH::RaySphere(const FSpaceRocksTargetRay& Ray, const FVector& Centre, float Radius)
+{
+	const FVector Offset = Centre - Ray.Origin;
+	const float Along = FVector::DotProduct(Offset, Ray.Direction);
+	const float PerpSquared = Offset.SizeSquared() - Along * Along;
+	const float RadiusSquared = Radius * Radius;
+	if (PerpSquared > RadiusSquared)
+	{
+		return -1.f;
+	}
+
+	// Half the length of the chord through the sphere
+	const float HalfChord = FMath::Sqrt(RadiusSquared - PerpSquared);
+	if (Along + HalfChord < 0.f)
+	{
+		return -1.f;	// Behind the origin
+	}
+	return FMath::Max(Along - HalfChord, 0.f);
+}
+
+void FSpaceRocksTargetBVH::AddHit(FSpaceRocksTargetHit* Hits, int32& NumHits, int32 MaxHits, const FSpaceRocksTargetHit& Hit)
+{
+	// Insertion into a short sorted list
+	int32 Slot = FMath::Min(NumHits, MaxHits - 1);
+	if (NumHits == MaxHits && Hit.Distance >= Hits[Slot].Distance)
+	{
+		return;
+	}
+	while (Slot > 0 && Hits[Slot - 1].Distance > Hit.Distance)
+	{
+		Hits[Slot] = Hits[Slot - 1];
+		Slot--;
+	}
+	Hits[Slot] = Hit;
+	NumHits = FMath::Min(NumHits + 1, MaxHits);
+}
+
+int32 FSpaceRocksTargetBVH::QueryCone(const FSpaceRocksTargetCone& Cone, FSpaceRocksTargetHit* OutHits, int32 MaxHits) const
+{
+	if (Root == INDEX_NONE || MaxHits <= 0)
+	{
+		return 0;
+	}
+
+	const float MaxRangeSquared = Cone.MaxRange * Cone.MaxRange;
+	int32 NumHits = 0;
+
+	// Depth first, nearer child first, so the k-th best distance shrinks quickly and prunes the rest
+	TArray<int32, TInlineAllocator<128> > Stack;
+	Stack.Add(Root);
+	while (Stack.Num() > 0)
+	{
+		const int32 Index = Stack.Pop(false);
+		const FNode& Node = Nodes[Index];
+
+		const float DistanceSquared = BoxDistanceSquared(Node.Bounds, Cone.Origin);
+		if (DistanceSquared > MaxRangeSquared)
+		{
+			continue;
+		}
+		if (NumHits == MaxHits && DistanceSquared >= FMath::Square(OutHits[NumHits - 1].Distance))
+		{
+			continue;
+		}
+
+		// Cone against the box's bounding sphere (cheap and conservative is all culling needs)
+		const FVector Centre = Node.Bounds.GetCenter();
+		if (!SphereMayTouchCone(Cone, Centre, (Node.Bounds.Max - Centre).Size()))
+		{
+			continue;
+		}
+
+		if (Node.IsLeaf())
+		{
+			if (Node.Actor != Cone.IgnoreActor || Node.Actor == NULL)
+			{
+				const float Distance = (Node.Centre - Cone.Origin).Size();
+				if (Distance <= Cone.MaxRange && SphereInCone(Cone, Node.Centre, Node.Radius))
+				{
+					FSpaceRocksTargetHit Hit;
+					Hit.Proxy = Index;
+					Hit.Actor = Node.Actor;
+					Hit.Distance = Distance;
+					AddHit(OutHits, NumHits, MaxHits, Hit);
+				}
+			}
+			continue;
+		}
+
+		// Push the farther child first, so the nearer is visited next
+		const bool bChild1Nearer = BoxDistanceSquared(Nodes[Node.Child1].Bounds, Cone.Origin) <= BoxDistanceSquared(Nodes[Node.Child2].Bounds, Cone.Origin);
+		Stack.Add(bChild1Nearer ? Node.Child2 : Node.Child1);
+		Stack.Add(bChild1Nearer ? Node.Child1 : Node.Child2);
+	}
+
+	return NumHits;
+}
+
+int32 FSpaceRocksTargetBVH::QueryConeExact(const FSpaceRocksTargetCone& Cone, FSpaceRocksTargetHit* OutHits, int32 MaxHits) const
+{
+	int32 NumHits = 0;
+	for (int32 Index = 0; Index < Nodes.Num() && MaxHits > 0; Index++)
+	{
+		const FNode& Node = Nodes[Index];
+		if (Node.Height != 0 || (Node.Actor == Cone.IgnoreActor && Node.Actor != NULL))
+		{
+			continue;
+		}
+
+		// A different formulation of the test to QueryCone's, so the two check each other
+		const float Distance = (Node.Centre - Cone.Origin).Size();
+		if (Distance <= Cone.MaxRange && SphereInConeByAngle(Cone, Node.Centre, Node.Radius))
+		{
+			FSpaceRocksTargetHit Hit;
+			Hit.Proxy = Index;
+			Hit.Actor = Node.Actor;
+			Hit.Distance = Distance;
+			AddHit(OutHits, NumHits, MaxHits, Hit);
+		}
+	}
+	return NumHits;
+}
+
+void FSpaceRocksTargetBVH::RayCastBatch(const FSpaceRocksTargetRay* Rays, int32 NumRays, FSpaceRocksTargetRayHit* OutHits) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpaceRocksTargetRayCast);
+
+	// Lists of the rays that reached each node on the stack, end to end. The first list is every ray.
+	TArray<int32, TInlineAllocator<256> > RayLists;
+	TArray<FVector, TInlineAllocator<64> > InvDirections;
+	RayLists.AddUninitialized(NumRays);
+	InvDirections.AddUninitialized(NumRays);
+	for (int32 Ray = 0; Ray < NumRays; Ray++)
+	{
+		FSpaceRocksTargetRayHit& Hit = OutHits[Ray];
+		Hit.Ray = Ray;
+		Hit.Proxy = INDEX_NONE;
+		Hit.Actor = NULL;
+		Hit.Distance = Rays[Ray].Length;
+
+		const FVector& Direction = Rays[Ray].Direction;
+		InvDirections[Ray] = FVector(SafeInverse(Direction.X), SafeInverse(Direction.Y), SafeInverse(Direction.Z));
+		RayLists[Ray] = Ray;
+	}
+
+	if (Root == INDEX_NONE || NumRays <= 0)
+	{
+		return;
+	}
+
+	// A node, and the list of rays that reached its parent
+	struct FEntry
+	{
+		int32 Node;
+		int32 First;
+		int32 Count;
+	};
+
+	TArray<FEntry, TInlineAllocator<128> > Stack;
+	const FEntry RootEntry = { Root, 0, NumRays };
+	Stack.Add(RootEntry);
+	while (Stack.Num() > 0)
+	{
+		const FEntry Entry = Stack.Pop(false);
+		const FNode& Node = Nodes[Entry.Node];
+
+		// Lists after this one belong to subtrees that are already done with
+		const int32 ListEnd = Entry.First + Entry.Count;
+		RayLists.RemoveAt(ListEnd, RayLists.Num() - ListEnd, false);
+
+		// ** Keep the rays that pass through this node's box before their nearest hit so far **
+
+		const int32 First = RayLists.Num();
+		for (int32 Index = Entry.First; Index < ListEnd; Index++)
+		{
+			const int32 Ray = RayLists[Index];
+			if (RayHitsBox(Node.Bounds, Rays[Ray].Origin, InvDirections[Ray], OutHits[Ray].Distance))
+			{
+				RayLists.Add(Ray);
+			}
+		}
+
+		const int32 Count = RayLists.Num() - First;
+		if (Count == 0)
+		{
+			continue;
+		}
+
+		// ** Leaves test the target's sphere exactly **
+
+		if (Node.IsLeaf())
+		{
+			for (int32 Index = First; Index < First + Count; Index++)
+			{
+				const int32 Ray = RayLists[Index];
+				if (Node.Actor == Rays[Ray].IgnoreActor && Node.Actor != NULL)
+				{
+					continue;
+				}
+
+				const float Distance = RaySphere(Rays[Ray], Node.Centre, Node.Radius);
+				if (Distance >= 0.f && Distance < OutHits[Ray].Distance)
+				{
+					OutHits[Ray].Proxy = Entry.Node;
+					OutHits[Ray].Actor = Node.Actor;
+					OutHits[Ray].Distance = Distance;
+				}
+			}
+			continue;
+		}
+
+		// Nearer child first (from the first ray still going - a blast's rays share an origin), so hits clip the rays early
+		const FVector& Origin = Rays[RayLists[First]].Origin;
+		const bool bChild1Nearer = BoxDistanceSquared(Nodes[Node.Child1].Bounds, Origin) <= BoxDistanceSquared(Nodes[Node.Child2].Bounds, Origin);
+		const FEntry Farther = { bChild1Nearer ? Node.Child2 : Node.Child1, First, Count };
+		const FEntry Nearer = { bChild1Nearer ? Node.Child1 : Node.Child2, First, Count };
+		Stack.Add(Farther);
+		Stack.Add(Nearer);
+	}
+}
+
+void FSpaceRocksTargetBVH::RayCastExact(const FSpaceRocksTargetRay* Rays, int32 NumRays, FSpaceRocksTargetRayHit* OutHits) const
+{
+	for (int32 Ray = 0; Ray < NumRays; Ray++)
+	{
+		FSpaceRocksTargetRayHit& Hit = OutHits[Ray];
+		Hit.Ray = Ray;
+		Hit.Proxy = INDEX_NONE;
+		Hit.Actor = NULL;
+		Hit.Distance = Rays[Ray].Length;
+
+		for (int32 Index = 0; Index < Nodes.Num(); Index++)
+		{
+			const FNode& Node = Nodes[Index];
+			if (Node.Height != 0 || (Node.Actor == Rays[Ray].IgnoreActor && Node.Actor != NULL))
+			{
+				continue;
+			}
+
+			const float Distance = RaySphere(Rays[Ray], Node.Centre, Node.Radius);
+			if (Distance >= 0.f && Distance < Hit.Distance)
+			{
+				Hit.Proxy = Index;
+				Hit.Actor = Node.Actor;
+				Hit.Distance = Distance;
+			}
+		}
+	}
+}
+
+void FSpaceRocksTargetBVH::RunBenchmark(int32 NumQueries, int32 MaxHits, float HalfAngleDegrees)
+{
+	const float ArenaSize = 100000.f;
+	const float DeltaSeconds = 1.f / 60.f;
+	const int32 NumFrames = 10;
+	MaxHits = FMath::Clamp(MaxHits, 1, 64);
+
+	UE_LOG(LogFlying, Display, TEXT("Targeting benchmark: %d queries of the %d nearest in a %.0f degree cone, %d frames of movement"),
+		NumQueries, MaxHits, HalfAngleDegrees * 2.f, NumFrames);
+
+	for (int32 NumTargets = 1000; NumTargets <= 100000; NumTargets *= 10)
+	{
+		FRandomStream Random(NumTargets);
+		TArray<FVector> Positions;
+		TArray<FVector> Velocities;
+		TArray<float> Radii;
+		for (int32 Index = 0; Index < NumTargets; Index++)
+		{
+			Positions.Add(FVector(Random.FRandRange(-ArenaSize, ArenaSize), Random.FRandRange(-ArenaSize, ArenaSize), Random.FRandRange(-ArenaSize, ArenaSize)));
+			Velocities.Add(Random.GetUnitVector() * Random.FRandRange(0.f, 1000.f));
+			Radii.Add(Random.FRandRange(100.f, 600.f));
+		}
+
+		// ** Build **
+
+		FSpaceRocksTargetBVH Tree;
+		TArray<int32> Proxies;
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < NumTargets; Index++)
+		{
+			Proxies.Add(Tree.CreateProxy(Positions[Index], Radii[Index], NULL));
+		}
+		const double BuildSeconds = FPlatformTime::Seconds() - StartTime;
+
+		// ** Refit, a frame at a time **
+
+		int32 NumReinserted = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			for (int32 Index = 0; Index < NumTargets; Index++)
+			{
+				const FVector Displacement = Velocities[Index] * DeltaSeconds;
+				Positions[Index] += Displacement;
+				NumReinserted += Tree.MoveProxy(Proxies[Index], Positions[Index], Radii[Index], Displacement) ? 1 : 0;
+			}
+		}
+		const double RefitSeconds = (FPlatformTime::Seconds() - StartTime) / NumFrames;
+
+		// ** Queries from random points in random directions, checked against brute force **
+
+		TArray<FSpaceRocksTargetCone> Cones;
+		for (int32 Query = 0; Query < NumQueries; Query++)
+		{
+			Cones.Add(FSpaceRocksTargetCone(FVector(Random.FRandRange(-ArenaSize, ArenaSize), Random.FRandRange(-ArenaSize, ArenaSize), Random.FRandRange(-ArenaSize, ArenaSize)),
+				Random.GetUnitVector(), HalfAngleDegrees, 50000.f));
+		}
+
+		FSpaceRocksTargetHit Hits[64];
+		FSpaceRocksTargetHit ExactHits[64];
+		int32 TotalHits = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Query = 0; Query < NumQueries; Query++)
+		{
+			TotalHits += Tree.QueryCone(Cones[Query], Hits, MaxHits);
+		}
+		const double QuerySeconds = (FPlatformTime::Seconds() - StartTime) / FMath::Max(NumQueries, 1);
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Query = 0; Query < NumQueries; Query++)
+		{
+			Tree.QueryConeExact(Cones[Query], ExactHits, MaxHits);
+		}
+		const double ExactSeconds = (FPlatformTime::Seconds() - StartTime) / FMath::Max(NumQueries, 1);
+
+		int32 NumMismatches = 0;
+		for (int32 Query = 0; Query < NumQueries; Query++)
+		{
+			const int32 NumHits = Tree.QueryCone(Cones[Query], Hits, MaxHits);
+			const int32 NumExact = Tree.QueryConeExact(Cones[Query], ExactHits, MaxHits);
+			bool bMatch = (NumHits == NumExact);
+			for (int32 Hit = 0; Hit < NumHits && bMatch; Hit++)
+			{
+				bMatch = FMath::IsNearlyEqual(Hits[Hit].Distance, ExactHits[Hit].Distance, 0.01f);
+			}
+			NumMismatches += bMatch ? 0 : 1;
+		}
+
+		UE_LOG(LogFlying, Display, TEXT("  %6d targets: height %d, build %.3f ms, refit %.3f ms/frame (%.1f%% reinserted), query %.2f us (%.1f hits), brute force %.2f us, mismatches %d"),
+			NumTargets, Tree.GetHeight(), BuildSeconds * 1000.0, RefitSeconds * 1000.0,
+			100.0 * NumReinserted / ((double)NumTargets * NumFrames), QuerySeconds * 1000000.0, (double)TotalHits / FMath::Max(NumQueries, 1),
+			ExactSeconds * 1000000.0, NumMismatches);
+	}
+}
+
+void FSpaceRocksTargetBVH::RunRayBenchmark(int32 NumBlasts, int32 RaysPerBlast)
+{
+	const float ArenaSize = 100000.f;
+	const float Range = 50000.f;
+	NumBlasts = FMath::Max(NumBlasts, 1);
+	RaysPerBlast = FMath::Clamp(RaysPerBlast, 1, 256);
+
+	UE_LOG(LogFlying, Display, TEXT("Ray benchmark: %d blasts of %d rays, %.0f range"), NumBlasts, RaysPerBlast, Range);
+
+	for (int32 NumTargets = 1000; NumTargets <= 100000; NumTargets *= 10)
+	{
+		FRandomStream Random(NumTargets);
+		FSpaceRocksTargetBVH Tree;
+		for (int32 Index = 0; Index < NumTargets; Index++)
+		{
+			Tree.CreateProxy(FVector(Random.FRandRange(-ArenaSize, ArenaSize), Random.FRandRange(-ArenaSize, ArenaSize), Random.FRandRange(-ArenaSize, ArenaSize)),
+				Random.FRandRange(100.f, 600.f), NULL);
+		}
+
+		// ** Blasts from random points in random directions, each a few degrees wide **
+
+		TArray<FSpaceRocksTargetRay> Rays;
+		for (int32 Blast = 0; Blast < NumBlasts; Blast++)
+		{
+			const FVector Origin(Random.FRandRange(-ArenaSize, ArenaSize), Random.FRandRange(-ArenaSize, ArenaSize), Random.FRandRange(-ArenaSize, ArenaSize));
+			const FVector Direction = Random.GetUnitVector();
+			for (int32 Ray = 0; Ray < RaysPerBlast; Ray++)
+			{
+				new(Rays) FSpaceRocksTargetRay(Origin, Direction + Random.GetUnitVector() * 0.1f, Range);
+			}
+		}
+
+		TArray<FSpaceRocksTargetRayHit> Hits;
+		TArray<FSpaceRocksTargetRayHit> SingleHits;
+		TArray<FSpaceRocksTargetRayHit> ExactHits;
+		Hits.AddUninitialized(Rays.Num());
+		SingleHits.AddUninitialized(Rays.Num());
+		ExactHits.AddUninitialized(Rays.Num());
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Blast = 0; Blast < NumBlasts; Blast++)
+		{
+			Tree.RayCastBatch(&Rays[Blast * RaysPerBlast], RaysPerBlast, &Hits[Blast * RaysPerBlast]);
+		}
+		const double BatchSeconds = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Ray = 0; Ray < Rays.Num(); Ray++)
+		{
+			Tree.RayCastBatch(&Rays[Ray], 1, &SingleHits[Ray]);
+		}
+		const double SingleSeconds = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		Tree.RayCastExact(Rays.GetData(), Rays.Num(), ExactHits.GetData());
+		const double ExactSeconds = FPlatformTime::Seconds() - StartTime;
+
+		int32 NumHits = 0;
+		int32 NumMismatches = 0;
+		for (int32 Ray = 0; Ray < Rays.Num(); Ray++)
+		{
+			NumHits += (Hits[Ray].Proxy != INDEX_NONE) ? 1 : 0;
+			// Same target, or a tie at the same distance
+			const bool bMatch = (Hits[Ray].Proxy == ExactHits[Ray].Proxy || FMath::IsNearlyEqual(Hits[Ray].Distance, ExactHits[Ray].Distance, 0.01f))
+				&& (SingleHits[Ray].Proxy == ExactHits[Ray].Proxy || FMath::IsNearlyEqual(SingleHits[Ray].Distance, ExactHits[Ray].Distance, 0.01f));
+			NumMismatches += bMatch ? 0 : 1;
+		}
+
+		UE_LOG(LogFlying, Display, TEXT("  %6d targets: batched %.3f ms, one ray at a time %.3f ms, brute force %.3f ms, %.1f%% of rays hit, mismatches %d"),
+			NumTargets, BatchSeconds * 1000.0, SingleSeconds * 1000.0, ExactSeconds * 1000.0, 100.0 * NumHits / Rays.Num(), NumMismatches);
+	}
+}
@@ -0,0 +1,115 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksTrace.h"
+
+// File header: magic, version, number of threads. Then per thread: thread id, game thread flag, event count, events.
+static const uint32 TraceFileMagic = 0x52545253;	// 'SRTR'
+static const uint32 TraceFileVersion = 1;
+
+static_assert(sizeof(FSpaceRocksTraceEvent) == 32, "Trace file layout expects 32 byte events");
+
+bool FSpaceRocksTrace::bEnabled = false;
+uint32 FSpaceRocksTrace::TlsSlot = 0;
+
+// Every thread's buffer, for Flush(). Buffers live as long as the process (threads can exit before a flush).
+// Plain statics rather than function-local ones, which VS2013 doesn't initialize thread-safely.
+static TArray<FSpaceRocksTraceBuffer*> TraceBuffers;
+static FCriticalSection TraceBuffersLock;
+
+FSpaceRocksTraceBuffer::FSpaceRocksTraceBuffer(uint32 InThreadId, bool bInGameThread, int32 CapacityLog2)
+	: ThreadId(InThreadId)
+	, bGameThread(bInGameThread)
+	, Mask((1 << CapacityLog2) - 1)
+	, WriteIndex(0)
+{
+	Events.AddZeroed(1 << CapacityLog2);
+}
+
+void FSpaceRocksTraceBuffer::Snapshot(TArray<FSpaceRocksTraceEvent>& OutEvents) const
+{
+	const int64 Capacity = Mask + 1;
+
+	const int64 End = WriteIndex;
+	FPlatformMisc::MemoryBarrier();
+	const int64 Begin = FMath::Max<int64>(End - Capacity, 0);
+
+	OutEvents.Reset();
+	for (int64 Index = Begin; Index < End; Index++)
+	{
+		OutEvents.Add(Events[(int32)(Index & Mask)]);
+	}
+
+	// Anything the writer has lapped since we started may be torn, so drop it
+	FPlatformMisc::MemoryBarrier();
+	const int64 FirstIntact = WriteIndex - Capacity + 1;
+	if (FirstIntact > Begin)
+	{
+		OutEvents.RemoveAt(0, (int32)FMath::Min<int64>(FirstIntact - Begin, OutEvents.Num()));
+	}
+}
+
+void FSpaceRocksTrace::Startup()
+{
+	TlsSlot = FPlatformTLS::AllocTlsSlot();
+	bEnabled = true;
+}
+
+FSpaceRocksTraceBuffer* FSpaceRocksTrace::GetThreadBuffer()
+{
+	FSpaceRocksTraceBuffer* Buffer = (FSpaceRocksTraceBuffer*)FPlatformTLS::GetTlsValue(TlsSlot);
+	if (Buffer == NULL)
+	{
+		Buffer = new FSpaceRocksTraceBuffer(FPlatformTLS::GetCurrentThreadId(), IsInGameThread(), BufferSizeLog2);
+		FPlatformTLS::SetTlsValue(TlsSlot, Buffer);
+
+		FScopeLock Lock(&TraceBuffersLock);
+		TraceBuffers.Add(Buffer);
+	}
+	return Buffer;
+}
+
+FString FSpaceRocksTrace::GetDefaultFilename()
+{
+	return FPaths::GameSavedDir() / TEXT("Traces") / FString::Printf(TEXT("Trace_%s.srtrace"), *FDateTime::Now().ToString());
+}
+
+int32 FSpaceRocksTrace::Flush(const FString& Filename)
+{
+	TArray<FSpaceRocksTraceBuffer*> Buffers;
+	{
+		FScopeLock Lock(&TraceBuffersLock);
+		Buffers = TraceBuffers;
+	}
+
+	FArchive* const Ar = IFileManager::Get().CreateFileWriter(*Filename);
+	if (Ar == NULL)
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Trace: couldn't write %s"), *Filename);
+		return -1;
+	}
+
+	uint32 Magic = TraceFileMagic;
+	uint32 Version = TraceFileVersion;
+	int32 NumThreads = Buffers.Num();
+	*Ar << Magic << Version << NumThreads;
+
+	int32 NumEvents = 0;
+	TArray<FSpaceRocksTraceEvent> Events;
+	for (int32 Index = 0; Index < Buffers.Num(); Index++)
+	{
+		Buffers[Index]->Snapshot(Events);
+
+		uint32 ThreadId = Buffers[Index]->ThreadId;
+		uint32 bGameThread = Buffers[Index]->bGameThread ? 1 : 0;
+		int32 NumThreadEvents = Events.Num();
+		*Ar << ThreadId << bGameThread << NumThreadEvents;
+
+		// The event layout is fixed (see FSpaceRocksTraceEvent), so write them out in one go
+		Ar->Serialize(Events.GetData(), Events.Num() * sizeof(FSpaceRocksTraceEvent));
+		NumEvents += Events.Num();
+	}
+
+	delete Ar;
+	return NumEvents;
+}
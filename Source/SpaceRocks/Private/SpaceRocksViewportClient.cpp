@@ -0,0 +1,22 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksViewportClient.h"
+#include "SpaceRocksInputLatency.h"
+
+USpaceRocksViewportClient::USpaceRocksViewportClient(const class FPostConstructInitializeProperties& PCIP)
+	: Super(PCIP)
+{
+}
+
+bool USpaceRocksViewportClient::InputKey(FViewport* InViewport, int32 ControllerId, FKey Key, EInputEvent EventType, float AmountDepressed, bool bGamepad)
+{
+	FSpaceRocksInputLatency::NoteArrival(ControllerId);
+	return Super::InputKey(InViewport, ControllerId, Key, EventType, AmountDepressed, bGamepad);
+}
+
+bool USpaceRocksViewportClient::InputAxis(FViewport* InViewport, int32 ControllerId, FKey Key, float Delta, float DeltaTime, int32 NumSamples, bool bGamepad)
+{
+	FSpaceRocksInputLatency::NoteArrival(ControllerId);
+	return Super::InputAxis(InViewport, ControllerId, Key, Delta, DeltaTime, NumSamples, bGamepad);
+}
@@ -0,0 +1,55 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksViews.h"
+
+void FSpaceRocksViewSet::Gather(UWorld* World)
+{
+	Views.Reset();
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* const PC = *It;
+		const ULocalPlayer* const LocalPlayer = PC ? Cast<ULocalPlayer>(PC->Player) : NULL;
+		if (LocalPlayer == NULL || PC->PlayerCameraManager == NULL)
+		{
+			continue;
+		}
+
+		// Some slack for the aspect ratio
+		const float HalfFOV = FMath::Min(PC->PlayerCameraManager->GetFOVAngle() * 0.5f + 10.f, 90.f);
+
+		FSpaceRocksView View;
+		View.Location = PC->PlayerCameraManager->GetCameraLocation();
+		View.Forward = PC->PlayerCameraManager->GetCameraRotation().Vector();
+		View.CosHalfFOV = FMath::Cos(FMath::DegreesToRadians(HalfFOV));
+		View.SinHalfFOV = FMath::Sin(FMath::DegreesToRadians(HalfFOV));
+		View.PlayerIndex = GEngine->GetGamePlayers(World).Find(const_cast<ULocalPlayer*>(LocalPlayer));
+		Views.Add(View);
+	}
+}
+
+bool FSpaceRocksViewSet::IsVisible(const FVector& Centre, float Radius, float CullDistance, float& OutDistance) const
+{
+	if (Views.Num() == 0)
+	{
+		OutDistance = Centre.Size();
+		return OutDistance - Radius < CullDistance;
+	}
+
+	bool bVisible = false;
+	OutDistance = MAX_FLT;
+	for (int32 Index = 0; Index < Views.Num(); Index++)
+	{
+		const FSpaceRocksView& View = Views[Index];
+		const FVector Offset = Centre - View.Location;
+		const float Distance = Offset.Size();
+		OutDistance = FMath::Min(OutDistance, Distance);
+
+		// Sphere against the view cone (see FSpaceRocksTargetBVH::SphereInCone)
+		const float Along = FVector::DotProduct(Offset, View.Forward);
+		const float Perp = FMath::Sqrt(FMath::Max(Distance * Distance - Along * Along, 0.f));
+		bVisible |= (Distance - Radius < CullDistance) && (Perp * View.CosHalfFOV - Along * View.SinHalfFOV <= Radius);
+	}
+	return bVisible;
+}
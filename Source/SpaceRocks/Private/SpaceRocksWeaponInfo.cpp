@@ -0,0 +1,114 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+
+#include "SpaceRocks.h"
+#include "SpaceRocksWeaponInfo.h"
+
+static FSpaceRocksWeaponDef MakeWeaponDef(const FSpaceRocksWeaponRow& Row, UClass* DefaultProjectileClass)
+{
+	FSpaceRocksWeaponDef Def;
+	Def.FireRate = FMath::Max(Row.FireRate, 0.f);
+	Def.Damage = Row.Damage;
+	Def.ProjectileSpeed = Row.ProjectileSpeed;
+	Def.StartAmmo = Row.StartAmmo;
+	Def.AmmoPerPickup = Row.AmmoPerPickup;
+	Def.MaxAmmo = Row.MaxAmmo;
+	Def.FireMount = Row.FireMount;
+	Def.ProjectileClass = *Row.ProjectileClass ? *Row.ProjectileClass : DefaultProjectileClass;
+	Def.HomingAcceleration = FMath::Max(Row.HomingAcceleration, 0.f);
+	Def.HitscanRays = FMath::Clamp(Row.HitscanRays, 0, MAX_HITSCAN_RAYS);
+	Def.HitscanSpread = FMath::Clamp(Row.HitscanSpread, 0.f, 45.f);
+	Def.HitscanRange = FMath::Max(Row.HitscanRange, 0.f);
+	return Def;
+}
+
+FSpaceRocksWeaponInfo::FSpaceRocksWeaponInfo()
+{
+	Compile(NULL, NULL);
+}
+
+void FSpaceRocksWeaponInfo::Compile(const UDataTable* WeaponTable, UClass* DefaultProjectileClass)
+{
+	// ** Built-in defaults, so the craft can always fire something even without a table **
+
+	FSpaceRocksWeaponRow Empty;
+	Empty.WeaponID = ESpaceRocksWeapon::EMPTY;
+	Empty.FireRate = 0.f;
+	Empty.Damage = 0.f;
+	Empty.StartAmmo = 0;
+
+	FSpaceRocksWeaponRow Phaseoid;
+	Phaseoid.WeaponID = ESpaceRocksWeapon::PHASEOID;
+	Phaseoid.FireRate = 0.25f;
+	Phaseoid.Damage = 25.f;
+
+	FSpaceRocksWeaponRow Pulser;
+	Pulser.WeaponID = ESpaceRocksWeapon::PULSER;
+	Pulser.FireRate = 0.1f;
+	Pulser.Damage = 10.f;
+	Pulser.StartAmmo = 200;
+	Pulser.AmmoPerPickup = 100;
+	Pulser.MaxAmmo = 500;
+	Pulser.FireMount = ESpaceRocksFireMount::MidWings;
+
+	// Continuous beam
+	FSpaceRocksWeaponRow Beam;
+	Beam.WeaponID = ESpaceRocksWeapon::BEAM;
+	Beam.FireRate = 0.f;
+	Beam.Damage = 60.f;
+	Beam.FireMount = ESpaceRocksFireMount::MidWings;
+	Beam.HitscanRays = 2;
+	Beam.HitscanRange = 15000.f;
+
+	// Shotgun
+	FSpaceRocksWeaponRow Scatter;
+	Scatter.WeaponID = ESpaceRocksWeapon::SCATTER;
+	Scatter.FireRate = 0.8f;
+	Scatter.Damage = 8.f;
+	Scatter.StartAmmo = 20;
+	Scatter.AmmoPerPickup = 10;
+	Scatter.MaxAmmo = 40;
+	Scatter.FireMount = ESpaceRocksFireMount::MidWings;
+	Scatter.HitscanRays = 24;
+	Scatter.HitscanSpread = 6.f;
+	Scatter.HitscanRange = 8000.f;
+
+	Defs.Reset();
+	Defs.AddZeroed(ESpaceRocksWeapon::NUM_WEAPONS);
+	Defs[ESpaceRocksWeapon::EMPTY] = MakeWeaponDef(Empty, NULL);
+	Defs[ESpaceRocksWeapon::PHASEOID] = MakeWeaponDef(Phaseoid, DefaultProjectileClass);
+	Defs[ESpaceRocksWeapon::PULSER] = MakeWeaponDef(Pulser, DefaultProjectileClass);
+	Defs[ESpaceRocksWeapon::BEAM] = MakeWeaponDef(Beam, DefaultProjectileClass);
+	Defs[ESpaceRocksWeapon::SCATTER] = MakeWeaponDef(Scatter, DefaultProjectileClass);
+
+	if (WeaponTable == NULL)
+	{
+		return;
+	}
+
+	if (WeaponTable->RowStruct == NULL || !WeaponTable->RowStruct->IsChildOf(FSpaceRocksWeaponRow::StaticStruct()))
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Weapon table %s does not use FSpaceRocksWeaponRow, using default weapons"), *WeaponTable->GetName());
+		return;
+	}
+
+	// ** Now overlay the table rows, growing the flat array to fit the highest weapon ID **
+
+	for (auto It = WeaponTable->RowMap.CreateConstIterator(); It; ++It)
+	{
+		const FSpaceRocksWeaponRow* Row = reinterpret_cast<const FSpaceRocksWeaponRow*>(It.Value());
+		// Inventory slots hold weapon IDs as uint8, so anything bigger would alias another weapon (and grow the table for nothing)
+		if (Row == NULL || Row->WeaponID <= ESpaceRocksWeapon::EMPTY || Row->WeaponID > MAX_uint8)
+		{
+			UE_LOG(LogFlying, Warning, TEXT("Weapon table %s: row %s has an invalid WeaponID"), *WeaponTable->GetName(), *It.Key().ToString());
+			continue;
+		}
+
+		if (Row->WeaponID >= Defs.Num())
+		{
+			Defs.AddZeroed(Row->WeaponID + 1 - Defs.Num());
+		}
+		Defs[Row->WeaponID] = MakeWeaponDef(*Row, DefaultProjectileClass);
+	}
+
+	Defs.Shrink();
+}
@@ -8,4 +8,6 @@
 
 DECLARE_LOG_CATEGORY_EXTERN(LogFlying, Log, All);
 
+DECLARE_STATS_GROUP(TEXT("SpaceRocks"), STATGROUP_SpaceRocks, STATCAT_Advanced);
+
 #endif
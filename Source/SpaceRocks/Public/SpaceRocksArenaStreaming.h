@@ -0,0 +1,64 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+/**
+ * Switches between arenas, each a streaming sublevel of the persistent level (set to the Blueprint streaming
+ * method in the level browser, so nothing loads them but us).
+ *
+ * The next arena is preloaded in the background, without being made visible. Activating it makes it visible
+ * (the engine adds its actors to the world over as many frames as its time limit needs), and once it is visible
+ * the previous arena is hidden and unloaded (only hidden, if it has been preloaded as the next arena). How long
+ * loading and activation took, and the worst frame seen during each, are logged against FrameBudgetMs.
+ */
+class SPACEROCKS_API FSpaceRocksArenaStreaming
+{
+public:
+	FSpaceRocksArenaStreaming();
+
+	// Start loading an arena in the background, without showing it. False if the world has no such streaming level.
+	// Preloading the arena being switched away from keeps it loaded (just hidden) rather than unloading it.
+	bool Preload(UWorld* World, FName ArenaName);
+
+	// Show an arena (loading it first if it hasn't been preloaded), then unload the current one once it's visible
+	bool Activate(UWorld* World, FName ArenaName);
+
+	// Follow loads and activations, and log their timings. Call every frame.
+	void Tick(UWorld* World, float DeltaSeconds);
+
+	// Arena currently shown (or being switched to)
+	FName GetActiveArena() const { return ActiveArena; }
+
+	// Is an arena still loading or being made visible?
+	bool IsBusy() const { return Requests.Num() > 0; }
+
+	// Frames longer than this while loading or activating are logged as warnings
+	float FrameBudgetMs;
+
+private:
+
+	// An arena being loaded and/or activated
+	struct FArenaRequest
+	{
+		FName ArenaName;
+		double RequestTime;
+		double LoadedTime;		// 0 until loaded
+		double ActivateTime;	// 0 until activation is asked for
+		int32 ActivationFrames;
+		float WorstLoadFrameMs;
+		float WorstActivationFrameMs;
+	};
+
+	// The world's streaming level for an arena (by package name, with or without the path)
+	static class ULevelStreaming* FindStreamingLevel(UWorld* World, FName ArenaName);
+
+	FArenaRequest* FindRequest(FName ArenaName);
+	FArenaRequest& AddRequest(FName ArenaName);
+
+	TArray<FArenaRequest> Requests;
+
+	FName ActiveArena;
+
+	// Arena to hide once ActiveArena is visible, and unload unless it was preloaded again in the meantime
+	FName PreviousArena;
+	bool bKeepPreviousArena;
+};
@@ -0,0 +1,146 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "Components/SceneComponent.h"
+#include "SpaceRocksBeltComponent.generated.h"
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Belt Cull"), STAT_SpaceRocksBeltCull, STATGROUP_SpaceRocks, SPACEROCKS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Belt Animate"), STAT_SpaceRocksBeltAnimate, STATGROUP_SpaceRocks, SPACEROCKS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Belt Push"), STAT_SpaceRocksBeltPush, STATGROUP_SpaceRocks, SPACEROCKS_API);
+
+/**
+ * Dense decorative asteroid belt (a ring round the component's Z axis) for the skybox scenes.
+ *
+ * Instances are split into spatial clusters, each drawn by its own instanced static mesh component, so
+ * whole clusters can be culled on the CPU by distance and view cone. Visible clusters spin and drift
+ * their instances on the task graph; clusters near the camera are updated every frame and the rest
+ * round-robin every few frames. Only the clusters that were updated are pushed to the renderer, but each
+ * of those has its render proxy rebuilt in full (the instanced component has no partial update), so
+ * the push costs in proportion to the instances in updated clusters - ClusterSize and FarUpdateInterval
+ * trade it off. The belt has no collision and doesn't touch gameplay.
+ */
+UCLASS(ClassGroup = SpaceRocks, config = Game, meta = (BlueprintSpawnableComponent))
+class SPACEROCKS_API USpaceRocksBeltComponent : public USceneComponent
+{
+public:
+	GENERATED_UCLASS_BODY()
+
+	// Mesh for the belt's rocks
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		class UStaticMesh* BeltMesh;
+
+	// Number of rocks in the belt
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		int32 NumInstances;
+
+	// Seed for placing the rocks
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		int32 Seed;
+
+	// Inner and outer radius of the ring
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		float InnerRadius;
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		float OuterRadius;
+
+	// Thickness of the ring (along Z)
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		float Thickness;
+
+	// Scale range of the rocks
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		float MinScale;
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		float MaxScale;
+
+	// Size of a cluster cell (in the ring's plane)
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		float ClusterSize;
+
+	// Most spin, degrees per second
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		float MaxSpinRate;
+
+	// How far rocks drift from their home position
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		float DriftDistance;
+
+	// Clusters further than this from the camera aren't drawn
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		float CullDistance;
+
+	// Clusters nearer than this are animated every frame, the rest every FarUpdateInterval frames
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		float NearDistance;
+	UPROPERTY(Category = SpaceRocksBelt, EditAnywhere)
+		int32 FarUpdateInterval;
+
+	// Instanced component for each cluster
+	UPROPERTY(Transient)
+		TArray<class UInstancedStaticMeshComponent*> ClusterComponents;
+
+	// Begin UActorComponent overrides
+	virtual void InitializeComponent() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End UActorComponent overrides
+
+	// Log cluster counts and average game thread costs
+	void LogStats() const;
+
+protected:
+
+	// One rock's home position and motion, in component space
+	struct FBeltInstance
+	{
+		FVector Home;
+		FVector DriftAxis;
+		FVector SpinAxis;
+		float SpinRate;		// Radians per second
+		float Phase;
+		float Scale;
+	};
+
+	struct FBeltCluster
+	{
+		FVector Centre;		// Component space
+		float Radius;		// Bounds of everything in the cluster (including drift)
+		int32 FirstInstance;
+		int32 NumInstances;
+		bool bVisible;
+		class UInstancedStaticMeshComponent* Instances;
+	};
+
+	// Place the rocks and make the cluster components
+	void BuildBelt();
+
+	// Write the cluster's instance transforms at time Time
+	void AnimateCluster(FBeltCluster& Cluster, float Time) const;
+
+	TArray<FBeltInstance> BeltInstances;	// Sorted by cluster
+	TArray<FBeltCluster> Clusters;
+
+	// Clusters to update this frame (scratch)
+	TArray<int32> UpdateList;
+
+	float BeltTime;
+	uint32 FrameCounter;
+
+	// Running stats
+	int32 NumVisibleClusters;
+	int32 NumInstancesPushed;
+	float AverageCullMs;
+	float AverageAnimateMs;
+	float AveragePushMs;
+};
+
+/**
+ * Actor holding a belt, for dropping into a level.
+ */
+UCLASS()
+class SPACEROCKS_API ASpaceRocksBelt : public AActor
+{
+public:
+	GENERATED_UCLASS_BODY()
+
+	UPROPERTY(Category = SpaceRocksBelt, VisibleAnywhere, BlueprintReadOnly)
+		TSubobjectPtr<USpaceRocksBeltComponent> Belt;
+};
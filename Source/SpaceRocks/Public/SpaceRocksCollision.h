@@ -0,0 +1,162 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+/**
+ * SpaceRocks collision channels and profiles. They are set up in [/Script/Engine.CollisionProfile] in
+ * DefaultEngine.ini - the channel numbers and profile names here must match it.
+ *
+ * Each profile's response to each object type, and to the Aim trace (B = block, O = overlap, - = ignore):
+ *
+ *                 WorldStatic  WorldDynamic  Pawn  Rock  Projectile  Pickup  Craft  Arena  |  Aim
+ *   Rock               B            B         B     B        B         -       B      B    |   B
+ *   Projectile         B            B         B     B        -         -       B      B    |   -
+ *   Pickup             -            -         O     -        -         -       O      -    |   -
+ *   Craft              B            B         B     B        B         O       B      B    |   B
+ *   Arena              B            B         B     B        B         -       B      B    |   B
+ *
+ * Arena is applied to the static meshes of the persistent level and of each arena as it is shown (ApplyToArena).
+ * Projectiles and pickups are query only, never pair with each other or themselves, and pickups only
+ * overlap craft. Query-only rocks (ESpaceRocksCollisionMode::QueryOnlyRocks) don't simulate at all, so
+ * they make no physics pairs - they still block projectiles, craft sweeps, the Aim trace and hitscan rays.
+ */
+#define COLLISION_ROCK			ECC_GameTraceChannel1
+#define COLLISION_PROJECTILE	ECC_GameTraceChannel2
+#define COLLISION_PICKUP		ECC_GameTraceChannel3
+#define COLLISION_CRAFT			ECC_GameTraceChannel4
+#define COLLISION_ARENA			ECC_GameTraceChannel5
+#define COLLISION_AIM			ECC_GameTraceChannel6	// Trace channel for the crosshair
+
+// How rocks, projectiles and craft collide
+namespace ESpaceRocksCollisionMode
+{
+	enum Type
+	{
+		Legacy,				// The engine's default profiles, as before the SpaceRocks channels. Only for comparing against.
+		Channels,			// SpaceRocks profiles, and rocks simulate (they bounce off each other)
+		QueryOnlyRocks,		// SpaceRocks profiles, and rocks are kinematic and query only (they pass through each other)
+		NUM_MODES
+	};
+}
+
+class SPACEROCKS_API FSpaceRocksCollision
+{
+public:
+
+	// Profile names
+	static const FName RockProfile;
+	static const FName ProjectileProfile;
+	static const FName PickupProfile;
+	static const FName CraftProfile;
+	static const FName ArenaProfile;
+
+	static const TCHAR* GetModeName(ESpaceRocksCollisionMode::Type Mode);
+
+	// Set up a rock, projectile or craft to collide the way a mode says
+	static void ApplyToRock(class ASpaceRocksRock* Rock, ESpaceRocksCollisionMode::Type Mode);
+	static void ApplyToProjectile(class ASpaceRocksProjectile* Projectile, ESpaceRocksCollisionMode::Type Mode);
+	static void ApplyToCraft(class ASpaceRocksPawn* Pawn, ESpaceRocksCollisionMode::Type Mode);
+
+	// Give a level's static geometry the Arena object type: every static mesh component with Static mobility that
+	// collides as WorldStatic. Triggers, no-collision meshes and BSP are left alone. Returns the number changed.
+	static int32 ApplyToArena(class ULevel* Level);
+};
+
+// The physics step of one frame
+struct FSpaceRocksPhysicsFrame
+{
+	// Game thread wall time from the simulation being kicked off (TG_StartPhysics) to its results being fetched
+	// (TG_EndPhysics). Not the simulation time: it includes TG_DuringPhysics work (or the game thread waiting for
+	// the simulation, if that finishes later), so only compare it between runs with the same DuringPhysics work.
+	float KickoffToFetchMs;
+	int32 ContactPairs;		// Shape pairs that got through the broadphase and filtering to the narrowphase
+	int32 TouchingPairs;	// Of those, pairs that were touching
+	int32 NewPairs;			// Pairs the broadphase found this frame
+	int32 DynamicBodies;	// Simulated (not kinematic) bodies in the scene
+
+	FSpaceRocksPhysicsFrame()
+		: KickoffToFetchMs(0.f)
+		, ContactPairs(0)
+		, TouchingPairs(0)
+		, NewPairs(0)
+		, DynamicBodies(0)
+	{
+	}
+};
+
+/**
+ * Measures each frame's physics step: its kickoff to fetch time, from two tick functions either side of the physics tick
+ * groups, and its pair counts, from the PhysX scene's simulation statistics once the step has been fetched.
+ */
+class SPACEROCKS_API FSpaceRocksPhysicsStats
+{
+public:
+	FSpaceRocksPhysicsStats();
+
+	void Register(UWorld* InWorld);
+	void Unregister();
+
+	// The last frame whose physics step has finished
+	const FSpaceRocksPhysicsFrame& GetLastFrame() const { return LastFrame; }
+
+	// Frames measured since registering
+	int32 GetNumFrames() const { return NumFrames; }
+
+private:
+
+	struct FTimerTickFunction : public FTickFunction
+	{
+		FSpaceRocksPhysicsStats* Stats;
+		bool bEnd;
+
+		virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+		virtual FString DiagnosticMessage() override;
+	};
+
+	void OnStartPhysics();
+	void OnEndPhysics();
+
+	FTimerTickFunction StartTick;
+	FTimerTickFunction EndTick;
+
+	UWorld* World;
+	double StartTime;
+	FSpaceRocksPhysicsFrame LastFrame;
+	int32 NumFrames;
+};
+
+/**
+ * Runs the game in each collision mode in turn for a number of frames, then logs each mode's average physics
+ * time and pair counts side by side. The game state does the switching, when Update says so.
+ */
+class SPACEROCKS_API FSpaceRocksCollisionBench
+{
+public:
+	FSpaceRocksCollisionBench();
+
+	// Start the benchmark. Returns the mode to switch to first.
+	ESpaceRocksCollisionMode::Type Start(int32 InFramesPerMode);
+
+	bool IsRunning() const { return FramesPerMode > 0; }
+
+	// Call once a frame with the last finished physics step. Returns true when it is time to switch to OutMode,
+	// or (once it has finished and logged the results) back to the game's own mode.
+	bool Update(const FSpaceRocksPhysicsFrame& LastFrame, ESpaceRocksCollisionMode::Type& OutMode);
+
+private:
+
+	// Frames skipped after each switch, while bodies are recreated and the broadphase finds its pairs again
+	enum { SETTLE_FRAMES = 10 };
+
+	void LogResults() const;
+
+	int32 FramesPerMode;	// 0 when not running
+	int32 Mode;
+	int32 Frame;			// Negative while settling
+
+	// Sums over each mode's frames
+	double KickoffToFetchMs[ESpaceRocksCollisionMode::NUM_MODES];
+	double ContactPairs[ESpaceRocksCollisionMode::NUM_MODES];
+	double TouchingPairs[ESpaceRocksCollisionMode::NUM_MODES];
+	double NewPairs[ESpaceRocksCollisionMode::NUM_MODES];
+	double DynamicBodies[ESpaceRocksCollisionMode::NUM_MODES];
+};
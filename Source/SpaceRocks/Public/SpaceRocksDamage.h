@@ -0,0 +1,57 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Damage Resolve"), STAT_SpaceRocksDamageResolve, STATGROUP_SpaceRocks, SPACEROCKS_API);
+
+// One hit, queued by the hit callback. Weak, as the target can be destroyed (and collected) before the queue is resolved.
+struct FSpaceRocksDamageEvent
+{
+	TWeakObjectPtr<AActor> Target;
+	float Amount;
+	int32 InstigatorId;		// Unique ID of the actor that did the damage (see ASpaceRocksProjectile::SpawnedBy)
+	FVector Location;
+
+	FSpaceRocksDamageEvent(AActor* InTarget, float InAmount, int32 InInstigatorId, const FVector& InLocation)
+		: Target(InTarget)
+		, Amount(InAmount)
+		, InstigatorId(InInstigatorId)
+		, Location(InLocation)
+	{
+	}
+};
+
+// All of a frame's hits on one target, merged
+struct FSpaceRocksTargetDamage
+{
+	AActor* Target;
+	float Amount;			// Total of all the hits
+	float BiggestHit;
+	int32 NumHits;
+	int32 InstigatorId;		// Of the biggest hit
+	FVector Location;		// Of the biggest hit
+};
+
+/**
+ * Damage queued during the frame, to be resolved in one pass per tick.
+ *
+ * Hit callbacks only append a small event, so they cost the same however much else is going on. Gather
+ * then drops the targets that have gone, sorts by target and merges, leaving one entry per damaged target
+ * for the game state to apply (shield, health, destruction, fracture) in a single loop.
+ */
+class SPACEROCKS_API FSpaceRocksDamageQueue
+{
+public:
+
+	void Add(AActor* Target, float Amount, const FVector& Location, int32 InstigatorId);
+
+	// Merge the queued hits per live target into OutDamage, and empty the queue. Returns the number of hits merged.
+	int32 Gather(TArray<FSpaceRocksTargetDamage>& OutDamage);
+
+	int32 Num() const { return Events.Num(); }
+
+	void Reset() { Events.Reset(); }
+
+private:
+
+	TArray<FSpaceRocksDamageEvent> Events;
+};
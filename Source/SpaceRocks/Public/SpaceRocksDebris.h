@@ -0,0 +1,139 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "GameFramework/Actor.h"
+#include "SpaceRocksDebris.generated.h"
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Debris Simulate"), STAT_SpaceRocksDebrisSimulate, STATGROUP_SpaceRocks, SPACEROCKS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Debris Push"), STAT_SpaceRocksDebrisPush, STATGROUP_SpaceRocks, SPACEROCKS_API);
+
+/**
+ * Explosion debris: rock chunks and sparks, simulated in one contiguous ring buffer and drawn through one
+ * instanced component per mesh (the rock meshes for chunks, a small sphere for sparks). No actors or emitters
+ * are spawned per explosion.
+ *
+ * The ring holds at most MaxChunks pieces. When it is full, or when updating it goes over UpdateBudgetMs, the
+ * oldest pieces are recycled first, and no more than MaxSpawnsPerFrame pieces are added in a frame, so a chain
+ * reaction costs no more than a single big explosion.
+ */
+UCLASS(config=Game)
+class SPACEROCKS_API ASpaceRocksDebris : public AActor
+{
+public:
+	GENERATED_UCLASS_BODY()
+
+	// Most debris pieces alive at once
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		int32 MaxChunks;
+
+	// Most pieces added in one frame, shared between all the explosions that frame
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		int32 MaxSpawnsPerFrame;
+
+	// Game thread time allowed for updating the debris each frame. Over budget, the oldest pieces are recycled early.
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		float UpdateBudgetMs;
+
+	// Chunks and sparks for a rock explosion of radius 100 (scaled with the rock's radius)
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		int32 ChunksPerExplosion;
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		int32 SparksPerExplosion;
+
+	// Sparks for a hit on the craft's shield
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		int32 SparksPerShieldHit;
+
+	// How long pieces last
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		float ChunkLifetime;
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		float SparkLifetime;
+
+	// Speed pieces are thrown out at
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		float ChunkSpeed;
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		float SparkSpeed;
+
+	// Fraction of speed lost per second
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		float Drag;
+
+	// Mesh for sparks
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		class UStaticMesh* SparkMesh;
+
+	// Mesh for chunks when the exploding rock doesn't say
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		class UStaticMesh* DefaultChunkMesh;
+
+	// Meshes in use, and the instanced component drawing each
+	UPROPERTY(Transient)
+		TArray<class UStaticMesh*> DebrisMeshes;
+	UPROPERTY(Transient)
+		TArray<class UInstancedStaticMeshComponent*> DebrisInstances;
+
+	// Begin AActor overrides
+	virtual void Tick(float DeltaSeconds) override;
+	// End AActor overrides
+
+	// Break a rock up into chunks of its mesh, plus sparks
+	void AddRockExplosion(const FVector& Location, const FVector& Velocity, float Radius, class UStaticMesh* RockMesh);
+
+	// Sparks off a shield hit, thrown out round Normal
+	void AddShieldHit(const FVector& Location, const FVector& Normal, const FVector& Velocity);
+
+	// Log piece counts and average update cost
+	void LogStats() const;
+
+	int32 GetNumLive() const { return NumLive; }
+
+protected:
+
+	// One debris piece. Pieces live in a ring in the order they were added, so the oldest is always at Oldest.
+	struct FDebrisChunk
+	{
+		FVector Position;
+		FVector Velocity;
+		FQuat Rotation;
+		FQuat Spin;			// Rotation per second
+		float Size;			// Instance scale
+		float Age;
+		float Lifetime;
+		int32 Mesh;			// Index into DebrisMeshes
+	};
+
+	// Add a piece, recycling the oldest if the ring is full (false if this frame's spawn budget is used up)
+	bool AddChunk(const FVector& Position, const FVector& Velocity, float Size, float Lifetime, int32 Mesh);
+
+	// Index into DebrisMeshes for a mesh, making its instanced component if it is new
+	int32 FindOrAddMesh(class UStaticMesh* Mesh);
+
+	// Recycle the oldest pieces until no more than Limit are alive
+	void RecycleOldest(int32 Limit);
+
+	// Copy piece transforms into the instanced components
+	void PushInstances();
+
+	TArray<FDebrisChunk> Chunks;		// Ring of MaxChunks pieces
+	int32 Oldest;
+	int32 NumLive;
+
+	// Live pieces allowed this frame (MaxChunks, less when over the update budget)
+	int32 ChunkCap;
+
+	int32 SpawnsThisFrame;
+
+	// Scratch: transforms for each mesh this frame
+	TArray<TArray<FMatrix> > MeshTransforms;
+
+	// Instances shown last frame, for each mesh and in all
+	TArray<int32> MeshInstanceCounts;
+	int32 NumInstancesShown;
+
+	// Running stats
+	float AverageUpdateMs;
+	int32 NumRecycled;
+	int32 NumDropped;
+	int32 PeakLive;
+};
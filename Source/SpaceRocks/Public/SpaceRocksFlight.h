@@ -0,0 +1,120 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+// Handling parameters (ASpaceRocksPawn's Acceleration, TurnSpeed etc.)
+struct SPACEROCKS_API FSpaceRocksFlightParams
+{
+	float Acceleration;
+	float Deceleration;
+	float TurnSpeed;
+	float ReturnSpeed;
+	float MinSpeed;
+	float MaxSpeed;
+	float AxisSmoothing;
+
+	// The pawn's defaults
+	FSpaceRocksFlightParams();
+};
+
+// One frame's control input, as the axis bindings deliver it (-1 to 1)
+struct SPACEROCKS_API FSpaceRocksFlightInput
+{
+	float Pitch;
+	float Yaw;
+	float Roll;
+	float Rear;
+	float Side;
+	float Bottom;
+
+	FSpaceRocksFlightInput()
+		: Pitch(0.f), Yaw(0.f), Roll(0.f), Rear(0.f), Side(0.f), Bottom(0.f)
+	{
+	}
+};
+
+// A craft's flight state. Location and Velocity are in the root component's frame, Rotation is PlaneMesh's relative rotation.
+struct SPACEROCKS_API FSpaceRocksFlightState
+{
+	FVector Location;
+	FRotator Rotation;
+	FVector Velocity;		// CurrentXAxisSpeed, CurrentYAxisSpeed, CurrentZAxisSpeed
+	FRotator TurnRate;		// CurrentPitchSpeed, CurrentYawSpeed, CurrentRollSpeed (degrees per second)
+
+	FSpaceRocksFlightState()
+		: Location(0.f, 0.f, 0.f)
+		, Rotation(0.f, 0.f, 0.f)
+		, Velocity(0.f, 0.f, 0.f)
+		, TurnRate(0.f, 0.f, 0.f)
+	{
+	}
+};
+
+/**
+ * The craft's flight math, with no dependence on a world or the pawn, so it can be checked and measured on its own.
+ * ASpaceRocksPawn's control functions and Tick are built from these; Step runs the same sequence for a whole frame.
+ */
+struct SPACEROCKS_API FSpaceRocksFlight
+{
+	// ** Kernels **
+
+	// New speed along one axis from a thruster's input and how much the thruster points along the axis (factor)
+	static float CalcThrust(const FSpaceRocksFlightParams& Params, float InputVal, float Factor, float CurrentAxisSpeed, float DeltaSeconds);
+
+	// Fire a thruster pointing along ThrustAxis. Returns the new velocity.
+	static FVector ApplyThrust(const FSpaceRocksFlightParams& Params, float InputVal, const FVector& ThrustAxis, const FVector& Velocity, float DeltaSeconds);
+
+	// Turn rates the pitch, yaw and roll thrusters aim for. With no input, pitch and roll return towards level at ReturnSpeed.
+	static float TargetPitchRate(const FSpaceRocksFlightParams& Params, float InputVal, float CurrentPitch);
+	static float TargetYawRate(const FSpaceRocksFlightParams& Params, float InputVal);
+	static float TargetRollRate(const FSpaceRocksFlightParams& Params, float InputVal, float CurrentRoll);
+
+	// Smoothly interpolate a turn rate towards its target
+	static float SmoothTurnRate(const FSpaceRocksFlightParams& Params, float CurrentRate, float TargetRate, float DeltaSeconds);
+
+	// Add two sets of degrees together e.g. 350degs + 20degs = 10degs
+	static float AddDegrees(float StartDegrees, float DegreesToAdd);
+
+	// Thrust factor for an axis OffsetDegrees round from the craft's heading, from the yaw angle (0-360 degs)
+	static float CalcFactor_yaw(float CraftAngle, float OffsetDegrees);
+
+	// Thrust factor for an axis from the pitch angle (+/- 90 degs)
+	static float CalcFactor_pitch(float CraftAngle);
+
+	// Thrust factor for an axis from the roll angle (+/- 180 degs)
+	static float CalcFactor_roll(float CraftAngle);
+
+	// ** Whole frames **
+
+	// What the control functions do with a frame's input: update the turn rates and velocity
+	static void ApplyControls(const FSpaceRocksFlightParams& Params, const FSpaceRocksFlightInput& Input, FSpaceRocksFlightState& State, float DeltaSeconds);
+
+	// What Tick does: move and rotate the craft
+	static void Integrate(FSpaceRocksFlightState& State, float DeltaSeconds);
+
+	// A whole frame, for one craft or a batch
+	static void Step(const FSpaceRocksFlightParams& Params, const FSpaceRocksFlightInput& Input, FSpaceRocksFlightState& State, float DeltaSeconds);
+	static void StepBatch(const FSpaceRocksFlightParams& Params, const FSpaceRocksFlightInput* Inputs, FSpaceRocksFlightState* States, int32 Num, float DeltaSeconds);
+
+	// ** Checks **
+
+	// Check the angle helpers against known values
+	static bool CheckAngleHelpers();
+
+	// Check single frames from simple starting states against values worked out by hand
+	static bool CheckKnownFrames();
+
+	/**
+	 * Fly the scripted input sequences and compare every frame with the golden trajectories in GetGoldenDir().
+	 * bRecord records all of them again instead. Returns false if anything differs or a golden is missing.
+	 */
+	static bool CheckTrajectories(bool bRecord);
+
+	// Content/FlightGolden, one <script>.csv per scripted sequence, recorded from an engine build
+	static FString GetGoldenDir();
+
+	// All of the above. The angle helpers and known frames are also the SpaceRocks.Flight automation tests.
+	static bool RunChecks(bool bRecord);
+
+	// Log ns per call for each kernel and frames per second for batches of up to NumCraft crafts
+	static void RunBenchmark(int32 NumCraft);
+};
@@ -9,8 +9,99 @@ class ASpaceRocksGameMode : public AGameMode
 public:
 	GENERATED_UCLASS_BODY()
 
+	// Begin AGameMode overrides
+	virtual void InitGameState() override;
+	virtual void StartPlay() override;
+	// End AGameMode overrides
 
+	// Turn on gravity wells and mutual attraction between large rocks
+	UPROPERTY(Category = SpaceRocksGameMode, EditAnywhere, BlueprintReadOnly)
+		bool bEnableGravity;
 
+	// ** Console Commands **
+
+	// Benchmark the gravity step from 100 up to MaxBodies bodies (default 100000)
+	UFUNCTION(exec)
+		void GravityBench(int32 MaxBodies);
+
+	// Benchmark generating a rock field of NumRocks rocks (default 50000) and check it is reproducible
+	UFUNCTION(exec)
+		void RockFieldBench(int32 NumRocks);
+
+	// Benchmark the lock-on target tree (build, refit and NumQueries cone queries, default 1000) at 1k, 10k and 100k targets
+	UFUNCTION(exec)
+		void TargetBench(int32 NumQueries);
+
+	// Benchmark batched hitscan ray casts (NumBlasts blasts of RaysPerBlast rays, default 1000 of 24) at 1k, 10k and 100k targets
+	UFUNCTION(exec)
+		void RayBench(int32 NumBlasts, int32 RaysPerBlast);
+
+	// Check the flight math against known values and the golden trajectories in Content/FlightGolden (bRecord 1 records them from this build)
+	UFUNCTION(exec)
+		void FlightCheck(int32 bRecord);
+
+	// Benchmark the flight math kernels, and whole frames for batches of up to NumCraft crafts (default 4096)
+	UFUNCTION(exec)
+		void FlightBench(int32 NumCraft);
+
+	// Log the decorative belts' cluster counts and game thread costs (run with -nullrhi to measure without rendering)
+	UFUNCTION(exec)
+		void BeltStats();
+
+	// Log the player craft's input latency histograms, then start them again if bReset is 1
+	UFUNCTION(exec)
+		void InputLatency(int32 bReset);
+
+	// Log the local players' views, which craft have spotlight shadows, and the shared per-frame stage costs
+	// (compare one player with split-screen)
+	UFUNCTION(exec)
+		void ViewStats();
+
+	// Log the world snapshot's publish cost, and read snapshots flat out from NumReaders workers (default 4) for
+	// five seconds, checking none is torn or out of order
+	UFUNCTION(exec)
+		void SnapshotCheck(int32 NumReaders);
+
+	// Log explosion debris counts and update cost
+	UFUNCTION(exec)
+		void DebrisStats();
+
+	// Blow up NumExplosions (default 50) rock-sized explosions round the player at once, to stress the debris budget
+	UFUNCTION(exec)
+		void DebrisBurst(int32 NumExplosions);
+
+	// Time the damage pass for frames of 10 up to NumHits hits (default 1000), spread over the live rocks and craft.
+	// The hits do no damage, so nothing is destroyed.
+	UFUNCTION(exec)
+		void DamageBench(int32 NumHits);
+
+	// Play NumFrames frames (default 300) with each collision setup in turn - legacy profiles, SpaceRocks channels,
+	// query-only rocks - then log their physics kickoff to fetch times and pair counts side by side
+	UFUNCTION(exec)
+		void CollisionBench(int32 NumFrames);
+
+	// Switch to the next arena now, logging its load and activation times
+	UFUNCTION(exec)
+		void ArenaNext();
+
+	// Write the gameplay event trace to Saved/Traces (convert with Tools/SpaceRocksTrace/srtrace_to_chrome.py)
+	UFUNCTION(exec)
+		void TraceFlush();
+
+	// Turn gameplay event tracing on (1) or off (0)
+	UFUNCTION(exec)
+		void TraceEnable(int32 bEnable);
+
+};
+
+/**
+ * Game mode with gravity wells and mutual attraction between large rocks
+ */
+UCLASS(minimalapi)
+class ASpaceRocksGravityGameMode : public ASpaceRocksGameMode
+{
+public:
+	GENERATED_UCLASS_BODY()
 };
 
 
@@ -3,12 +3,63 @@
 #pragma once
 
 #include "GameFramework/GameState.h"
+#include "SpaceRocksGravity.h"
+#include "SpaceRocksRockField.h"
+#include "SpaceRocksTargeting.h"
+#include "SpaceRocksArenaStreaming.h"
+#include "SpaceRocksDamage.h"
+#include "SpaceRocksViews.h"
+#include "SpaceRocksSnapshot.h"
+#include "SpaceRocksCollision.h"
 #include "SpaceRocksGameState.generated.h"
 
+// A fixed point of gravity placed in the arena
+USTRUCT(BlueprintType)
+struct FSpaceRocksGravityWell
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(Category = GravityWell, EditAnywhere, BlueprintReadWrite)
+		FVector Location;
+
+	UPROPERTY(Category = GravityWell, EditAnywhere, BlueprintReadWrite)
+		float Mass;
+
+	FSpaceRocksGravityWell()
+		: Location(0.f, 0.f, 0.f)
+		, Mass(0.f)
+	{
+	}
+};
+
+// A smaller rock that a destroyed rock broke up into, waiting to be spawned
+struct FSpaceRocksRockFragment
+{
+	TWeakObjectPtr<UClass> RockClass;		// Same class as the rock it came from
+	FSpaceRocksRockSpawn Spawn;
+};
+
+// Who fired a queued hitscan ray, and what it does to whatever it hits
+struct FSpaceRocksHitscanShot
+{
+	TWeakObjectPtr<AActor> Shooter;		// The ray's IgnoreActor
+	int32 InstigatorId;
+	float Damage;
+};
+
+// Runs the game state's end of frame stages (ASpaceRocksGameState::TickPostUpdate), once physics has moved everything
+struct FSpaceRocksPostUpdateTickFunction : public FTickFunction
+{
+	class ASpaceRocksGameState* Target;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
 /**
  * 
  */
-UCLASS()
+UCLASS(config=Game)
 class SPACEROCKS_API ASpaceRocksGameState : public AGameState
 {
 public:
@@ -17,6 +68,9 @@ public:
 	// Begin AGameState overrides
 	virtual void DefaultTimer() override;
 	virtual void OnConstruction(const FTransform& Transform);
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	// End AGameState overrides
 
 	// Basic 3D Asteroids-Style Game State Parameters
@@ -43,4 +97,255 @@ public:
 	UFUNCTION(BlueprintCallable, Category = SpaceRocksGameState)
 		float GetSpacerockSpawnSpeed();
 
+	// Move on to the next level (back to level 1 after num_levels, in the next arena if there are arenas)
+	UFUNCTION(BlueprintCallable, Category = SpaceRocksGameState)
+		void NextLevel();
+
+	// Arenas: streaming sublevels of the persistent level, played in turn, num_levels levels each.
+	// The next arena is preloaded during the final level of the current one (from the start, with one level per arena).
+	UPROPERTY(Category = SpaceRocksArena, EditAnywhere, Config)
+		TArray<FName> ArenaLevels;		// Package names of the arena sublevels (none = no arena streaming)
+	UPROPERTY(Category = SpaceRocksArena, EditAnywhere, Config)
+		float ArenaFrameBudgetMs;		// Frames longer than this while loading or activating an arena are logged as warnings
+	UPROPERTY(Category = SpaceRocksArena, VisibleAnywhere, BlueprintReadOnly)
+		int32 curr_arena;				// Index into ArenaLevels
+
+	// Switch to the next arena straight away (it pops in if it wasn't preloaded)
+	UFUNCTION(BlueprintCallable, Category = SpaceRocksGameState)
+		void NextArena();
+
+	// Gravity (off unless the game mode turns it on)
+	UPROPERTY(Category = SpaceRocksGravity, EditAnywhere, BlueprintReadWrite)
+		bool bEnableGravity;
+	UPROPERTY(Category = SpaceRocksGravity, EditAnywhere)
+		float GravityConstant;		// Gravitational constant in game units
+	UPROPERTY(Category = SpaceRocksGravity, EditAnywhere)
+		float GravityOpeningAngle;	// Barnes-Hut opening angle (0 = exact, higher = faster but less accurate)
+	UPROPERTY(Category = SpaceRocksGravity, EditAnywhere)
+		float GravitySoftening;		// Softening distance so close passes don't fling things about
+	UPROPERTY(Category = SpaceRocksGravity, EditAnywhere)
+		float MinGravityMass;		// Rocks lighter than this are pulled, but don't pull anything themselves
+	UPROPERTY(Category = SpaceRocksGravity, EditAnywhere, BlueprintReadWrite)
+		TArray<FSpaceRocksGravityWell> GravityWells;
+	UPROPERTY(Category = SpaceRocksGravity, VisibleAnywhere, BlueprintReadOnly)
+		float GravityStepMs;		// Time taken by the last gravity step
+
+	// Procedural rock field
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere)
+		bool bGenerateRockField;		// Generate the rock field on BeginPlay (otherwise rocks come from the map)
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere, BlueprintReadWrite)
+		int32 RockFieldSeed;			// Base seed. Each level uses RockFieldSeed + curr_level.
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere)
+		FBox ArenaBounds;				// Rocks are placed inside these bounds (and query-only rocks bounce off their sides)
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere)
+		float RockMinRadius;			// Smallest rock radius
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere)
+		float RockMaxRadius;			// Largest rock radius
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere)
+		float RockSizeExponent;		// Size distribution power law (0 = uniform, higher = more small rocks)
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere)
+		float RockSpacing;				// Minimum gap between rocks
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere)
+		float RockClearRadius;			// Keep this radius round the player start clear
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere)
+		TSubclassOf<class ASpaceRocksRock> RockClass;	// Rock to spawn
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere)
+		float RockSpawnBudgetMs;		// Game thread time allowed for spawning generated rocks each frame
+
+	UPROPERTY(Category = SpaceRocksRockField, EditAnywhere)
+		bool bProceduralRockMeshes;	// Give rocks generated meshes (spawns an ASpaceRocksRockMeshLibrary on BeginPlay)
+
+	// Explosion debris
+	UPROPERTY(Category = SpaceRocksDebris, EditAnywhere)
+		bool bExplosionDebris;		// Rocks break up into debris (spawns an ASpaceRocksDebris on BeginPlay)
+	UPROPERTY(Transient)
+		class ASpaceRocksDebris* Debris;
+
+	// Damage, resolved once per tick
+	UPROPERTY(Category = SpaceRocksDamage, EditAnywhere)
+		float RockFractureMinRadius;	// Rocks at least this big break up into smaller rocks when destroyed by damage
+	UPROPERTY(Category = SpaceRocksDamage, EditAnywhere)
+		int32 RockFragments;			// Number of smaller rocks a rock breaks up into
+	UPROPERTY(Category = SpaceRocksDamage, EditAnywhere)
+		float RockFragmentSpeed;		// Speed the fragments fly apart at
+	UPROPERTY(Category = SpaceRocksDamage, VisibleAnywhere, BlueprintReadOnly)
+		float DamageResolveMs;		// Time taken by the last damage pass
+	UPROPERTY(Category = SpaceRocksDamage, VisibleAnywhere, BlueprintReadOnly)
+		int32 DamageHits;				// Hits resolved by the last damage pass
+	UPROPERTY(Category = SpaceRocksDamage, VisibleAnywhere, BlueprintReadOnly)
+		int32 DamageTargets;			// Targets they were merged into
+
+	// Queue damage to a rock or craft. It is applied in the next damage pass, merged with any other hits on the target.
+	void QueueDamage(AActor* Target, float Amount, const FVector& Location, int32 InstigatorId);
+
+	// Apply all the queued damage now (normally done each TickPostUpdate)
+	void ResolveDamage();
+
+	// Hitscan weapons. Rays fired during the frame are cast together in one pass at the end of the same frame
+	// (TickPostUpdate), against where physics left the rocks, just before the damage pass.
+	UPROPERTY(Category = SpaceRocksHitscan, EditAnywhere)
+		bool bHitscanStaticGeometry;	// Stop rays at static arena geometry (one engine trace per ray, against simple collision)
+	UPROPERTY(Category = SpaceRocksHitscan, VisibleAnywhere, BlueprintReadOnly)
+		float HitscanCastMs;		// Time taken by the last hitscan pass
+	UPROPERTY(Category = SpaceRocksHitscan, VisibleAnywhere, BlueprintReadOnly)
+		int32 HitscanRaysCast;		// Rays cast by the last hitscan pass
+	UPROPERTY(Category = SpaceRocksHitscan, VisibleAnywhere, BlueprintReadOnly)
+		int32 HitscanRaysHit;		// Rays that hit a rock or craft
+
+	// Fire a hitscan ray. It is cast in the next hitscan pass and damages the first rock or craft it hits.
+	void QueueRay(const FSpaceRocksTargetRay& Ray, float Damage);
+
+	// Cast a batch of rays against the rocks and craft shields (as spheres, all rays down the target tree together),
+	// stopping them at static arena geometry. Each ray reports at most one hit, the first thing along it; rays that
+	// hit nothing are left out. OutHits is in ray order (Hit.Ray ascending), not sorted by distance.
+	// Static geometry hits have Proxy INDEX_NONE and the actor that was hit.
+	void CastRays(const TArray<FSpaceRocksTargetRay>& Rays, TArray<FSpaceRocksTargetRayHit>& OutHits) const;
+
+	// Cast all the queued rays now and queue their damage (normally done each TickPostUpdate)
+	void ResolveHitscan();
+
+	// Rays cast by the last hitscan pass, cut short where they hit, for drawing beams and tracers
+	const TArray<FSpaceRocksTargetRay>& GetHitscanTracers() const { return HitscanTracers; }
+
+	// Generate a rock field for the current level on a worker thread. Rocks are spawned over the next few frames.
+	UFUNCTION(BlueprintCallable, Category = SpaceRocksGameState)
+		void StartRockField();
+
+	// Is a rock field still being generated or spawned?
+	UFUNCTION(BlueprintCallable, Category = SpaceRocksGameState)
+		bool IsRockFieldPending() const;
+
+	// Params for generating the current level's rock field
+	FSpaceRocksRockFieldParams GetRockFieldParams() const;
+
+	// Live rocks and projectiles. They register themselves on BeginPlay and unregister on Destroyed.
+	void RegisterRock(class ASpaceRocksRock* Rock);
+	void UnregisterRock(class ASpaceRocksRock* Rock);
+	void RegisterProjectile(class ASpaceRocksProjectile* Projectile);
+	void UnregisterProjectile(class ASpaceRocksProjectile* Projectile);
+
+	UPROPERTY(Transient)
+		TArray<class ASpaceRocksRock*> SpaceRocks;
+	UPROPERTY(Transient)
+		TArray<class ASpaceRocksProjectile*> Projectiles;
+
+	// Player craft, registered the same way. Rocks and craft are lock-on targets, and every craft is flown in one stage (StepCraft).
+	void RegisterCraft(class ASpaceRocksPawn* Pawn);
+	void UnregisterCraft(class ASpaceRocksPawn* Pawn);
+
+	// A local player controller flying a craft. We tick after it, so StepCraft flies this frame's input rather than last frame's.
+	void RegisterCraftController(class APlayerController* PlayerController);
+
+	UPROPERTY(Transient)
+		TArray<class ASpaceRocksPawn*> Craft;
+
+	UPROPERTY(Category = SpaceRocksCraft, VisibleAnywhere, BlueprintReadOnly)
+		float CraftStepMs;			// Time taken by the last craft step (flight and lock-on for every craft)
+
+	// Split-screen: per-view detail decisions are made against all the local players' views at once
+	UPROPERTY(Category = SpaceRocksViews, EditAnywhere, Config)
+		int32 MaxCraftSpotLightShadows;	// Local players (first to last) whose craft spotlight casts shadows. Other spotlights don't.
+
+	// Local players' views this frame
+	const FSpaceRocksViewSet& GetViews() const { return Views; }
+
+	// World snapshots for readers on other threads (HUD, radar, telemetry...), published at the end of each Tick.
+	// Hold on to the pointer (not the game state) from worker tasks.
+	const FSpaceRocksSnapshotBufferPtr& GetSnapshots() const { return Snapshots; }
+
+	UPROPERTY(Category = SpaceRocksSnapshot, VisibleAnywhere, BlueprintReadOnly)
+		float SnapshotPublishMs;	// Time taken to write the last snapshot
+
+	// Collision (channels, profiles and modes are in SpaceRocksCollision.h)
+	UPROPERTY(Category = SpaceRocksCollision, EditAnywhere, Config)
+		bool bQueryOnlyRocks;		// Rocks are kinematic and query only: they pass through each other and make no physics pairs
+	UPROPERTY(Category = SpaceRocksCollision, VisibleAnywhere, BlueprintReadOnly)
+		float PhysicsKickoffToFetchMs;	// Last physics step, kickoff to fetch on the game thread (includes TG_DuringPhysics work, see FSpaceRocksPhysicsFrame)
+	UPROPERTY(Category = SpaceRocksCollision, VisibleAnywhere, BlueprintReadOnly)
+		int32 PhysicsContactPairs;	// Shape pairs in the last physics step's narrowphase
+
+	// Switch every rock, projectile and craft to a collision mode. Ones that register later get it too.
+	void SetCollisionMode(ESpaceRocksCollisionMode::Type Mode);
+	ESpaceRocksCollisionMode::Type GetCollisionMode() const { return CollisionMode; }
+
+	// Play NumFrames frames in each collision mode in turn, then log their physics times and pair counts and go back to our own mode
+	void StartCollisionBench(int32 NumFrames);
+
+	// Physics time and pairs of each frame
+	const FSpaceRocksPhysicsStats& GetPhysicsStats() const { return PhysicsStats; }
+
+	// Nearest lock-on targets in a cone (see FSpaceRocksTargetBVH::QueryCone)
+	int32 FindTargets(const FSpaceRocksTargetCone& Cone, FSpaceRocksTargetHit* OutHits, int32 MaxHits) const;
+
+	UPROPERTY(Category = SpaceRocksTargeting, VisibleAnywhere, BlueprintReadOnly)
+		float TargetRefitMs;		// Time taken by the last target tree refit
+
+protected:
+
+	// Simulation stages, run each Tick
+	void UpdateViews();
+	void StepGravity(float DeltaSeconds);
+	void StepRocks(float DeltaSeconds);
+	void StepCraft(float DeltaSeconds);
+	void UpdateRockField();
+	void PublishSnapshot(float DeltaSeconds);
+
+	// End of frame stages, after physics (TG_PostUpdateWork): refit the target tree, then this frame's hitscan rays and damage
+	friend struct FSpaceRocksPostUpdateTickFunction;
+	FSpaceRocksPostUpdateTickFunction PostUpdateTick;
+	void TickPostUpdate(float DeltaSeconds);
+	void UpdateTargets(float DeltaSeconds);
+
+	FSpaceRocksGravitySim GravitySim;
+
+	// Scratch buffers for the gravity step, kept between frames to avoid reallocating
+	TArray<FSpaceRocksGravityBody> GravityBodies;
+	TArray<FVector> GravityPositions;
+	TArray<FVector> GravityAccelerations;
+
+	// Lock-on targets
+	FSpaceRocksTargetBVH TargetTree;
+
+	// Local players' views
+	FSpaceRocksViewSet Views;
+
+	// Collision mode, physics measurements and the collision benchmark
+	ESpaceRocksCollisionMode::Type CollisionMode;
+	FSpaceRocksPhysicsStats PhysicsStats;
+	FSpaceRocksCollisionBench CollisionBench;
+
+	// Triple buffered world snapshots
+	FSpaceRocksSnapshotBufferPtr Snapshots;
+
+	// Arena sublevel loading
+	FSpaceRocksArenaStreaming ArenaStreaming;
+
+	// Start loading the next arena if the next level will switch to it
+	void PreloadNextArena();
+
+	// Rock field being generated, and generated rocks still to spawn
+	FAsyncTask<FSpaceRocksRockFieldTask>* RockFieldTask;
+	TArray<FSpaceRocksRockSpawn> PendingRockSpawns;
+	int32 NextRockSpawn;
+
+	// Damage queued since the last pass, and scratch buffers for the pass
+	FSpaceRocksDamageQueue DamageQueue;
+	TArray<FSpaceRocksTargetDamage> TargetDamage;
+	TArray<class ASpaceRocksRock*> DeadRocks;
+
+	// Hitscan rays queued since the last pass (and who fired each), the last pass's hits, and what it drew
+	TArray<FSpaceRocksTargetRay> PendingRays;
+	TArray<FSpaceRocksHitscanShot> PendingShots;
+	TArray<FSpaceRocksTargetRayHit> RayHits;
+	TArray<FSpaceRocksTargetRay> HitscanTracers;
+
+	// Smaller rocks that destroyed rocks broke up into, spawned alongside the rock field
+	TArray<FSpaceRocksRockFragment> PendingFragments;
+
+	// Queue the fragments of a rock destroyed by damage
+	void FractureRock(class ASpaceRocksRock* Rock);
+
+	// Spawn a queued rock, sized to its radius
+	class ASpaceRocksRock* SpawnRock(UClass* Class, const FSpaceRocksRockSpawn& Spawn);
+
 };
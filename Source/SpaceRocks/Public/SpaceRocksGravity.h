@@ -0,0 +1,98 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gravity Build"), STAT_SpaceRocksGravityBuild, STATGROUP_SpaceRocks, SPACEROCKS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gravity Solve"), STAT_SpaceRocksGravitySolve, STATGROUP_SpaceRocks, SPACEROCKS_API);
+
+// A body that attracts other bodies (a large rock or a gravity well)
+struct FSpaceRocksGravityBody
+{
+	FVector Position;
+	float Mass;
+
+	FSpaceRocksGravityBody() {}
+	FSpaceRocksGravityBody(const FVector& InPosition, float InMass)
+		: Position(InPosition)
+		, Mass(InMass)
+	{
+	}
+};
+
+/**
+ * Barnes-Hut gravity simulation.
+ * Each step builds an octree over the massive bodies (Morton sorted, so each leaf is a contiguous run of bodies),
+ * then evaluates the acceleration at any number of points. Both stages run on the task graph worker threads.
+ */
+class SPACEROCKS_API FSpaceRocksGravitySim
+{
+public:
+	FSpaceRocksGravitySim();
+
+	// Barnes-Hut opening angle. A node is treated as a single mass when size / distance < OpeningAngle. 0 = exact.
+	float OpeningAngle;
+
+	// Gravitational constant in game units (cm^3 / (kg s^2))
+	float GravityConstant;
+
+	// Softening distance, stops the acceleration blowing up when two bodies get very close
+	float Softening;
+
+	// Maximum bodies held in a leaf node
+	int32 LeafSize;
+
+	// Build the octree over the passed massive bodies
+	void Build(const TArray<FSpaceRocksGravityBody>& Bodies);
+
+	// Calculate the acceleration at each of the passed positions (in parallel)
+	void ComputeAccelerations(const TArray<FVector>& Positions, TArray<FVector>& OutAccelerations) const;
+
+	// Calculate the acceleration at a single position
+	FVector AccelerationAt(const FVector& Position) const;
+
+	// Brute force O(n) acceleration at a position, for checking the octree
+	FVector AccelerationAtExact(const FVector& Position) const;
+
+	// Number of bodies / nodes in the current tree
+	int32 NumBodies() const { return SortedBodies.Num(); }
+	int32 NumNodes() const { return Nodes.Num(); }
+
+	// Timings of the last Build and ComputeAccelerations, in seconds
+	double LastBuildSeconds;
+	mutable double LastSolveSeconds;
+
+	// Run the build + solve over random fields of 100 to MaxBodies bodies, logging the step times
+	static void RunBenchmark(int32 MaxBodies, float OpeningAngle);
+
+private:
+	struct FNode
+	{
+		FVector CentreOfMass;
+		float Mass;
+		FVector Centre;
+		float HalfSize;
+		int32 FirstChild;	// Children are contiguous. INDEX_NONE for a leaf.
+		int32 NumChildren;
+		int32 BodyBegin;	// Range of SortedBodies under this node
+		int32 BodyEnd;
+	};
+
+	struct FMortonBody
+	{
+		uint32 Code;
+		int32 Index;
+		bool operator<(const FMortonBody& Other) const { return Code < Other.Code; }
+	};
+
+	// Build the subtree for node NodeIndex of OutNodes, appending its descendants to OutNodes
+	void BuildNode(TArray<FNode>& OutNodes, int32 NodeIndex, int32 Depth) const;
+
+	// Fill in an (unlinked) node for a run of sorted bodies
+	void InitNode(FNode& Node, int32 BodyBegin, int32 BodyEnd, const FVector& Centre, float HalfSize) const;
+
+	// Split a run of sorted bodies into octants at the given depth. Returns the number of non empty octants.
+	int32 SplitOctants(int32 BodyBegin, int32 BodyEnd, int32 Depth, int32 OutBegin[8], int32 OutEnd[8], int32 OutOctant[8]) const;
+
+	TArray<FNode> Nodes;
+	TArray<FMortonBody> Morton;
+	TArray<FSpaceRocksGravityBody> SortedBodies;
+};
@@ -0,0 +1,59 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "GameFramework/HUD.h"
+#include "SpaceRocksRadar.h"
+#include "SpaceRocksHUD.generated.h"
+
+/**
+ * HUD with a 3D radar and lock-on reticle. The radar is drawn from the radar provider's latest (precomputed) sweep -
+ * a few hundred clustered blips at most, however many rocks are in the field.
+ */
+UCLASS(config=Game)
+class ASpaceRocksHUD : public AHUD
+{
+public:
+	GENERATED_UCLASS_BODY()
+
+	// Begin AHUD overrides
+	virtual void DrawHUD() override;
+	// End AHUD overrides
+
+	// Show the radar
+	UPROPERTY(Category = SpaceRocksRadar, EditAnywhere, BlueprintReadWrite, config)
+		bool bShowRadar;
+
+	// Radar sweeps per second
+	UPROPERTY(Category = SpaceRocksRadar, EditAnywhere, config)
+		float RadarUpdateRate;
+
+	// Radar range
+	UPROPERTY(Category = SpaceRocksRadar, EditAnywhere, config)
+		float RadarRange;
+
+	// Radar grid cells along each axis (contacts in the same cell share a blip)
+	UPROPERTY(Category = SpaceRocksRadar, EditAnywhere, config, meta = (ClampMin = "1", ClampMax = "64"))
+		int32 RadarGridCells;
+
+	// Number of threats to mark
+	UPROPERTY(Category = SpaceRocksRadar, EditAnywhere, config)
+		int32 RadarMaxThreats;
+
+	// Radar disc radius, as a fraction of the screen height
+	UPROPERTY(Category = SpaceRocksRadar, EditAnywhere, config)
+		float RadarScreenSize;
+
+protected:
+
+	void DrawRadar();
+
+	// Brackets round the craft's locked targets
+	void DrawLockOn();
+
+	// Beams and tracers from the last hitscan pass
+	void DrawTracers();
+
+	// Screen position of a craft space location on the radar. OutBase is where its stem meets the disc.
+	FVector2D RadarToScreen(const FVector& Local, const FVector2D& Centre, float Size, FVector2D& OutBase) const;
+
+	FSpaceRocksRadarProvider Radar;
+};
@@ -0,0 +1,93 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+// Craft controls fed by the axis bindings
+namespace ESpaceRocksControl
+{
+	enum Type
+	{
+		Pitch,
+		Yaw,
+		Roll,
+		RearThrust,
+		SideThrust,
+		BottomThrust,
+		NUM_CONTROLS
+	};
+}
+
+/**
+ * Latency histogram with log spaced buckets (each half an octave wide, from 0.1ms up to about 6.5s).
+ */
+struct SPACEROCKS_API FSpaceRocksLatencyHistogram
+{
+	static const int32 NumBuckets = 32;
+
+	uint32 Buckets[NumBuckets];
+	int32 Count;
+	double SumMs;
+	float MinMs;
+	float MaxMs;
+
+	FSpaceRocksLatencyHistogram() { Reset(); }
+
+	void Reset();
+	void Add(float Ms);
+
+	// Latency (ms) below which the given fraction (0-1) of samples fall, to bucket resolution
+	float Percentile(float Fraction) const;
+
+	float MeanMs() const { return Count ? (float)(SumMs / Count) : 0.f; }
+
+	// Upper edge of a bucket, in ms
+	static float BucketUpperMs(int32 Bucket);
+
+	// One line summary: count, mean, min, p50/p95/p99, max
+	FString Summary() const;
+};
+
+/**
+ * Times craft control input from the moment it arrives at the game viewport (USpaceRocksViewportClient) to the
+ * moment the pawn's Tick applies it - PlaneMesh rotation for the rotation controls, the actor offset for the
+ * thrusters. One histogram per control.
+ *
+ * A new value at a handler (PitchCraft, RearThrust etc.) is timed from the latest event its controller had since
+ * the previous frame began. Values with no such event (the soak autopilot calls the handlers directly) are timed
+ * from the start of the frame.
+ */
+class SPACEROCKS_API FSpaceRocksInputLatency
+{
+public:
+	FSpaceRocksInputLatency();
+
+	// Local player controller whose input events this times (INDEX_NONE for none, e.g. the autopilot)
+	int32 ControllerId;
+
+	// An input event for a controller has arrived at the viewport
+	static void NoteArrival(int32 ControllerId);
+
+	// An input handler was called. Only changes in value count as new samples.
+	void OnInput(ESpaceRocksControl::Type Control, float Value);
+
+	// Tick has applied the controls in [FirstControl, LastControl]
+	void OnApplied(ESpaceRocksControl::Type FirstControl, ESpaceRocksControl::Type LastControl);
+
+	void Reset();
+
+	// All controls together
+	FSpaceRocksLatencyHistogram GetCombined() const;
+
+	// Log each control's summary, plus a bar chart of the combined histogram
+	void LogReport(const FString& Label) const;
+
+	FSpaceRocksLatencyHistogram Histograms[ESpaceRocksControl::NUM_CONTROLS];
+
+private:
+	enum { MAX_CONTROLLERS = 8 };
+
+	// Latest event arrival for each controller, FPlatformTime::Seconds() (game thread only)
+	static double ArrivalTimes[MAX_CONTROLLERS];
+
+	float LastValue[ESpaceRocksControl::NUM_CONTROLS];
+	double PendingTime[ESpaceRocksControl::NUM_CONTROLS];		// Arrival of the oldest unapplied sample, 0 if none
+};
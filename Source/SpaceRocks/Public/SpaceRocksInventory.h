@@ -0,0 +1,82 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "SpaceRocksWeaponInfo.h"
+#include "SpaceRocksInventory.generated.h"
+
+// Number of (non weapon) pickup slots
+#define NUM_INV_SLOTS 10
+
+/**
+ * Player's inventory. Fixed size arrays only, so it can be copied, snapshotted and replicated as a block.
+ */
+USTRUCT(BlueprintType)
+struct SPACEROCKS_API FSpaceRocksInventory
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Weapon ID held in each weapon slot (ESpaceRocksWeapon::EMPTY if none)
+	UPROPERTY(Category = Inventory, VisibleAnywhere)
+		uint8 weaponInventory[NUM_WEAP_SLOTS];
+
+	// Ammo left for each weapon slot (-1 = unlimited)
+	UPROPERTY(Category = Inventory, VisibleAnywhere)
+		int32 ammo[NUM_WEAP_SLOTS];
+
+	// World time at which each weapon slot may fire again
+	UPROPERTY(Category = Inventory, VisibleAnywhere)
+		float cooldown[NUM_WEAP_SLOTS];
+
+	// Pickup type held in each inventory slot (0 if none)
+	UPROPERTY(Category = Inventory, VisibleAnywhere)
+		uint8 items[NUM_INV_SLOTS];
+
+	FSpaceRocksInventory();
+
+	// Empty the inventory, then give the craft its default weapon in slot 0
+	void Reset(const FSpaceRocksWeaponInfo& WeapInfo);
+
+	// Add a weapon. Returns the slot it went in, or -1 if there is no room.
+	int32 AddToWeapInv(int32 WeaponID, const FSpaceRocksWeaponInfo& WeapInfo);
+
+	// Add an ammo pack for a weapon we already hold. Returns false if we don't hold it or it's full.
+	bool AddToAmmo(int32 WeaponID, const FSpaceRocksWeaponInfo& WeapInfo);
+
+	// Add a (non weapon) pickup. Returns false if there is no room.
+	bool AddToInv(int32 PUtype);
+
+	// Does the passed pickup type exist in the inventory?
+	bool LookForInv(int32 PUtype) const;
+
+	// Can the weapon in a slot fire at the given world time?
+	FORCEINLINE bool CanFire(int32 slot, float TimeSeconds) const
+	{
+		return weaponInventory[slot] != ESpaceRocksWeapon::EMPTY && ammo[slot] != 0 && cooldown[slot] <= TimeSeconds;
+	}
+
+	// Use one round from a slot and start its cooldown
+	FORCEINLINE void ConsumeShot(int32 slot, float TimeSeconds, float FireRate)
+	{
+		if (ammo[slot] > 0) ammo[slot]--;
+		cooldown[slot] = TimeSeconds + FireRate;
+	}
+
+	// Serialization for snapshots and replication
+	bool Serialize(FArchive& Ar);
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	friend FArchive& operator<<(FArchive& Ar, FSpaceRocksInventory& Inv)
+	{
+		Inv.Serialize(Ar);
+		return Ar;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FSpaceRocksInventory> : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithSerializer = true,
+		WithNetSerializer = true,
+	};
+};
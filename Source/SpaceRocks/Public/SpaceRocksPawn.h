@@ -1,6 +1,8 @@
 // Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
 #pragma once
 #include "GameFramework/Pawn.h"
+#include "SpaceRocksInventory.h"
+#include "SpaceRocksInputLatency.h"
 #include "SpaceRocksPawn.generated.h"
 
 UCLASS(config=Game)
@@ -40,6 +42,9 @@ public:
 	virtual void Tick(float DeltaSeconds) override;
 	virtual void ReceiveHit(class UPrimitiveComponent* MyComp, class AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
 	virtual void ReceiveActorBeginOverlap(class AActor * Other) override;
+	virtual void PostInitializeComponents() override;
+	virtual void BeginPlay() override;
+	virtual void Destroyed() override;
 	// End AActor overrides
 
 
@@ -88,17 +93,61 @@ public:
 		float ShieldLevel;
 
 	// Inventories
-	//UPROPERTY(Category = Pawn, VisibleAnywhere, BlueprintReadOnly)
-	//ReconOneInventory PlayerInv;
-	//SpaceRocksInventory PlayerInv;
+	UPROPERTY(Category = SpaceRocksPawn, VisibleAnywhere, BlueprintReadOnly, Replicated)
+		FSpaceRocksInventory PlayerInv;
+
+	// Weapon definitions (rows of FSpaceRocksWeaponRow). Compiled into WeapInfo at load.
+	UPROPERTY(Category = SpaceRocksPawn, EditAnywhere)
+		class UDataTable* WeaponTable;
+
+	// Projectile used by weapons that don't name their own
+	UPROPERTY(Category = SpaceRocksPawn, EditAnywhere)
+		TSubclassOf<AActor> DefaultProjectileClass;
 
 	// Helpers
-	//UPROPERTY(Category = Pawn, VisibleAnywhere, BlueprintReadOnly)
-	//ReconOneWeaponInfo WeapInfo;
-	//SpaceRocksWeaponInfo WeapInfo;
+	FSpaceRocksWeaponInfo WeapInfo;
+
+	// Lock-on
+
+	// Half angle of the lock-on cone round the craft's forward vector
+	UPROPERTY(Category = SpaceRocksPawn, EditAnywhere)
+		float LockOnHalfAngle;
+
+	// Lock-on range
+	UPROPERTY(Category = SpaceRocksPawn, EditAnywhere)
+		float LockOnRange;
+
+	// Most targets locked at once (up to MAX_LOCK_TARGETS)
+	UPROPERTY(Category = SpaceRocksPawn, EditAnywhere)
+		int32 MaxLockTargets;
+
+	// Targets currently locked, nearest first. Homing weapons cycle through these.
+	UPROPERTY(Category = SpaceRocksPawn, VisibleAnywhere, BlueprintReadOnly, Transient)
+		TArray<AActor*> LockedTargets;
+
+	// Proxy in the game state's target tree
+	int32 TargetProxy;
+
+	// Set while the game state's craft stage flies us (between RegisterCraft and UnregisterCraft), so Tick doesn't step us as well
+	bool bFlownByGameState;
+
+	// Time from control input arriving to it moving the craft
+	FSpaceRocksInputLatency InputLatency;
+
+	// Move and turn the craft by its current speeds. The game state does this for all craft at once (ASpaceRocksGameState::StepCraft).
+	void StepFlight(float DeltaSeconds);
+
+	// Pick the nearest targets in the lock-on cone
+	void UpdateLockOn();
+
+	// Fire a hitscan weapon's rays from the hardpoints, along the current fire directions. The game state casts them.
+	void FireHitscan(const FSpaceRocksWeaponDef& WeapDef, float DeltaSeconds);
 
 protected:
 
+	// The soak test's autopilot flies the craft through the same control functions as the player
+	friend class ASpaceRocksSoakTest;
+
 	// Begin APawn overrides
 	virtual void SetupPlayerInputComponent(class UInputComponent* InputComponent) override; // Allows binding actions/axes to functions
 	virtual void OnConstruction(const FTransform& Transform);
@@ -144,6 +193,7 @@ protected:
 	void weap_slot_8();
 	void weap_slot_9();
 	void weap_slot_0();
+	void SelectWeapon(int32 slot);
 
 	// How quickly forward speed changes
 	UPROPERTY(Category = SpaceRocksPawn, EditAnywhere)
@@ -188,21 +238,11 @@ protected:
 
 private:
 
+	// Fire a directional thruster pointing along ThrustAxis
+	void ApplyThrust(float val, const FVector& ThrustAxis);
 
-	// Add two sets of degrees together e.g. 350degs + 20degs = 10degs
-	float AddDegrees(float startdeg, float adddeg);
-
-	// Calculate the thrust factor for an axis from the yaw angle (0-360 degs)
-	float CalcFactor_yaw(float craftangle, float offset_degs);
-
-	// Calculate the thrust factor for an axis from the pitch angle (+/- 90 degs)
-	float CalcFactor_pitch(float craftangle);
-
-	// Calculate the thrust factor for an axis from the roll angle (+/- 180 degs)
-	float CalcFactor_roll(float craftangle);
-
-	// Calculate Thrust
-	float CalcThrust(float InputVal, float factor, float CurrentAxisSpeed);
+	// Handling parameters for the flight math (SpaceRocksFlight.h)
+	struct FSpaceRocksFlightParams GetFlightParams() const;
 
 	// Projectile Fire/Placement/Direction
 	FVector FireLocation;
@@ -0,0 +1,43 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "GameFramework/Actor.h"
+#include "SpaceRocksProjectile.generated.h"
+
+UCLASS(config=Game)
+class SPACEROCKS_API ASpaceRocksProjectile : public AActor
+{
+public:
+	GENERATED_UCLASS_BODY()
+
+	// Sphere collision that forms the root component
+	UPROPERTY(Category = SpaceRocksProjectile, VisibleAnywhere, BlueprintReadOnly)
+		TSubobjectPtr<class USphereComponent> CollisionComp;
+
+	// Visuals for the projectile
+	UPROPERTY(Category = SpaceRocksProjectile, VisibleAnywhere, BlueprintReadOnly)
+		TSubobjectPtr<class UStaticMeshComponent> ProjectileMesh;
+
+	// Movement
+	UPROPERTY(Category = SpaceRocksProjectile, VisibleAnywhere, BlueprintReadOnly)
+		TSubobjectPtr<class UProjectileMovementComponent> ProjectileMovement;
+
+	// Unique ID of the actor that fired us
+	UPROPERTY(Category = SpaceRocksProjectile, VisibleAnywhere, BlueprintReadOnly)
+		int32 SpawnedBy;
+
+	// Damage delt to whatever we hit
+	UPROPERTY(Category = SpaceRocksProjectile, EditAnywhere, BlueprintReadOnly)
+		float damage_delt;
+
+	// Begin AActor overrides
+	virtual void BeginPlay() override;
+	virtual void Destroyed() override;
+	virtual void ReceiveHit(class UPrimitiveComponent* MyComp, class AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
+	// End AActor overrides
+
+	// Set up a freshly spawned projectile from its weapon definition
+	void InitProjectile(int32 InSpawnedBy, float Damage, const FVector& Direction, float Speed);
+
+	// Home in on a target
+	void SetHomingTarget(AActor* Target, float Acceleration);
+};
@@ -0,0 +1,162 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+#include "SpaceRocksSnapshot.h"
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Radar Gather"), STAT_SpaceRocksRadarGather, STATGROUP_SpaceRocks, SPACEROCKS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Radar Build"), STAT_SpaceRocksRadarBuild, STATGROUP_SpaceRocks, SPACEROCKS_API);
+
+// Most grid cells along each axis
+#define MAX_RADAR_GRID_CELLS 64
+
+// What a radar contact is
+namespace ESpaceRocksRadarContact
+{
+	enum Type
+	{
+		Rock,
+		Projectile,
+		NUM_TYPES
+	};
+}
+
+// Something the radar can see, copied off the game thread
+struct FSpaceRocksRadarContact
+{
+	FVector Location;
+	FVector Velocity;
+	float Radius;
+	int32 OwnerId;	// Unique ID of the actor that fired it (projectiles), 0 otherwise
+	uint8 Type;		// ESpaceRocksRadarContact
+};
+
+// One grid cell's worth of contacts of the same type
+struct FSpaceRocksRadarBlip
+{
+	FVector Location;	// Mean position, in craft space
+	float Radius;		// Largest contact in the cell
+	int32 Count;		// Number of contacts
+	uint8 Type;			// ESpaceRocksRadarContact
+};
+
+// A contact on a collision course with the craft
+struct FSpaceRocksRadarThreat
+{
+	FVector Location;	// Craft space
+	float Distance;
+	float TimeToImpact;	// Seconds until closest approach
+	uint8 Type;			// ESpaceRocksRadarContact
+};
+
+// What the radar is looking from and how
+struct FSpaceRocksRadarParams
+{
+	FVector CraftLocation;
+	FQuat CraftRotation;	// Blips and threats are given in this frame (X forward, Z up)
+	FVector CraftVelocity;
+	float CraftRadius;
+	int32 CraftId;			// Contacts the craft owns (its own shots) are left off
+
+	float Range;			// Contacts further away than this are ignored
+	int32 GridCells;		// Grid cells along each axis (at most MAX_RADAR_GRID_CELLS)
+	int32 MaxThreats;		// Keep this many of the most urgent threats
+	float ThreatTime;		// Only count threats arriving within this many seconds
+
+	FSpaceRocksRadarParams()
+		: CraftLocation(0.f, 0.f, 0.f)
+		, CraftRotation(FQuat::Identity)
+		, CraftVelocity(0.f, 0.f, 0.f)
+		, CraftRadius(200.f)
+		, CraftId(0)
+		, Range(20000.f)
+		, GridCells(16)
+		, MaxThreats(4)
+		, ThreatTime(5.f)
+	{
+	}
+};
+
+// One radar sweep
+struct FSpaceRocksRadarResult
+{
+	TArray<FSpaceRocksRadarBlip> Blips;
+	TArray<FSpaceRocksRadarThreat> Threats;	// Soonest first
+	int32 NumContacts;						// In range
+	float Range;
+	double BuildSeconds;
+	double Time;							// FPlatformTime::Seconds() when the contacts were gathered
+
+	FSpaceRocksRadarResult()
+		: NumContacts(0)
+		, Range(0.f)
+		, BuildSeconds(0.0)
+		, Time(0.0)
+	{
+	}
+};
+
+/**
+ * Bins contacts into a coarse grid round the craft (one blip per occupied cell and type) and finds
+ * the contacts on a collision course. Cost is linear in the number of contacts.
+ */
+class SPACEROCKS_API FSpaceRocksRadar
+{
+public:
+	static void Build(const FSpaceRocksRadarParams& Params, const TArray<FSpaceRocksRadarContact>& Contacts, FSpaceRocksRadarResult& OutResult);
+};
+
+/**
+ * Builds a radar sweep on the thread pool, reading the contacts from the latest world snapshot.
+ */
+class FSpaceRocksRadarTask : public FNonAbandonableTask
+{
+public:
+	FSpaceRocksRadarTask()
+		: Result(NULL)
+	{
+	}
+
+	void DoWork();
+
+	static const TCHAR* Name() { return TEXT("FSpaceRocksRadarTask"); }
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FSpaceRocksRadarTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+	FSpaceRocksRadarParams Params;
+	FSpaceRocksSnapshotBufferPtr Snapshots;
+	TArray<FSpaceRocksRadarContact> Contacts;	// Filled in from the snapshot by the task
+	FSpaceRocksRadarResult* Result;				// Written by the task
+};
+
+/**
+ * Radar data for the HUD. At UpdateRate a sweep is built on a worker into the back buffer, from the
+ * game state's world snapshot (so the game thread copies nothing, however many local players have
+ * a radar). When it finishes the buffers are flipped, so GetResult() is always a complete sweep and
+ * the HUD never waits on the worker.
+ */
+class SPACEROCKS_API FSpaceRocksRadarProvider
+{
+public:
+	FSpaceRocksRadarProvider();
+	~FSpaceRocksRadarProvider();
+
+	// Sweeps per second
+	float UpdateRate;
+
+	// Range, grid size etc. (craft fields are filled in each sweep)
+	FSpaceRocksRadarParams Params;
+
+	// Call every frame from the game thread
+	void Update(UWorld* World, const class ASpaceRocksPawn* Pawn);
+
+	// Latest finished sweep
+	const FSpaceRocksRadarResult& GetResult() const { return Results[FrontIndex]; }
+
+private:
+	FAsyncTask<FSpaceRocksRadarTask>* Task;
+	FSpaceRocksRadarResult Results[2];
+	int32 FrontIndex;
+	double NextUpdateTime;
+};
@@ -0,0 +1,83 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "GameFramework/Actor.h"
+#include "SpaceRocksRock.generated.h"
+
+/**
+ * Base class for space rocks (BP_SpaceRock_basic etc. derive from this).
+ * Rocks register themselves with ASpaceRocksGameState, so the game-wide stages (gravity etc.) can work on all of them at once.
+ */
+UCLASS(config=Game)
+class SPACEROCKS_API ASpaceRocksRock : public AActor
+{
+public:
+	GENERATED_UCLASS_BODY()
+
+	// StaticMesh component for the rock. Simulates physics (unless the rock is query only) and forms the root.
+	UPROPERTY(Category = SpaceRocksRock, VisibleAnywhere, BlueprintReadOnly)
+		TSubobjectPtr<class UStaticMeshComponent> RockMesh;
+
+	// Mass of the rock (0 = calculate from size and Density)
+	UPROPERTY(Category = SpaceRocksRock, EditAnywhere, BlueprintReadWrite)
+		float Mass;
+
+	// Density used to calculate Mass from the rock's size
+	UPROPERTY(Category = SpaceRocksRock, EditAnywhere)
+		float Density;
+
+	// Damage the rock can take before it breaks up (0 = calculate from size and Toughness)
+	UPROPERTY(Category = SpaceRocksRock, EditAnywhere, BlueprintReadWrite)
+		float Health;
+
+	// Health per unit of radius, used to calculate Health from the rock's size
+	UPROPERTY(Category = SpaceRocksRock, EditAnywhere)
+		float Toughness;
+
+	// Bounding sphere radius of the rock
+	UPROPERTY(Category = SpaceRocksRock, VisibleAnywhere, BlueprintReadOnly)
+		float Radius;
+
+	// Procedural mesh variant in use (see ASpaceRocksRockMeshLibrary), INDEX_NONE for the authored mesh
+	UPROPERTY(Category = SpaceRocksRock, VisibleAnywhere, BlueprintReadOnly)
+		int32 MeshVariant;
+
+	// Begin AActor overrides
+	virtual void BeginPlay() override;
+	virtual void Destroyed() override;
+	// End AActor overrides
+
+	// Rock Velocity
+	UFUNCTION(BlueprintCallable, Category = SpaceRocksRock)
+		FVector GetRockVelocity() const;
+	UFUNCTION(BlueprintCallable, Category = SpaceRocksRock)
+		void SetRockVelocity(FVector NewVelocity);
+	void AddRockVelocity(const FVector& DeltaVelocity);
+
+	// Query-only rocks don't simulate. They still block projectiles, craft and traces, but pass through each other
+	// and make no physics pairs. The game state moves them at their velocity (StepKinematic).
+	void SetQueryOnly(bool bInQueryOnly);
+	bool IsQueryOnly() const { return bQueryOnly; }
+
+	// Move a query-only rock on by its velocity, sweeping it against static arena geometry and bouncing it off
+	// what it hits and off the sides of ArenaBounds (other rocks and craft don't stop it)
+	void StepKinematic(float DeltaSeconds, const FBox& ArenaBounds);
+
+	// Recalculate Radius (and Mass and Health, if they are calculated) after the rock has been scaled
+	UFUNCTION(BlueprintCallable, Category = SpaceRocksRock)
+		void UpdateRockSize();
+
+	// Proxy in the game state's target tree
+	int32 TargetProxy;
+
+private:
+
+	// Mass is calculated from size, rather than set by hand
+	bool bAutoMass;
+
+	// Health is calculated from size, rather than set by hand
+	bool bAutoHealth;
+
+	// Not simulating - moved by StepKinematic at KinematicVelocity
+	bool bQueryOnly;
+	FVector KinematicVelocity;
+};
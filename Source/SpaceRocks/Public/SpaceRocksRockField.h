@@ -0,0 +1,82 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+// Everything needed to generate a rock field. Plain data, so it can be handed to a worker thread.
+struct FSpaceRocksRockFieldParams
+{
+	// Same seed + params always gives the same field
+	int32 Seed;
+
+	// Rocks are placed (whole) inside these bounds
+	FBox ArenaBounds;
+
+	// Number of rocks to place (ASpaceRocksGameState::curr_spacerocks)
+	int32 NumRocks;
+
+	// Rock speed (ASpaceRocksGameState::curr_spacerock_speed). Each rock gets a random direction and 50-100% of this.
+	float Speed;
+
+	// Size distribution. Radii follow a power law between MinRadius and MaxRadius, so small rocks are more common
+	// the higher SizeExponent is (0 = uniform).
+	float MinRadius;
+	float MaxRadius;
+	float SizeExponent;
+
+	// Minimum gap between rock surfaces
+	float Spacing;
+
+	// Keep this sphere (e.g. round the player start) clear of rocks
+	FVector ClearCentre;
+	float ClearRadius;
+
+	// Placement attempts per rock before giving up on it
+	int32 MaxAttempts;
+
+	FSpaceRocksRockFieldParams();
+};
+
+// One placed rock
+struct FSpaceRocksRockSpawn
+{
+	FVector Location;
+	FRotator Rotation;
+	FVector Velocity;
+	float Radius;
+};
+
+/**
+ * Seeded rock field generator.
+ * Places non-overlapping rocks (3D Poisson-disk style dart throwing over a uniform grid), largest first.
+ * Generate is a pure function of the params, so it is safe to run on any thread.
+ */
+class SPACEROCKS_API FSpaceRocksRockFieldGenerator
+{
+public:
+	// Generate a rock field. Returns the number of rocks placed (may be fewer than asked for if the arena is full).
+	static int32 Generate(const FSpaceRocksRockFieldParams& Params, TArray<FSpaceRocksRockSpawn>& OutRocks);
+};
+
+/**
+ * Async task to generate a rock field on the thread pool
+ */
+class FSpaceRocksRockFieldTask : public FNonAbandonableTask
+{
+public:
+	FSpaceRocksRockFieldTask(const FSpaceRocksRockFieldParams& InParams)
+		: Params(InParams)
+		, GenerateSeconds(0.0)
+	{
+	}
+
+	void DoWork();
+
+	static const TCHAR* Name() { return TEXT("FSpaceRocksRockFieldTask"); }
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FSpaceRocksRockFieldTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+	FSpaceRocksRockFieldParams Params;
+	TArray<FSpaceRocksRockSpawn> Rocks;
+	double GenerateSeconds;
+};
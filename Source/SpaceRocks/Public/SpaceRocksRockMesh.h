@@ -0,0 +1,114 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+// Bump when the generator or file format changes, so old cache files are regenerated
+#define ROCKMESH_CACHE_VERSION 1
+
+// Radius of a generated rock before noise, matching the authored rock meshes
+#define ROCKMESH_BASE_RADIUS 100.f
+
+// Everything that determines the shape of a generated rock
+struct FSpaceRocksRockMeshParams
+{
+	int32 Seed;
+	int32 Subdivisions;		// Icosphere subdivisions for LOD 0
+	int32 NumLODs;			// Each LOD has one fewer subdivision
+	float NoiseAmplitude;	// Displacement as a fraction of the radius
+	float NoiseFrequency;	// Noise features per unit radius
+	int32 NoiseOctaves;
+	float MaxStretch;		// Random squash/stretch per axis (0 = round)
+
+	FSpaceRocksRockMeshParams();
+
+	// Key for the cache file name, covering seed and all params (hashed, so two param sets can share a key)
+	FString GetCacheKey() const;
+
+	// Exactly the same params, field by field
+	bool operator==(const FSpaceRocksRockMeshParams& Other) const;
+
+	friend FArchive& operator<<(FArchive& Ar, FSpaceRocksRockMeshParams& Params);
+};
+
+// One LOD of a generated rock. Vertices are shared (smooth shaded).
+struct FSpaceRocksRockMeshLOD
+{
+	TArray<FVector> Positions;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	TArray<int32> Indices;
+
+	friend FArchive& operator<<(FArchive& Ar, FSpaceRocksRockMeshLOD& LOD);
+};
+
+// A complete generated rock: all LODs plus simple collision
+struct FSpaceRocksRockMeshData
+{
+	FSpaceRocksRockMeshParams Params;
+	TArray<FSpaceRocksRockMeshLOD> LODs;
+
+	// Mean radius, and the simple collision sphere if the hull is degenerate
+	float CollisionRadius;
+
+	// Simple collision convex hull (the lowest LOD's vertices)
+	TArray<FVector> ConvexHull;
+
+	friend FArchive& operator<<(FArchive& Ar, FSpaceRocksRockMeshData& Data);
+};
+
+/**
+ * Generates rock meshes as noise displaced, subdivided icospheres. Pure function of the params, safe on any thread.
+ */
+class SPACEROCKS_API FSpaceRocksRockMeshGenerator
+{
+public:
+	static void Generate(const FSpaceRocksRockMeshParams& Params, FSpaceRocksRockMeshData& OutData);
+};
+
+/**
+ * On-disk cache of generated rock meshes (Saved/RockMeshCache), keyed by seed and params
+ */
+class SPACEROCKS_API FSpaceRocksRockMeshCache
+{
+public:
+	static FString GetCachePath(const FSpaceRocksRockMeshParams& Params);
+
+	// Load a mesh from the cache. Returns false if it isn't there (or is out of date).
+	static bool Load(const FSpaceRocksRockMeshParams& Params, FSpaceRocksRockMeshData& OutData);
+
+	static bool Save(FSpaceRocksRockMeshData& Data);
+
+	// Load from the cache, or generate and save
+	static void FindOrGenerate(const FSpaceRocksRockMeshParams& Params, FSpaceRocksRockMeshData& OutData, bool& bOutFromCache);
+
+	// Build a renderable static mesh from generated data (needs the editor to build meshes, returns NULL otherwise)
+	static class UStaticMesh* CreateStaticMesh(const FSpaceRocksRockMeshData& Data, UObject* Outer, class UMaterialInterface* Material);
+};
+
+/**
+ * Async task to load or generate a set of rock mesh variants on the thread pool
+ */
+class FSpaceRocksRockMeshTask : public FNonAbandonableTask
+{
+public:
+	FSpaceRocksRockMeshTask(const FSpaceRocksRockMeshParams& InBaseParams, int32 InNumVariants)
+		: BaseParams(InBaseParams)
+		, NumVariants(InNumVariants)
+		, NumFromCache(0)
+		, TaskSeconds(0.0)
+	{
+	}
+
+	void DoWork();
+
+	static const TCHAR* Name() { return TEXT("FSpaceRocksRockMeshTask"); }
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FSpaceRocksRockMeshTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+	FSpaceRocksRockMeshParams BaseParams;
+	int32 NumVariants;
+	TArray<FSpaceRocksRockMeshData> Variants;
+	int32 NumFromCache;
+	double TaskSeconds;
+};
@@ -0,0 +1,80 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "GameFramework/Actor.h"
+#include "SpaceRocksRockMesh.h"
+#include "SpaceRocksRockMeshLibrary.generated.h"
+
+/**
+ * Generates (or loads from the cache) a set of procedural rock mesh variants and hands them out to rocks.
+ * With instanced rendering on, rocks keep their physics/collision but are drawn through one instanced
+ * component per variant, so draw calls depend on the number of variants rather than the number of rocks.
+ */
+UCLASS(config=Game)
+class SPACEROCKS_API ASpaceRocksRockMeshLibrary : public AActor
+{
+public:
+	GENERATED_UCLASS_BODY()
+
+	// Number of rock variants to generate
+	UPROPERTY(Category = SpaceRocksRockMesh, EditAnywhere)
+		int32 NumVariants;
+
+	// Variant N uses seed BaseSeed + N
+	UPROPERTY(Category = SpaceRocksRockMesh, EditAnywhere)
+		int32 BaseSeed;
+
+	// Icosphere subdivisions for LOD 0
+	UPROPERTY(Category = SpaceRocksRockMesh, EditAnywhere)
+		int32 Subdivisions;
+
+	// Number of LODs (each has one fewer subdivision)
+	UPROPERTY(Category = SpaceRocksRockMesh, EditAnywhere)
+		int32 NumLODs;
+
+	// Noise displacement as a fraction of the radius
+	UPROPERTY(Category = SpaceRocksRockMesh, EditAnywhere)
+		float NoiseAmplitude;
+
+	// Noise features per unit radius
+	UPROPERTY(Category = SpaceRocksRockMesh, EditAnywhere)
+		float NoiseFrequency;
+
+	// Material for the generated rocks
+	UPROPERTY(Category = SpaceRocksRockMesh, EditAnywhere)
+		class UMaterialInterface* RockMaterial;
+
+	// Draw rocks through instanced components instead of their own mesh components
+	UPROPERTY(Category = SpaceRocksRockMesh, EditAnywhere)
+		bool bInstancedRendering;
+
+	// Generated meshes, one per variant
+	UPROPERTY(Category = SpaceRocksRockMesh, VisibleAnywhere, Transient)
+		TArray<class UStaticMesh*> VariantMeshes;
+
+	// Instanced component for each variant
+	UPROPERTY(Transient)
+		TArray<class UInstancedStaticMeshComponent*> VariantInstances;
+
+	// Begin AActor overrides
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// End AActor overrides
+
+	// Have the variants finished loading/generating?
+	UFUNCTION(BlueprintCallable, Category = SpaceRocksRockMesh)
+		bool IsReady() const { return VariantMeshes.Num() > 0; }
+
+	// Give a rock one of the variants (chosen from its seed)
+	void AssignVariant(class ASpaceRocksRock* Rock, int32 RockSeed);
+
+protected:
+
+	// Turn the finished task's mesh data into static meshes and instanced components
+	void FinishVariants();
+
+	// Copy rock transforms into the instanced components
+	void UpdateInstances();
+
+	FAsyncTask<FSpaceRocksRockMeshTask>* MeshTask;
+};
@@ -0,0 +1,187 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Snapshot Publish"), STAT_SpaceRocksSnapshotPublish, STATGROUP_SpaceRocks, SPACEROCKS_API);
+
+// A player craft, as of the snapshot
+struct FSpaceRocksCraftSnapshot
+{
+	int32 Id;				// Unique ID of the pawn
+	FVector Location;
+	FQuat Rotation;			// Of the craft mesh (the root never rotates)
+	FVector Velocity;
+	FRotator TurnRate;		// Degrees per second
+	float Radius;
+	float ShieldLevel;
+};
+
+// A rock, as of the snapshot
+struct FSpaceRocksRockSnapshot
+{
+	int32 Id;				// Unique ID of the rock
+	FVector Location;
+	FVector Velocity;
+	float Radius;
+	float Health;
+};
+
+// A projectile, as of the snapshot
+struct FSpaceRocksProjectileSnapshot
+{
+	int32 OwnerId;			// Unique ID of the actor that fired it
+	FVector Location;
+	FVector Velocity;
+	float Radius;
+};
+
+// Everything a reader off the game thread might want about one frame. Never changes once published.
+struct FSpaceRocksWorldSnapshot
+{
+	uint64 Frame;			// GFrameCounter when it was taken
+	double WorldTime;
+	float DeltaSeconds;
+
+	// Level
+	int32 Level;
+	int32 NumLevels;
+	int32 Arena;
+	FName ArenaName;
+	float RockSpeed;
+	int32 RocksPerLevel;
+
+	TArray<FSpaceRocksCraftSnapshot> Craft;
+	TArray<FSpaceRocksRockSnapshot> Rocks;
+	TArray<FSpaceRocksProjectileSnapshot> Projectiles;
+
+	// Written last - equal to Frame in a snapshot that was completely written before it was read
+	uint64 EndFrame;
+
+	FSpaceRocksWorldSnapshot()
+		: Frame(0)
+		, WorldTime(0.0)
+		, DeltaSeconds(0.f)
+		, Level(0)
+		, NumLevels(0)
+		, Arena(0)
+		, ArenaName(NAME_None)
+		, RockSpeed(0.f)
+		, RocksPerLevel(0)
+		, EndFrame(0)
+	{
+	}
+};
+
+/**
+ * Triple buffered world snapshots. The game thread writes the next snapshot into a slot no reader
+ * holds and then publishes it with one atomic exchange. Readers on any thread pin the latest slot
+ * with a counter, so they always see a whole frame and never take a lock or hold up the game thread.
+ *
+ * The writer never waits: if readers are holding every slot but the latest, that frame simply isn't
+ * published (GetNumSkipped), and readers keep seeing the previous one.
+ */
+class SPACEROCKS_API FSpaceRocksSnapshotBuffer
+{
+public:
+	enum { NUM_SLOTS = 3 };
+
+	FSpaceRocksSnapshotBuffer();
+
+	// ** Game thread **
+
+	// Snapshot to fill in, or NULL if there is no free slot this frame. Must be followed by EndPublish.
+	FSpaceRocksWorldSnapshot* BeginPublish();
+
+	// Make the snapshot from BeginPublish the latest
+	void EndPublish();
+
+	// Frames that couldn't be published because readers held the slots
+	int32 GetNumSkipped() const { return NumSkipped; }
+
+	// ** Any thread **
+
+	// Pin the latest snapshot. Returns its slot, or INDEX_NONE if nothing has been published yet.
+	int32 Acquire();
+	void Release(int32 Slot);
+
+	const FSpaceRocksWorldSnapshot& Get(int32 Slot) const { return Slots[Slot]; }
+
+private:
+
+	FSpaceRocksWorldSnapshot Slots[NUM_SLOTS];
+
+	// Readers holding each slot
+	FThreadSafeCounter Readers[NUM_SLOTS];
+
+	// Slot of the latest published snapshot (INDEX_NONE before the first)
+	volatile int32 Latest;
+
+	// Slot being written by the game thread
+	int32 Writing;
+
+	int32 NumSkipped;
+};
+
+typedef TSharedPtr<FSpaceRocksSnapshotBuffer, ESPMode::ThreadSafe> FSpaceRocksSnapshotBufferPtr;
+
+/**
+ * Reads the latest snapshot for as long as it is in scope:
+ *
+ *     FSpaceRocksSnapshotReader Snapshot(*Buffer);
+ *     if (Snapshot.IsValid()) { ... Snapshot->Rocks ... }
+ */
+class SPACEROCKS_API FSpaceRocksSnapshotReader
+{
+public:
+	explicit FSpaceRocksSnapshotReader(FSpaceRocksSnapshotBuffer& InBuffer)
+		: Buffer(InBuffer)
+		, Slot(InBuffer.Acquire())
+	{
+	}
+
+	~FSpaceRocksSnapshotReader()
+	{
+		if (Slot != INDEX_NONE)
+		{
+			Buffer.Release(Slot);
+		}
+	}
+
+	bool IsValid() const { return Slot != INDEX_NONE; }
+
+	const FSpaceRocksWorldSnapshot& operator*() const { return Buffer.Get(Slot); }
+	const FSpaceRocksWorldSnapshot* operator->() const { return &Buffer.Get(Slot); }
+
+private:
+	FSpaceRocksSnapshotBuffer& Buffer;
+	int32 Slot;
+
+	// Pins can't be shared
+	FSpaceRocksSnapshotReader(const FSpaceRocksSnapshotReader&);
+	FSpaceRocksSnapshotReader& operator=(const FSpaceRocksSnapshotReader&);
+};
+
+/**
+ * Reads snapshots flat out on a worker for a while and checks every one is whole and newer than or
+ * the same as the last. Logs what it saw when it finishes.
+ */
+class FSpaceRocksSnapshotCheckTask : public FNonAbandonableTask
+{
+public:
+	FSpaceRocksSnapshotCheckTask(const FSpaceRocksSnapshotBufferPtr& InBuffer, float InSeconds)
+		: Buffer(InBuffer)
+		, Seconds(InSeconds)
+	{
+	}
+
+	void DoWork();
+
+	static const TCHAR* Name() { return TEXT("FSpaceRocksSnapshotCheckTask"); }
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FSpaceRocksSnapshotCheckTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+private:
+	FSpaceRocksSnapshotBufferPtr Buffer;
+	float Seconds;
+};
@@ -0,0 +1,125 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "GameFramework/Actor.h"
+#include "SpaceRocksSoakTest.generated.h"
+
+// One periodic sample taken during a soak run
+struct FSpaceRocksSoakSample
+{
+	double Time;			// Seconds since the run started
+	float UsedMemoryMB;		// Used physical memory
+	int32 NumObjects;		// Live UObjects
+	int32 NumActors;		// Actors in the world
+	int32 NumRocks;			// Registered rocks
+	int32 NumProjectiles;	// Registered projectiles
+	float FrameTimeP50;		// Frame time percentiles over the interval, in ms
+	float FrameTimeP95;
+	float FrameTimeP99;
+	float InputLatencyP95;	// Craft input to applied, over the run so far, in ms
+	float PhysicsKickoffToFetchMs;	// Mean physics kickoff to fetch time over the interval
+	float ContactPairs;		// Mean physics contact pairs over the interval
+	int32 Level;			// ASpaceRocksGameState::curr_level
+};
+
+/**
+ * Long running soak test.
+ * Flies the player's craft on autopilot (through its own thrust/rotation/fire handlers), moves through the levels
+ * forever and samples memory, object counts and frame time percentiles. The run fails when any trend's slope
+ * (fitted over the samples after warmup) goes over its configured limit.
+ *
+ * Started by the game mode when the game is run with -SpaceRocksSoak (e.g. with -game -nullrhi).
+ * -SoakDuration=<seconds> ends a passing run after that long. A failing run logs "Soak test FAILED" and exits.
+ * Samples are written to Saved/Soak/ as CSV.
+ */
+UCLASS(config=Game)
+class SPACEROCKS_API ASpaceRocksSoakTest : public AActor
+{
+public:
+	GENERATED_UCLASS_BODY()
+
+	// Seconds between samples
+	UPROPERTY(Category = SpaceRocksSoak, EditAnywhere, config)
+		float SampleInterval;
+
+	// Samples before this time are ignored when fitting trends (level loading, caches warming up etc.)
+	UPROPERTY(Category = SpaceRocksSoak, EditAnywhere, config)
+		float WarmupSeconds;
+
+	// Number of post-warmup samples needed before trends are checked
+	UPROPERTY(Category = SpaceRocksSoak, EditAnywhere, config)
+		int32 MinTrendSamples;
+
+	// Allowed growth in used memory, MB per hour
+	UPROPERTY(Category = SpaceRocksSoak, EditAnywhere, config)
+		float MaxMemorySlopeMBPerHour;
+
+	// Allowed growth in live UObjects, per hour
+	UPROPERTY(Category = SpaceRocksSoak, EditAnywhere, config)
+		float MaxObjectSlopePerHour;
+
+	// Allowed growth in live actors, per hour
+	UPROPERTY(Category = SpaceRocksSoak, EditAnywhere, config)
+		float MaxActorSlopePerHour;
+
+	// Allowed growth in p99 frame time, ms per hour
+	UPROPERTY(Category = SpaceRocksSoak, EditAnywhere, config)
+		float MaxFrameTimeSlopeMsPerHour;
+
+	// Move on to the next level after this long, even if rocks are left
+	UPROPERTY(Category = SpaceRocksSoak, EditAnywhere, config)
+		float LevelTimeLimit;
+
+	// Has the run failed?
+	UPROPERTY(Category = SpaceRocksSoak, VisibleAnywhere, BlueprintReadOnly)
+		bool bFailed;
+
+	// Begin AActor overrides
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+	// End AActor overrides
+
+	// Should a soak run be started (from the command line)?
+	static bool IsSoakRequested();
+
+	// Log the latest sample and trend slopes
+	void LogReport() const;
+
+protected:
+
+	// ** Autopilot **
+
+	// Fly towards (and shoot at) the nearest rock, steering round anything in the way
+	void UpdateAutopilot(class ASpaceRocksPawn* Pawn, float DeltaSeconds);
+
+	// Move on to the next level when the rocks are gone or time is up
+	void UpdateLevels();
+
+	// ** Sampling **
+
+	void TakeSample();
+	void CheckTrends();
+
+	// Least squares slope (per hour) of one value per sample against sample time, ignoring samples before warmup
+	double FitSlope(const TArray<double>& Values) const;
+
+	TArray<FSpaceRocksSoakSample> Samples;
+	TArray<float> FrameTimes;	// Frame times (ms) since the last sample
+
+	// Physics steps since the last sample
+	double PhysicsKickoffToFetchMsSum;
+	double ContactPairsSum;
+	int32 NumPhysicsFrames;
+
+	double StartTime;
+	double LastFrameTime;
+	double NextSampleTime;
+	double LevelStartTime;
+	double SoakDuration;	// 0 = forever
+
+	FString CsvPath;
+
+	// Autopilot state
+	TWeakObjectPtr<class ASpaceRocksPawn> ControlledPawn;
+	float WeaponSwitchTimer;
+	int32 AutopilotWeapon;
+};
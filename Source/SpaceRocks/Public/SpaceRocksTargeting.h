@@ -0,0 +1,163 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Target Refit"), STAT_SpaceRocksTargetRefit, STATGROUP_SpaceRocks, SPACEROCKS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Target Query"), STAT_SpaceRocksTargetQuery, STATGROUP_SpaceRocks, SPACEROCKS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Target Ray Cast"), STAT_SpaceRocksTargetRayCast, STATGROUP_SpaceRocks, SPACEROCKS_API);
+
+// Cone to look for targets in
+struct FSpaceRocksTargetCone
+{
+	FVector Origin;
+	FVector Direction;		// Unit length
+	float CosHalfAngle;
+	float SinHalfAngle;
+	float MaxRange;
+	const AActor* IgnoreActor;
+
+	FSpaceRocksTargetCone(const FVector& InOrigin, const FVector& InDirection, float HalfAngleDegrees, float InMaxRange, const AActor* InIgnoreActor = NULL)
+		: Origin(InOrigin)
+		, Direction(InDirection.SafeNormal())
+		, CosHalfAngle(FMath::Cos(FMath::DegreesToRadians(FMath::Clamp(HalfAngleDegrees, 0.f, 90.f))))
+		, SinHalfAngle(FMath::Sin(FMath::DegreesToRadians(FMath::Clamp(HalfAngleDegrees, 0.f, 90.f))))
+		, MaxRange(InMaxRange)
+		, IgnoreActor(InIgnoreActor)
+	{
+	}
+};
+
+// A target found by a cone query
+struct FSpaceRocksTargetHit
+{
+	int32 Proxy;
+	AActor* Actor;
+	float Distance;		// Origin to target centre
+};
+
+// A ray to cast against the targets
+struct FSpaceRocksTargetRay
+{
+	FVector Origin;
+	FVector Direction;		// Unit length
+	float Length;
+	const AActor* IgnoreActor;
+
+	FSpaceRocksTargetRay(const FVector& InOrigin, const FVector& InDirection, float InLength, const AActor* InIgnoreActor = NULL)
+		: Origin(InOrigin)
+		, Direction(InDirection.SafeNormal())
+		, Length(InLength)
+		, IgnoreActor(InIgnoreActor)
+	{
+	}
+};
+
+// The nearest target a ray hit
+struct FSpaceRocksTargetRayHit
+{
+	int32 Ray;			// Index of the ray in the batch
+	int32 Proxy;		// INDEX_NONE if it hit nothing (or, from ASpaceRocksGameState::CastRays, hit static geometry)
+	AActor* Actor;
+	float Distance;		// Along the ray to where it enters the target's sphere (0 if it starts inside, the ray's Length if it hit nothing)
+};
+
+/**
+ * Dynamic bounding volume hierarchy over lock-on targets (rocks and craft).
+ * Each target is a leaf with a "fat" box - its bounds grown by a margin and stretched along its last
+ * move. Moving a target only touches the tree when it leaves its fat box, so refitting every target
+ * each frame is mostly a containment test. Reinserted leaves pick the cheapest sibling by surface area,
+ * and the tree is kept balanced with rotations (so depth stays O(log n)).
+ */
+class SPACEROCKS_API FSpaceRocksTargetBVH
+{
+public:
+	FSpaceRocksTargetBVH();
+
+	// Fat box margin round each target
+	float FatMargin;
+
+	// Fat boxes are stretched this many frames along the target's last move
+	float DisplacementMultiplier;
+
+	// Add a target (a sphere). Returns its proxy id.
+	int32 CreateProxy(const FVector& Centre, float Radius, AActor* Actor);
+	void DestroyProxy(int32 Proxy);
+
+	// Move a target. Returns true if it left its fat box and was reinserted.
+	bool MoveProxy(int32 Proxy, const FVector& Centre, float Radius, const FVector& Displacement);
+
+	AActor* GetActor(int32 Proxy) const { return Nodes[Proxy].Actor; }
+
+	/**
+	 * Find up to MaxHits of the nearest targets that touch the cone, nearest first.
+	 * Doesn't allocate (the traversal stack is inline) and is safe to run from several threads at once.
+	 * Returns the number of hits written to OutHits.
+	 */
+	int32 QueryCone(const FSpaceRocksTargetCone& Cone, FSpaceRocksTargetHit* OutHits, int32 MaxHits) const;
+
+	// Brute force version of QueryCone, for checking the tree
+	int32 QueryConeExact(const FSpaceRocksTargetCone& Cone, FSpaceRocksTargetHit* OutHits, int32 MaxHits) const;
+
+	/**
+	 * Find the nearest target (as a sphere) along each of a batch of rays. OutHits gets one entry per ray, in ray order,
+	 * with Proxy INDEX_NONE for rays that hit nothing. The rays go down the tree together: each node filters the list of
+	 * rays that reach it, so nodes are fetched once per batch rather than once per ray, and each ray is clipped to its
+	 * nearest hit so far. Safe to run from several threads at once.
+	 */
+	void RayCastBatch(const FSpaceRocksTargetRay* Rays, int32 NumRays, FSpaceRocksTargetRayHit* OutHits) const;
+
+	// Brute force version of RayCastBatch, for checking the tree
+	void RayCastExact(const FSpaceRocksTargetRay* Rays, int32 NumRays, FSpaceRocksTargetRayHit* OutHits) const;
+
+	int32 NumProxies() const { return ProxyCount; }
+	int32 GetHeight() const { return (Root == INDEX_NONE) ? 0 : Nodes[Root].Height; }
+
+	// Build, refit and query trees of 1k, 10k and 100k targets, logging the times
+	static void RunBenchmark(int32 NumQueries, int32 MaxHits, float HalfAngleDegrees);
+
+	// Cast shotgun blasts of RaysPerBlast rays into trees of 1k, 10k and 100k targets, batched and one ray at a time, logging the times
+	static void RunRayBenchmark(int32 NumBlasts, int32 RaysPerBlast);
+
+private:
+	struct FNode
+	{
+		FBox Bounds;		// Fat box for leaves
+		FVector Centre;		// Leaves only - the target itself
+		float Radius;
+		AActor* Actor;
+		int32 Parent;		// Next free node when on the free list
+		int32 Child1;		// INDEX_NONE for leaves
+		int32 Child2;
+		int32 Height;		// Leaves are 0, free nodes -1
+
+		bool IsLeaf() const { return Child1 == INDEX_NONE; }
+	};
+
+	int32 AllocateNode();
+	void FreeNode(int32 Node);
+
+	void InsertLeaf(int32 Leaf);
+	void RemoveLeaf(int32 Leaf);
+
+	// Rotate the subtree at A if it is unbalanced. Returns the subtree's new root.
+	int32 Balance(int32 A);
+
+	// Does a sphere touch the cone? Exact.
+	static bool SphereInCone(const FSpaceRocksTargetCone& Cone, const FVector& Centre, float Radius);
+
+	// Might a sphere touch the cone? Never false when it does, but can be true behind the apex. For culling nodes.
+	static bool SphereMayTouchCone(const FSpaceRocksTargetCone& Cone, const FVector& Centre, float Radius);
+
+	// SphereInCone worked out from angles seen from the apex instead, for QueryConeExact
+	static bool SphereInConeByAngle(const FSpaceRocksTargetCone& Cone, const FVector& Centre, float Radius);
+
+	// Distance along a ray to where it enters a sphere (0 if it starts inside), or -1 if it misses
+	static float RaySphere(const FSpaceRocksTargetRay& Ray, const FVector& Centre, float Radius);
+
+	// Insert a hit into the sorted hit list, keeping at most MaxHits
+	static void AddHit(FSpaceRocksTargetHit* Hits, int32& NumHits, int32 MaxHits, const FSpaceRocksTargetHit& Hit);
+
+	TArray<FNode> Nodes;
+	int32 Root;
+	int32 FreeList;
+	int32 ProxyCount;
+};
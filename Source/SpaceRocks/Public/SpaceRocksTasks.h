@@ -0,0 +1,83 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "TaskGraphInterfaces.h"
+
+/**
+ * Task graph task that runs Body(Index) for a range of indices.
+ */
+template<typename BodyType>
+class TSpaceRocksParallelForTask
+{
+public:
+	TSpaceRocksParallelForTask(const BodyType& InBody, int32 InBegin, int32 InEnd)
+		: Body(InBody)
+		, Begin(InBegin)
+		, End(InEnd)
+	{
+	}
+
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(TSpaceRocksParallelForTask, STATGROUP_TaskGraphTasks);
+	}
+
+	static ENamedThreads::Type GetDesiredThread() { return ENamedThreads::AnyThread; }
+	static ESubsequentsMode::Type GetSubsequentsMode() { return ESubsequentsMode::TrackSubsequents; }
+
+	void DoTask(ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+	{
+		for (int32 Index = Begin; Index < End; Index++)
+		{
+			Body(Index);
+		}
+	}
+
+private:
+	const BodyType& Body;
+	int32 Begin;
+	int32 End;
+};
+
+/**
+ * Run Body(Index) for every Index in [0, Num) on the task graph worker threads.
+ * The calling thread takes the last batch itself, then blocks until all batches are done.
+ * Body must be safe to call concurrently for different indices.
+ */
+template<typename BodyType>
+void SpaceRocksParallelFor(int32 Num, const BodyType& Body, int32 MinBatchSize = 64)
+{
+	if (Num <= 0)
+	{
+		return;
+	}
+
+	const int32 NumWorkers = FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads(), 1);
+	const int32 NumBatches = FMath::Clamp(Num / FMath::Max(MinBatchSize, 1), 1, NumWorkers * 4);
+
+	if (NumBatches == 1 || !FPlatformProcess::SupportsMultithreading())
+	{
+		for (int32 Index = 0; Index < Num; Index++)
+		{
+			Body(Index);
+		}
+		return;
+	}
+
+	const int32 BatchSize = (Num + NumBatches - 1) / NumBatches;
+
+	FGraphEventArray Tasks;
+	int32 Begin = 0;
+	while (Begin + BatchSize < Num)
+	{
+		Tasks.Add(TGraphTask< TSpaceRocksParallelForTask<BodyType> >::CreateTask().ConstructAndDispatchWhenReady(Body, Begin, Begin + BatchSize));
+		Begin += BatchSize;
+	}
+
+	// Do the last batch ourselves rather than sit idle
+	for (int32 Index = Begin; Index < Num; Index++)
+	{
+		Body(Index);
+	}
+
+	FTaskGraphInterface::Get().WaitUntilTasksComplete(Tasks);
+}
@@ -0,0 +1,171 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+// Compile gameplay event tracing in (it is still switched on and off at runtime)
+#ifndef SPACEROCKS_TRACE
+#define SPACEROCKS_TRACE 1
+#endif
+
+// Gameplay event types. Must match EVENT_NAMES in Tools/SpaceRocksTrace/srtrace_to_chrome.py
+namespace ESpaceRocksTraceEvent
+{
+	enum Type
+	{
+		Frame,			// Start of the game state tick (a frame runs until the next one), Values[0] = frame delta seconds
+		Scope,			// Subject = ESpaceRocksTraceScope, Values[0] = duration seconds
+		Spawn,			// Subject = actor id, Values = location, radius
+		Destroy,		// Subject = actor id
+		Hit,			// Subject = actor id, Values = location, impulse
+		Fire,			// Subject = actor id, Values[0] = weapon id, Values[1] = slot
+		Thrust,			// Subject = axis (0 rear, 1 side, 2 bottom), Values[0] = input
+		WeaponSelect,	// Subject = actor id, Values[0] = slot
+		LevelChange,	// Subject = level, Values[0] = rocks
+		InputLatency,	// Subject = ESpaceRocksControl, Values[0] = seconds from input to applied
+		NUM_EVENTS
+	};
+}
+
+// Timed sections recorded as Scope events. Must match SCOPE_NAMES in the converter
+namespace ESpaceRocksTraceScope
+{
+	enum Type
+	{
+		Gravity,
+		RockFieldSpawn,
+		RockInstances,
+		Debris,
+		Damage,
+		Hitscan,
+		NUM_SCOPES
+	};
+}
+
+/**
+ * One traced event - 32 bytes, written to the trace file as is (little endian):
+ * double Time, uint16 Type, uint16 Flags, int32 Subject, float Values[4]
+ */
+struct FSpaceRocksTraceEvent
+{
+	double Time;		// FPlatformTime::Seconds()
+	uint16 Type;		// ESpaceRocksTraceEvent
+	uint16 Flags;
+	int32 Subject;
+	float Values[4];
+};
+
+/**
+ * Fixed size ring of events owned by one thread. Only the owning thread writes, so recording is a
+ * plain store plus a barrier before the write index is published. Readers copy the ring and throw
+ * away anything the writer lapped while they were copying.
+ */
+class FSpaceRocksTraceBuffer
+{
+public:
+	FSpaceRocksTraceBuffer(uint32 InThreadId, bool bInGameThread, int32 CapacityLog2);
+
+	FORCEINLINE void Record(uint16 Type, int32 Subject, float V0, float V1, float V2, float V3)
+	{
+		const int64 Index = WriteIndex;
+		FSpaceRocksTraceEvent& Event = Events[(int32)(Index & Mask)];
+		Event.Time = FPlatformTime::Seconds();
+		Event.Type = Type;
+		Event.Flags = 0;
+		Event.Subject = Subject;
+		Event.Values[0] = V0;
+		Event.Values[1] = V1;
+		Event.Values[2] = V2;
+		Event.Values[3] = V3;
+
+		FPlatformMisc::MemoryBarrier();
+		WriteIndex = Index + 1;
+	}
+
+	// Copy out the events still in the ring, oldest first (safe to call from any thread)
+	void Snapshot(TArray<FSpaceRocksTraceEvent>& OutEvents) const;
+
+	const uint32 ThreadId;
+	const bool bGameThread;
+
+private:
+	TArray<FSpaceRocksTraceEvent> Events;
+	int64 Mask;
+	volatile int64 WriteIndex;
+};
+
+/**
+ * Low overhead binary trace of gameplay events (hits, spawns, fires, thrust changes, level changes,
+ * frame times and a few timed sections). Each thread records into its own ring buffer, so nothing
+ * is locked or formatted on the hot path and tracing can be left on. Flush() writes every thread's
+ * ring to a .srtrace file, which Tools/SpaceRocksTrace/srtrace_to_chrome.py turns into Chrome/Perfetto
+ * trace JSON.
+ *
+ * On from module startup. -NoSpaceRocksTrace (or the TraceEnable console command) turns it off.
+ */
+class SPACEROCKS_API FSpaceRocksTrace
+{
+public:
+	// Events kept per thread, as a power of two (2^14 events = 512KB)
+	static const int32 BufferSizeLog2 = 14;
+
+	// Set up the per-thread buffers and switch tracing on. Called once, from the module's startup, before any thread records.
+	static void Startup();
+
+	static bool IsEnabled() { return bEnabled; }
+	static void SetEnabled(bool bInEnabled) { bEnabled = bInEnabled; }
+
+	FORCEINLINE static void Record(ESpaceRocksTraceEvent::Type Type, int32 Subject, float V0 = 0.f, float V1 = 0.f, float V2 = 0.f, float V3 = 0.f)
+	{
+		if (bEnabled)
+		{
+			GetThreadBuffer()->Record((uint16)Type, Subject, V0, V1, V2, V3);
+		}
+	}
+
+	// Write all threads' events to Filename. Returns the number of events written, or -1 on failure.
+	static int32 Flush(const FString& Filename);
+
+	// Default file name for a flush, in Saved/Traces
+	static FString GetDefaultFilename();
+
+private:
+	// This thread's buffer, created the first time the thread records anything
+	static FSpaceRocksTraceBuffer* GetThreadBuffer();
+
+	static bool bEnabled;
+
+	// TLS slot holding each thread's buffer
+	static uint32 TlsSlot;
+};
+
+/**
+ * Records a Scope event with the time spent between construction and destruction.
+ */
+class FSpaceRocksTraceScope
+{
+public:
+	FSpaceRocksTraceScope(ESpaceRocksTraceScope::Type InScope)
+		: Scope(InScope)
+		, StartTime(FSpaceRocksTrace::IsEnabled() ? FPlatformTime::Seconds() : 0.0)
+	{
+	}
+
+	~FSpaceRocksTraceScope()
+	{
+		if (StartTime > 0.0)
+		{
+			FSpaceRocksTrace::Record(ESpaceRocksTraceEvent::Scope, Scope, (float)(FPlatformTime::Seconds() - StartTime));
+		}
+	}
+
+private:
+	ESpaceRocksTraceScope::Type Scope;
+	double StartTime;
+};
+
+#if SPACEROCKS_TRACE
+	#define SPACEROCKS_TRACE_EVENT(Type, Subject, ...) FSpaceRocksTrace::Record(ESpaceRocksTraceEvent::Type, Subject, ##__VA_ARGS__)
+	#define SPACEROCKS_TRACE_SCOPE(Scope) FSpaceRocksTraceScope SpaceRocksTraceScope_##Scope(ESpaceRocksTraceScope::Scope)
+#else
+	#define SPACEROCKS_TRACE_EVENT(Type, Subject, ...)
+	#define SPACEROCKS_TRACE_SCOPE(Scope)
+#endif
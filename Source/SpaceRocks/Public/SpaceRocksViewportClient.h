@@ -0,0 +1,21 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "Engine/GameViewportClient.h"
+#include "SpaceRocksViewportClient.generated.h"
+
+/**
+ * Game viewport client that notes when each controller's input events arrive, before they are queued for the
+ * player controllers, so input latency can be timed from arrival (see FSpaceRocksInputLatency).
+ * Set as GameViewportClientClassName in DefaultEngine.ini.
+ */
+UCLASS()
+class USpaceRocksViewportClient : public UGameViewportClient
+{
+public:
+	GENERATED_UCLASS_BODY()
+
+	// Begin UGameViewportClient overrides
+	virtual bool InputKey(FViewport* Viewport, int32 ControllerId, FKey Key, EInputEvent EventType, float AmountDepressed = 1.f, bool bGamepad = false) override;
+	virtual bool InputAxis(FViewport* Viewport, int32 ControllerId, FKey Key, float Delta, float DeltaTime, int32 NumSamples = 1, bool bGamepad = false) override;
+	// End UGameViewportClient overrides
+};
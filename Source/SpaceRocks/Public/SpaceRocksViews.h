@@ -0,0 +1,36 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+
+// Where one local player is looking from
+struct FSpaceRocksView
+{
+	FVector Location;
+	FVector Forward;		// Unit length
+	float CosHalfFOV;
+	float SinHalfFOV;
+	int32 PlayerIndex;		// Local player, 0 for the first
+};
+
+/**
+ * The local players' views for this frame, gathered once and shared by everything that makes
+ * per-view detail decisions. Each decision is made per view and merged (visible in any view,
+ * nearest of all views), so split-screen costs one pass over the objects rather than one per player.
+ */
+class SPACEROCKS_API FSpaceRocksViewSet
+{
+public:
+
+	// Gather the view of every local player with a camera
+	void Gather(UWorld* World);
+
+	// Is a sphere within CullDistance and inside any view's cone? OutDistance is the distance to the nearest view.
+	// With no views (e.g. a dedicated server) everything is visible, measured from the origin.
+	bool IsVisible(const FVector& Centre, float Radius, float CullDistance, float& OutDistance) const;
+
+	int32 Num() const { return Views.Num(); }
+	const FSpaceRocksView& operator[](int32 Index) const { return Views[Index]; }
+
+private:
+
+	TArray<FSpaceRocksView, TInlineAllocator<4> > Views;
+};
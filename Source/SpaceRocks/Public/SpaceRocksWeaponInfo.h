@@ -0,0 +1,165 @@
+// Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "Engine/DataTable.h"
+#include "SpaceRocksWeaponInfo.generated.h"
+
+// Number of weapon slots (mapped to the Weap1 - Weap0 keys)
+#define NUM_WEAP_SLOTS 10
+
+// Maximum shield level for a player's craft
+#define MAX_LOCK_TARGETS 16
+#define MAX_SHIELD 1000.f
+
+// Most rays a hitscan weapon can cast per shot
+#define MAX_HITSCAN_RAYS 64
+
+// Weapon IDs. These index directly into the compiled weapon table, so the DataTable rows use the same values.
+UENUM(BlueprintType)
+namespace ESpaceRocksWeapon
+{
+	enum Type
+	{
+		EMPTY = 0,
+		PHASEOID = 1,
+		PULSER = 2,
+		BEAM = 3,
+		SCATTER = 4,
+		NUM_WEAPONS UMETA(Hidden)
+	};
+}
+
+// Where on the craft a weapon fires from
+UENUM(BlueprintType)
+namespace ESpaceRocksFireMount
+{
+	enum Type
+	{
+		Centre,		// Infront and centre of the craft
+		MidWings,	// Alternates between the Mid Left and Mid Right hardpoints
+	};
+}
+
+/**
+ * One row of the weapon DataTable. Edited by designers, compiled into FSpaceRocksWeaponDef at load.
+ */
+USTRUCT(BlueprintType)
+struct FSpaceRocksWeaponRow : public FTableRowBase
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Weapon ID (see ESpaceRocksWeapon), 1 to 255 - inventory slots hold it as a uint8
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		int32 WeaponID;
+
+	// Seconds between shots (0 for a continuous beam, which fires every frame)
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		float FireRate;
+
+	// Damage delt by each projectile or hitscan ray (per second for a continuous beam)
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		float Damage;
+
+	// Speed of each projectile
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		float ProjectileSpeed;
+
+	// Ammo given when the weapon is first picked up (-1 = unlimited)
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		int32 StartAmmo;
+
+	// Ammo given by each ammo pack pickup
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		int32 AmmoPerPickup;
+
+	// Maximum ammo that can be carried
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		int32 MaxAmmo;
+
+	// Hardpoint(s) the weapon fires from
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		TEnumAsByte<ESpaceRocksFireMount::Type> FireMount;
+
+	// Projectile to spawn
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		TSubclassOf<AActor> ProjectileClass;
+
+	// Projectiles home in on locked targets with this acceleration (0 = not homing)
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		float HomingAcceleration;
+
+	// Rays cast by each shot, hitting instantly (0 = fires projectiles). Spread across both hardpoints for MidWings.
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		int32 HitscanRays;
+
+	// Each ray is scattered up to this many degrees off the aim
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		float HitscanSpread;
+
+	// Length of each ray
+	UPROPERTY(Category = Weapon, EditAnywhere, BlueprintReadOnly)
+		float HitscanRange;
+
+	FSpaceRocksWeaponRow()
+		: WeaponID(0)
+		, FireRate(0.25f)
+		, Damage(10.f)
+		, ProjectileSpeed(8000.f)
+		, StartAmmo(-1)
+		, AmmoPerPickup(0)
+		, MaxAmmo(-1)
+		, FireMount(ESpaceRocksFireMount::Centre)
+		, ProjectileClass(NULL)
+		, HomingAcceleration(0.f)
+		, HitscanRays(0)
+		, HitscanSpread(0.f)
+		, HitscanRange(10000.f)
+	{
+	}
+};
+
+/**
+ * Compiled weapon definition. Plain data, read on the fire path.
+ */
+struct FSpaceRocksWeaponDef
+{
+	float FireRate;
+	float Damage;
+	float ProjectileSpeed;
+	int32 StartAmmo;
+	int32 AmmoPerPickup;
+	int32 MaxAmmo;
+	uint8 FireMount;
+	UClass* ProjectileClass;
+	float HomingAcceleration;
+	int32 HitscanRays;
+	float HitscanSpread;		// Degrees
+	float HitscanRange;
+};
+
+/**
+ * Flat, immutable table of weapon definitions indexed by weapon ID.
+ * Built once from a DataTable, so the fire path and weapon selection never hash or look up UObjects.
+ */
+class SPACEROCKS_API FSpaceRocksWeaponInfo
+{
+public:
+	FSpaceRocksWeaponInfo();
+
+	// Rebuild the table from a weapon DataTable (NULL leaves just the built-in defaults)
+	void Compile(const UDataTable* WeaponTable, UClass* DefaultProjectileClass);
+
+	// Number of weapon IDs in the table
+	FORCEINLINE int32 Num() const { return Defs.Num(); }
+
+	// Get the definition of a weapon. Unknown IDs get the EMPTY definition.
+	FORCEINLINE const FSpaceRocksWeaponDef& Get(int32 WeaponID) const
+	{
+		return Defs[((uint32)WeaponID < (uint32)Defs.Num()) ? WeaponID : ESpaceRocksWeapon::EMPTY];
+	}
+
+	FORCEINLINE float getFireRate(int32 WeaponID) const { return Get(WeaponID).FireRate; }
+	FORCEINLINE float getDamage(int32 WeaponID) const { return Get(WeaponID).Damage; }
+
+private:
+	TArray<FSpaceRocksWeaponDef> Defs;
+};
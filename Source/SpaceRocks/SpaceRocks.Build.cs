@@ -7,5 +7,14 @@ public class SpaceRocks : ModuleRules
 	public SpaceRocks(TargetInfo Target)
 	{
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
+
+		// The collision benchmark reads the PhysX scene's pair counts
+		SetupModulePhysXAPEXSupport(Target);
+
+		// Building procedural rock meshes needs the raw mesh format, which only exists in editor builds
+		if (UEBuildConfiguration.bBuildEditor == true)
+		{
+			PrivateDependencyModuleNames.Add("RawMesh");
+		}
 	}
 }
@@ -0,0 +1,247 @@
+#!/usr/bin/env python
+# Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+"""
+Store performance baselines from SpaceRocks soak runs, and compare new runs against them.
+
+Runs are the CSVs the soak test writes to Saved/Soak/, e.g. from a headless run of TestMap1:
+
+    UE4Editor SpaceRocks.uproject /Game/Maps/TestMap1 -game -nullrhi -SpaceRocksSoak -SoakDuration=1200
+
+Samples are grouped by map, level and rock count (rounded down to --rock-bucket), and each group is
+compared on its own, so runs that spend a different time on each level still compare fairly.
+
+    python srperf.py record  baseline.json Soak_<date>.csv [more.csv ...] [--label <build>] [--append]
+    python srperf.py compare baseline.json Soak_<date>.csv [more.csv ...]
+    python srperf.py show    baseline.json
+
+compare prints a pass / regress / improve verdict per metric, from bootstrap confidence intervals on the
+change in the median and the p99. It exits with 1 if anything regressed.
+"""
+
+import argparse
+import csv
+import json
+import random
+import sys
+import time
+
+FORMAT = "srperf-baseline"
+VERSION = 1
+
+# Soak CSV columns compared (all lower is better)
+METRICS = ["FrameTimeP50", "FrameTimeP95", "FrameTimeP99", "InputLatencyP95", "PhysicsKickoffToFetchMs", "ContactPairs", "UsedMemoryMB"]
+
+# Old names of renamed columns, so older CSVs and baselines still count. PhysicsStepMs was always kickoff to fetch
+# wall time on the game thread (TG_DuringPhysics work included), not the simulation time.
+RENAMED = {"PhysicsStepMs": "PhysicsKickoffToFetchMs"}
+
+# Most samples kept per metric in a baseline group (the newest)
+MAX_BASELINE_SAMPLES = 5000
+
+# Fewest samples on each side worth comparing
+MIN_SAMPLES = 5
+
+
+def percentile(values, fraction):
+    """Linear interpolation between closest ranks"""
+    ordered = sorted(values)
+    if not ordered:
+        return 0.0
+    pos = (len(ordered) - 1) * fraction
+    lo = int(pos)
+    hi = min(lo + 1, len(ordered) - 1)
+    return ordered[lo] + (ordered[hi] - ordered[lo]) * (pos - lo)
+
+
+def median(values):
+    return percentile(values, 0.5)
+
+
+def p99(values):
+    return percentile(values, 0.99)
+
+
+def group_key(map_name, level, rocks):
+    return "%s/L%d/R%d" % (map_name, level, rocks)
+
+
+def read_runs(paths, map_override, skip_seconds, rock_bucket):
+    """Returns {group key: {"map", "level", "rocks", "metrics": {metric: [values]}}}"""
+    groups = {}
+    for path in paths:
+        with open(path) as f:
+            for row in csv.DictReader(f):
+                if float(row["Time"]) < skip_seconds:
+                    continue
+
+                map_name = map_override or row.get("Map") or "Unknown"
+                level = int(row["Level"])
+                rocks = (int(row["NumRocks"]) // rock_bucket) * rock_bucket
+                key = group_key(map_name, level, rocks)
+
+                group = groups.setdefault(key, {"map": map_name, "level": level, "rocks": rocks,
+                                                "metrics": dict((m, []) for m in METRICS)})
+                for old, new in RENAMED.items():
+                    if old in row and new not in row:
+                        row[new] = row[old]
+                for metric in METRICS:
+                    if metric in row:
+                        group["metrics"][metric].append(float(row[metric]))
+    return groups
+
+
+def load_baseline(path):
+    try:
+        with open(path) as f:
+            baseline = json.load(f)
+    except IOError:
+        return {"format": FORMAT, "version": VERSION, "groups": {}}
+
+    if baseline.get("format") != FORMAT:
+        raise ValueError("%s is not a SpaceRocks baseline" % path)
+    if baseline.get("version") != VERSION:
+        raise ValueError("%s is baseline version %s, expected %d" % (path, baseline.get("version"), VERSION))
+    for group in baseline["groups"].values():
+        for old, new in RENAMED.items():
+            if old in group["metrics"]:
+                group["metrics"].setdefault(new, group["metrics"].pop(old))
+    return baseline
+
+
+def save_baseline(path, baseline):
+    with open(path, "w") as f:
+        json.dump(baseline, f, indent=1, sort_keys=True)
+
+
+def bootstrap(base, new, statistic, resamples, rng):
+    """95% confidence interval of the relative change in a statistic, new against base"""
+    changes = []
+    for _ in range(resamples):
+        b = statistic([rng.choice(base) for _ in base])
+        n = statistic([rng.choice(new) for _ in new])
+        changes.append((n - b) / b if b else 0.0)
+    return percentile(changes, 0.025), percentile(changes, 0.975)
+
+
+def verdict(low, high, tolerance):
+    """Regressed (or improved) only if the whole interval is past the tolerance"""
+    if low > tolerance:
+        return "regress"
+    if high < -tolerance:
+        return "improve"
+    return "pass"
+
+
+def record(args):
+    baseline = load_baseline(args.baseline)
+    runs = read_runs(args.runs, args.map, args.skip, args.rock_bucket)
+
+    for key, group in sorted(runs.items()):
+        entry = baseline["groups"].get(key) if args.append else None
+        if entry is None:
+            entry = {"map": group["map"], "level": group["level"], "rocks": group["rocks"],
+                     "metrics": dict((m, []) for m in METRICS), "runs": 0}
+        for metric, values in group["metrics"].items():
+            entry["metrics"][metric] = (entry["metrics"].get(metric, []) + values)[-MAX_BASELINE_SAMPLES:]
+        entry["runs"] += len(args.runs)
+        entry["label"] = args.label
+        entry["recorded"] = time.strftime("%Y-%m-%d %H:%M:%S")
+        baseline["groups"][key] = entry
+        print("%-28s %5d samples" % (key, len(group["metrics"][METRICS[0]])))
+
+    save_baseline(args.baseline, baseline)
+    print("%s: %d groups" % (args.baseline, len(baseline["groups"])))
+    return 0
+
+
+def compare(args):
+    baseline = load_baseline(args.baseline)
+    if not baseline["groups"]:
+        raise ValueError("%s has no baselines - record some first" % args.baseline)
+    runs = read_runs(args.runs, args.map, args.skip, args.rock_bucket)
+    rng = random.Random(args.seed)
+
+    counts = {"pass": 0, "regress": 0, "improve": 0, "n/a": 0}
+    header = "%-23s %10s %10s %8s %18s %10s %10s %8s %18s  %s" % (
+        "metric", "base med", "new med", "change", "95% CI", "base p99", "new p99", "change", "95% CI", "verdict")
+
+    for key, group in sorted(runs.items()):
+        entry = baseline["groups"].get(key)
+        if entry is None:
+            print("\n%s: no baseline" % key)
+            continue
+
+        print("\n%s (baseline %s, %s)" % (key, entry.get("label") or "unlabelled", entry.get("recorded", "?")))
+        print(header)
+        for metric in METRICS:
+            base = entry["metrics"].get(metric, [])
+            new = group["metrics"].get(metric, [])
+
+            # Metrics that were never measured (e.g. input latency with no player) have nothing to compare
+            if len(base) < MIN_SAMPLES or len(new) < MIN_SAMPLES or not any(base):
+                print("%-23s %10s" % (metric, "n/a"))
+                counts["n/a"] += 1
+                continue
+
+            columns = []
+            verdicts = []
+            for statistic in (median, p99):
+                b = statistic(base)
+                n = statistic(new)
+                low, high = bootstrap(base, new, statistic, args.resamples, rng)
+                columns.append("%10.3f %10.3f %+7.1f%% [%+6.1f%%, %+6.1f%%]" % (b, n, (n - b) / b * 100.0 if b else 0.0, low * 100.0, high * 100.0))
+                verdicts.append(verdict(low, high, args.tolerance))
+
+            # A regression in either statistic is a regression
+            result = "regress" if "regress" in verdicts else ("improve" if "improve" in verdicts else "pass")
+            counts[result] += 1
+            print("%-23s %s %s  %s" % (metric, columns[0], columns[1], result.upper() if result == "regress" else result))
+
+    print("\n%d pass, %d regress, %d improve, %d n/a" % (counts["pass"], counts["regress"], counts["improve"], counts["n/a"]))
+    return 1 if counts["regress"] else 0
+
+
+def show(args):
+    baseline = load_baseline(args.baseline)
+    for key, entry in sorted(baseline["groups"].items()):
+        frame = entry["metrics"].get("FrameTimeP50", [])
+        print("%-28s %3d runs %5d samples  frame p50 median %.3f ms  (%s, %s)" % (
+            key, entry.get("runs", 0), len(frame), median(frame), entry.get("label") or "unlabelled", entry.get("recorded", "?")))
+    return 0
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="SpaceRocks performance baselines", epilog=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command")
+
+    for name in ("record", "compare"):
+        command = commands.add_parser(name)
+        command.add_argument("baseline", help="baseline file (JSON)")
+        command.add_argument("runs", nargs="+", help="soak CSVs")
+        command.add_argument("--map", help="map name, for CSVs without a Map column")
+        command.add_argument("--skip", type=float, default=30.0, help="ignore samples from the first SKIP seconds (loading)")
+        command.add_argument("--rock-bucket", type=int, default=25, help="group rock counts into buckets this wide")
+    commands.choices["record"].add_argument("--label", default="", help="what was measured, e.g. a changelist")
+    commands.choices["record"].add_argument("--append", action="store_true", help="add to the groups' samples instead of replacing them")
+    commands.choices["compare"].add_argument("--tolerance", type=float, default=0.03, help="relative change within which the verdict is pass")
+    commands.choices["compare"].add_argument("--resamples", type=int, default=2000, help="bootstrap resamples")
+    commands.choices["compare"].add_argument("--seed", type=int, default=1, help="bootstrap seed (same seed, same intervals)")
+
+    command = commands.add_parser("show")
+    command.add_argument("baseline", help="baseline file (JSON)")
+
+    args = parser.parse_args(argv[1:])
+    if args.command is None:
+        parser.print_help()
+        return 2
+
+    try:
+        return {"record": record, "compare": compare, "show": show}[args.command](args)
+    except ValueError as e:
+        print(e)
+        return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,126 @@
+#!/usr/bin/env python
+# Copyright 1998-2014 Epic Games, Inc. All Rights Reserved.
+"""
+Convert a SpaceRocks gameplay event trace (.srtrace, written by the TraceFlush console command)
+to Chrome trace JSON, for chrome://tracing or https://ui.perfetto.dev
+
+    python srtrace_to_chrome.py Saved/Traces/Trace_<date>.srtrace [out.json]
+"""
+
+import json
+import struct
+import sys
+
+MAGIC = 0x52545253  # 'SRTR'
+VERSION = 1
+
+# Must match ESpaceRocksTraceEvent and ESpaceRocksTraceScope in SpaceRocksTrace.h
+EVENT_NAMES = ["Frame", "Scope", "Spawn", "Destroy", "Hit", "Fire", "Thrust", "WeaponSelect", "LevelChange",
+               "InputLatency"]
+SCOPE_NAMES = ["Gravity", "RockFieldSpawn", "RockInstances", "Debris", "Damage", "Hitscan"]
+THRUST_AXES = ["Rear", "Side", "Bottom"]
+
+# Must match ESpaceRocksControl in SpaceRocksInputLatency.h
+CONTROL_NAMES = ["Pitch", "Yaw", "Roll", "RearThrust", "SideThrust", "BottomThrust"]
+
+EVENT = struct.Struct("<dHHi4f")
+
+
+def read_trace(path):
+    """Returns a list of (thread id, is game thread, [(time, type, flags, subject, values)])"""
+    with open(path, "rb") as f:
+        data = f.read()
+
+    magic, version, num_threads = struct.unpack_from("<IIi", data, 0)
+    if magic != MAGIC:
+        raise ValueError("%s is not a SpaceRocks trace" % path)
+    if version != VERSION:
+        raise ValueError("%s is trace version %d, expected %d" % (path, version, VERSION))
+
+    offset = 12
+    threads = []
+    for _ in range(num_threads):
+        thread_id, game_thread, num_events = struct.unpack_from("<IIi", data, offset)
+        offset += 12
+        events = []
+        for _ in range(num_events):
+            time, type_, flags, subject, v0, v1, v2, v3 = EVENT.unpack_from(data, offset)
+            offset += EVENT.size
+            events.append((time, type_, flags, subject, (v0, v1, v2, v3)))
+        threads.append((thread_id, bool(game_thread), events))
+    return threads
+
+
+def to_chrome(threads):
+    # Scopes and input latencies are recorded when they end, so the trace starts at the earliest begin time
+    timed = (EVENT_NAMES.index("Scope"), EVENT_NAMES.index("InputLatency"))
+    start = min([t - (v[0] if type_ in timed else 0.0) for _, _, events in threads for t, type_, _, _, v in events] or [0.0])
+
+    def us(seconds):
+        return (seconds - start) * 1e6
+
+    out = []
+    for thread_id, game_thread, events in threads:
+        name = "GameThread" if game_thread else "Worker %d" % thread_id
+        out.append({"ph": "M", "name": "thread_name", "pid": 1, "tid": thread_id, "args": {"name": name}})
+
+        # Frames are recorded at the start of the game state tick, and run until the next one (the last is still open)
+        frame_starts = sorted(t for t, type_, _, _, _ in events if type_ == EVENT_NAMES.index("Frame"))
+        frame_ends = dict(zip(frame_starts, frame_starts[1:]))
+
+        for time, type_, flags, subject, v in events:
+            base = {"pid": 1, "tid": thread_id}
+            type_name = EVENT_NAMES[type_] if type_ < len(EVENT_NAMES) else "Event%d" % type_
+
+            if type_name == "Frame":
+                if time not in frame_ends:
+                    continue
+                end = frame_ends[time]
+                base.update(ph="X", name="Frame", ts=us(time), dur=(end - time) * 1e6, args={"ms": (end - time) * 1000.0, "delta ms": v[0] * 1000.0})
+            elif type_name == "Scope":
+                scope = SCOPE_NAMES[subject] if 0 <= subject < len(SCOPE_NAMES) else "Scope%d" % subject
+                base.update(ph="X", name=scope, ts=us(time - v[0]), dur=v[0] * 1e6, args={"ms": v[0] * 1000.0})
+            elif type_name == "Thrust":
+                axis = THRUST_AXES[subject] if 0 <= subject < len(THRUST_AXES) else str(subject)
+                base.update(ph="C", name="Thrust", ts=us(time), args={axis: v[0]})
+            elif type_name == "InputLatency":
+                # Recorded when the input is applied, spans back to when it arrived
+                control = CONTROL_NAMES[subject] if 0 <= subject < len(CONTROL_NAMES) else str(subject)
+                base.update(ph="X", name="Input " + control, ts=us(time - v[0]), dur=v[0] * 1e6, args={"ms": v[0] * 1000.0})
+            elif type_name == "LevelChange":
+                base.update(ph="i", s="g", name="Level %d" % subject, ts=us(time), args={"rocks": int(v[0])})
+            else:
+                if type_name == "Spawn":
+                    args = {"actor": subject, "location": v[:3], "radius": v[3]}
+                elif type_name == "Hit":
+                    args = {"actor": subject, "location": v[:3], "impulse": v[3]}
+                elif type_name == "Fire":
+                    args = {"actor": subject, "weapon": int(v[0]), "slot": int(v[1])}
+                elif type_name == "WeaponSelect":
+                    args = {"actor": subject, "slot": int(v[0])}
+                else:
+                    args = {"actor": subject}
+                base.update(ph="i", s="t", name=type_name, ts=us(time), args=args)
+            out.append(base)
+
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+def main(argv):
+    if len(argv) < 2:
+        print(__doc__)
+        return 1
+
+    src = argv[1]
+    dst = argv[2] if len(argv) > 2 else src.rsplit(".", 1)[0] + ".json"
+
+    threads = read_trace(src)
+    with open(dst, "w") as f:
+        json.dump(to_chrome(threads), f)
+
+    print("%s: %d threads, %d events -> %s" % (src, len(threads), sum(len(e) for _, _, e in threads), dst))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))